@@ -56,6 +56,7 @@ HEADERS += $$COMMONDIR/include/atomset.h \
            $$COMMONDIR/include/pixmaps.h \
            $$COMMONDIR/include/point3d.h \
            $$COMMONDIR/include/quaternion.h \
+           $$COMMONDIR/include/spatialindex.h \
            $$COMMONDIR/include/vector3d.h \
            $$COMMONDIR/include/version.h
 SOURCES += $$COMMONDIR/source/atomset.cpp \
@@ -65,6 +66,7 @@ SOURCES += $$COMMONDIR/source/atomset.cpp \
            $$COMMONDIR/source/glsimplemoleculeview.cpp \
            $$COMMONDIR/source/glview.cpp \
            $$COMMONDIR/source/point3d.cpp \
+           $$COMMONDIR/source/spatialindex.cpp \
            $$COMMONDIR/source/version.cpp
 FORMS +=   $$COMMONDIR/ui/moleculepropertieswidget.ui \
            $$COMMONDIR/ui/textviewwidget.ui
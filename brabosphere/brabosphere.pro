@@ -34,10 +34,13 @@ HEADERS += include/aboutbox.h \
            include/iconsets.h \
            include/isosurface.h \
            include/latin1validator.h \
+           include/molecularorbitals.h \
            include/newatombase.h \
+           include/orbitalcache.h \
            include/orbitalthread.h \
            include/orbitalviewerbase.h \
            include/paths.h \
+           include/pointstream.h \
            include/plotmapbase.h \
            include/plotmaplabel.h \
            include/preferencesbase.h \
@@ -60,10 +63,13 @@ SOURCES += source/aboutbox.cpp \
            source/isosurface.cpp \
            source/latin1validator.cpp \
            source/main.cpp \
+           source/molecularorbitals.cpp \
            source/newatombase.cpp \
+           source/orbitalcache.cpp \
            source/orbitalthread.cpp \
            source/orbitalviewerbase.cpp \
            source/paths.cpp \
+           source/pointstream.cpp \
            source/plotmapbase.cpp \
            source/plotmaplabel.cpp \
            source/preferencesbase.cpp \
@@ -29,6 +29,7 @@
 // Xbrabo forward class declarations
 class DensityLoadThread;
 class IsoSurface;
+class MolecularOrbitals;
 
 // Xbrabo includes
 #include <point3d.h>
@@ -79,6 +80,7 @@ class DensityBase : public DensityWidget
     void updateVisibility(QListViewItem* item, const QPoint&, int column); // updates the visibility of a surface
     void updateOperation(const unsigned int density = 0);   // updates the possible operations 
     void updateOpacity();               // updates LabelOpacity with the current opacity value
+    void updateRefinement(bool on);     // starts or stops refining the surfaces
 
   private:
     ///// private enums
@@ -87,8 +89,11 @@ class DensityBase : public DensityWidget
     ///// private member functions
     void makeConnections();             // sets up all connections
     void loadDensity(const bool densityA);        // loads a density for density A or B
+    void evaluateOrbitals(const QString& filename); // evaluates a density from a formatted checkpoint file
     void updateDensity();               // updates everything after loading has finished
     void updateProgress(const unsigned int progress);       // updates the progressbar for the current loading density
+    void startRefinement();             // starts refining the next surface which isn't refined yet
+    void finishRefinement();            // updates a surface after its refinement has finished
     unsigned int typeToNum(const QString& type);      // translates the type into a number
     void enableWidgets();               // enables/disables the correct widgets depending on the status of the class
     bool identicalGrids();              // returns true if the grids of densityA and B are identical
@@ -122,10 +127,20 @@ class DensityBase : public DensityWidget
     Point3D<float> deltaA;              ///< Holds the cell lengths of density A.
     Point3D<float> deltaB;              ///< Holds the cell lengths of density B.
     QString newDescription;             ///< Holds the description of the contents of a new density.
+    MolecularOrbitals* orbitalsA;       ///< The orbitals from which density A was evaluated (zero for cube files).
+    MolecularOrbitals* orbitalsB;       ///< The orbitals from which density B was evaluated (zero for cube files).
+    MolecularOrbitals* loadingOrbitals; ///< The orbitals from which the loading density is evaluated.
+    int orbitalIndexA;                  ///< The orbital (or the total density) of density A.
+    int orbitalIndexB;                  ///< The orbital (or the total density) of density B.
+    int loadingOrbitalIndex;            ///< The orbital (or the total density) of the loading density.
+    int refiningSurface;                ///< The surface refined by loadingThread (-1 if it loads a density).
+    std::vector<Point3D<double> > refinementPoints;         ///< The points evaluated for refining a surface.
+    std::vector<double> refinementValues;                   ///< The values in refinementPoints.
     int columnColourWidth;              ///< Holds the right column width for the one containing the colour of the surface.
 
     ///// static private member data
     static const double deltaLevel;     ///< The minimal change allowed in isoLevels.
+    static const double AUTOANG;        ///< Conversion factor atomic units -> angstrom.
 };
 #endif
 
@@ -31,6 +31,10 @@ class QTextStream;
 
 // Xbrabo forward class declarations
 class DensityBase;
+class MolecularOrbitals;
+
+// Xbrabo header files
+#include "point3d.h"
 
 // Base class header files
 #include <qthread.h>
@@ -41,6 +45,8 @@ class DensityLoadThread : public QThread
   public:
     ///// constructor/destructor
     DensityLoadThread(std::vector<double>* densityPoints, QTextStream* stream, DensityBase* densityDialog, const unsigned int numSkipValues, const unsigned int totalPoints);       // constructor
+    DensityLoadThread(std::vector<double>* densityPoints, MolecularOrbitals* orbitals, const int orbital, const Point3D<unsigned int>& numPoints, const Point3D<double>& origin, const Point3D<double>& delta, DensityBase* densityDialog); // constructor for evaluating orbitals
+    DensityLoadThread(std::vector<double>* densityPoints, MolecularOrbitals* orbitals, const int orbital, const std::vector<Point3D<double> >* points, DensityBase* densityDialog); // constructor for evaluating orbitals in a list of points
     ~DensityLoadThread();               // destructor
 
     ///// pure virtuals
@@ -59,6 +65,12 @@ class DensityLoadThread : public QThread
     bool stopRequested;                 ///< Is set to true if the thread should be stopped.
     DensityBase* parent;                ///< The widget which should get notifications.
     unsigned int progress;              ///< Used to transfer the progress to the parent dialog.
+    MolecularOrbitals* molecularOrbitals;         ///< The orbitals to evaluate instead of reading from textStream.
+    int orbitalIndex;                   ///< The orbital to evaluate (or the total density).
+    Point3D<unsigned int> gridNumPoints;///< The number of points of the grid to evaluate.
+    Point3D<double> gridOrigin;         ///< The origin of the grid to evaluate (bohr).
+    Point3D<double> gridDelta;          ///< The spacing of the grid to evaluate (bohr).
+    const std::vector<Point3D<double> >* evaluationPoints;  ///< The points to evaluate instead of the grid (bohr).
 };
 
 #endif
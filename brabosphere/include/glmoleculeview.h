@@ -36,6 +36,7 @@ class AtomSet;
 class IsoSurface;
 class DensityBase;
 class NewAtomBase;
+template <class T> class Point3D;
 
 // Base class header file
 #include <glsimplemoleculeview.h>
@@ -59,9 +60,12 @@ class GLMoleculeView : public GLSimpleMoleculeView
     void addAtoms();                    // adds atoms using a dialog
     void deleteSelectedAtoms();         // deletes all selected atoms
     void toggleSelection();             // toggles the manipulation target
+    void undo();                        // reverts the last change to the atoms
+    void redo();                        // reapplies the last reverted change to the atoms
 
   protected:
     void mouseMoveEvent(QMouseEvent* e);// event which takes place when the mouse is moved while a mousebutton is pressed
+    void mouseReleaseEvent(QMouseEvent* e);       // event which takes place when a mousebutton is released
     void keyPressEvent(QKeyEvent* e);   // event which takes places when a key is pressed
     //void wheelEvent(QWheelEvent* e);    // event which takes place when the scrollwheel of the mouse is used
     //void translateZ(const int amount);  // handles Z-direction translations
@@ -82,15 +86,24 @@ private slots:
     void translateSelection(const int xRange, const int yRange, const int zRange);        // translates the selected atoms according to the current view
     void rotateSelection(const double angleX, const double angleY, const double angleZ);  // rotates the selected atoms around their local center of mass
     void changeSelectedIC(const int range);       // changes the selected internal coordinate
+    void beginDragEdit();               // starts a group of changes for a mouse drag
+    void updateAfterJournal(const unsigned int oldCount);   // updates the view after an undo or redo
     void drawItem(const unsigned int index);    // draws the item shapes[index]
+    static void includePoint(GLfloat* bounds, const Point3D<float>& point); // extends a bounding box to include a point
     
     ///// private member data   
     AtomSet* atoms;                     ///< The list of atoms.
     IsoSurface* isoSurface;             ///< An isodensity surface.
     DensityBase* densityDialog;         ///< A dialog for changing the isodensity surfaces.
     NewAtomBase* newAtomDialog;         ///< A dialog for adding atoms to the atomset
-    std::vector<GLuint> glSurfaces;     ///< A vector that holds the GL display list indices for surfaces.
+    std::vector<GLuint> glSurfaces;     ///< A vector that holds the first GL display list index of the chunks of each surface.
+    std::vector<unsigned int> glSurfaceChunks;    ///< The number of display lists (chunks) of each surface.
+    std::vector< std::vector<GLfloat> > glSurfaceBounds;  ///< The bounding box of each chunk of each surface (6 values per chunk).
     bool manipulateSelection;           ///< If true, only the selected atoms are manipulated instead of the entire system.
+    bool dragEditing;                   ///< If true, the changes of a mouse drag are being grouped for undo.
+
+    ///// private constants
+    static const unsigned int surfaceChunkSize;   ///< The number of triangles (or points) in a chunk of a surface.
 };
    
 #endif
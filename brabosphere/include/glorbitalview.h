@@ -28,10 +28,10 @@
 
 // Qt forward class declarations
 class QColor;
-#include <qmutex.h>
+class QGLBuffer;
 
 // Xbrabo header files
-#include "point3d.h"
+#include "pointstream.h"
 
 // Base class header file
 #include <glview.h>
@@ -48,8 +48,10 @@ class GLOrbitalView : public GLView
 
     // public member functions
     void updateColors(QColor pos, QColor neg);
-    std::vector<Point3D<float> >* getCoordinates();         // returns a pointer to the coords vector
-    QMutex* getMutex();                   // returns a pointer to the mutex used for accessing the coords vector
+    PointStream* getStream();           // returns a pointer to the stream receiving the coordinates
+    void clearPoints();                 // removes all points
+    void getPoints(std::vector<GLfloat>& negative, std::vector<GLfloat>& positive); // returns the coordinates of the points of each phase
+    void setPoints(const std::vector<GLfloat>& negative, const std::vector<GLfloat>& positive); // replaces the points
     void setMaximumRadius(const double radius);   // updates the maximum radius of the coordinates
         
   protected:
@@ -57,14 +59,23 @@ class GLOrbitalView : public GLView
     float boundingSphereRadius();       // calculates the radius of the bounding sphere
     
   private:
+    // private member functions
+    void readStream();                  // sorts the points published to the stream by phase
+    void uploadPoints(const unsigned int phase);  // uploads the new points of a phase to its vertex buffer
+
     // private enums
     //enum Precision{PRECISION_UNKNOWN, PRECISION_FLOAT, PRECISION_DOUBLE, PRECISION_LONG_DOUBLE};
     
     // private member variables
     QColor colorPositive;               ///< The color of positive values.
     QColor colorNegative;               ///< The color of negative values.
-    std::vector<Point3D<float> > coords;          ///< The coordinates including phases.
-    QMutex mutex;                       ///< The mutex for accessing the coords vector.
+    PointStream stream;                 ///< The stream of new coordinates including phases.
+    std::vector<Point3D<float> > newCoords;       ///< Holds the coordinates read from the stream before they're sorted by phase.
+    std::vector<GLfloat> phaseCoords[2];///< The coordinates of the points of each phase (0 = negative, 1 = positive) packed as x, y, z.
+    QGLBuffer* phaseBuffers[2];         ///< The vertex buffers holding the coordinates of each phase (0 if not supported).
+    int bufferCapacity[2];              ///< The allocated size in bytes of each vertex buffer.
+    int bufferSize[2];                  ///< The size in bytes of the coordinates already uploaded to each vertex buffer.
+    bool buffersChecked;                ///< = true if the vertex buffers have been created (if supported).
     float maximumRadius;                ///< The overall maximum radius (used by boundingSphereRadius).
     float scaleFactor;                  ///< A scaling factor used when maximumRadius exceeds the far z-value (100.0f).
 };
@@ -42,11 +42,14 @@ class IsoSurface
 	  void setParameters(const std::vector<double>* values, const Point3D<unsigned int>& pointDimension, const Point3D<float>& pointDelta, const Point3D<float>& pointOrigin);         // set up the parameters for the surface 
 	  void addSurface(const double isoDensity); // calculates a new surface
     void changeSurface(const unsigned int surface, const double isoDensity);      // recalculates a surface
+    bool refinementPoints(const unsigned int surface, vector<Point3D<double> >& points); // returns the points to evaluate for refining a surface
+    void refineSurface(const unsigned int surface, const vector<double>& values); // recalculates a surface on the refined grid
 
     bool densityPresent() const;          // returns whether a density has been loaded
     unsigned int numSurfaces() const;     // returns the number of calculated surfaces
     unsigned int numTriangles(const unsigned int surface) const;        // returns the number of triangles a certain surface consists of
 	  unsigned int numVertices(const unsigned int surface) const;         // returns the number of points a certain surface consists of
+    bool surfaceRefined(const unsigned int surface) const;  // returns whether a surface was calculated on a refined grid
 	  void getTriangle(const unsigned int surface, const unsigned int index, Point3D<float>& point1, Point3D<float>& point2, Point3D<float>& point3, 
                      Point3D<float>& normal1, Point3D<float>& normal2, Point3D<float>& normal3) const;// return the data of a triangle of a surface    
     Point3D<float> getPoint(const unsigned int surface, const unsigned int index) const;    // returns the coordinates of a point on a surface
@@ -67,6 +70,11 @@ class IsoSurface
 
     ///// private member functions
     void calculateSurface(const double isoDensity); // does the basic surface calculation
+    void calculateRefinedSurface();       // calculates the surface on the refined grid near the surface
+    unsigned int refinementFactor(const unsigned int numCells) const; // returns the refinement factor for a number of cells
+    double refinedValue(const unsigned int x, const unsigned int y, const unsigned int z) const;        // returns a value on the refined grid
+    unsigned int getRefinedEdgeID(const unsigned int x, const unsigned int y, const unsigned int z, const unsigned int edge) const;  // returns the ID of an edge of the refined grid
+    unsigned int getRefinedArrayIndex(const unsigned int x, const unsigned int y, const unsigned int z) const;  // returns the index of a point of the refined grid
     Point3D<float> intersection(const unsigned int x, const unsigned int y, const unsigned int z, const unsigned int edge);    // calculates the intersection
     Point3D<float> interpolate(const Point3D<float> point1, const Point3D<float> point2, const double var1, const double var2);   // linear interpolation
 	  unsigned int getEdgeID(const unsigned int x, const unsigned int y, const unsigned int z, const unsigned int edge);  // returns the ID of the edge 
@@ -87,11 +95,22 @@ class IsoSurface
     vector< vector<Point3D<float> >* > verticesList;///< an easily accessible list of vertices for each calculated surface
     vector< vector<unsigned int>* > triangleIndices;///< an easily accessible list of vertex indices for each calculated surface
     vector< vector<float>* > normals;     ///< a list of normals for each calculated surface
+    vector<bool> refinedSurfaces;         ///< = true for each surface calculated on a refined grid
+    double refinedLevel;                  ///< the isodensity value for which the refined grid was set up
+    unsigned int refinedFactor;           ///< the number of refined cells along each edge of a cell
+    vector<unsigned int> refinedCells;    ///< the indices of the refined cells of the original grid
+    Point3D<unsigned int> refinedNumPoints;         ///< the number of points of the refined grid in the 3 directions
+    vector<unsigned int> refinedIndices;  ///< the sorted indices of the used points of the refined grid
+    vector<double> refinedValues;         ///< the values in the used points of the refined grid
 
 	  ///// private static member data
 	  static const unsigned int edgeTable[256];        ///< lookup table for edges
 	  static const int triTable[256][16];     ///< lookup table for triangles. The original implementation used unsigned ints which is very
                                             ///< strange as the table contains negative number. Works either way, though.
+    static const unsigned int cornerOffsets[8][3];  ///< the offsets of the corners of a cell
+    static const unsigned int edgeCorners[12][2];   ///< the corners connected by each edge of a cell
+    static const unsigned int maxRefinement;        ///< the maximum number of refined cells along each edge of a cell
+    static const double maxRefinedSamples;          ///< the maximum number of points evaluated for a refined surface
 };
 
 #endif
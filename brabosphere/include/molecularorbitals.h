@@ -0,0 +1,142 @@
+/***************************************************************************
+                     molecularorbitals.h  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+/// \file
+/// Contains the declaration of the class MolecularOrbitals
+
+#ifndef MOLECULARORBITALS_H
+#define MOLECULARORBITALS_H
+
+///// Forward class declarations & header files ///////////////////////////////
+
+// STL header files
+#include <vector>
+
+// Qt forward class declarations
+class QObject;
+class QString;
+
+// Xbrabo forward class declarations
+class MolecularOrbitalsWorker;
+
+// Xbrabo header files
+#include "point3d.h"
+
+// Base class header files
+#include <qthread.h>
+
+///// class MolecularOrbitals /////////////////////////////////////////////////
+class MolecularOrbitals
+{
+  public:
+    ///// constructor/destructor
+    MolecularOrbitals();                // constructor
+    ~MolecularOrbitals();               // destructor
+
+    ///// public member functions for changing data
+    bool load(const QString& filename); // reads the basis set and the orbitals from a Gaussian formatted checkpoint file
+    void stop();                        // requests stopping a running evaluation
+
+    ///// public member functions for retrieving data
+    unsigned int numOrbitals() const;   // returns the number of orbitals (alpha and beta)
+    unsigned int homo() const;          // returns the index of the highest occupied (alpha) orbital
+    QString orbitalName(const unsigned int orbital) const;  // returns a description of an orbital
+    void defaultGrid(const double spacing, Point3D<unsigned int>& numPoints, Point3D<double>& origin) const; // returns a grid encompassing the molecule
+    void evaluate(const int orbital, const Point3D<unsigned int>& numPoints, const Point3D<double>& origin, const Point3D<double>& delta, std::vector<double>& values, QObject* receiver = 0, unsigned int* progress = 0); // evaluates an orbital or the density on a grid
+    void evaluate(const int orbital, const std::vector<Point3D<double> >& points, std::vector<double>& values, QObject* receiver = 0, unsigned int* progress = 0); // evaluates an orbital or the density in a list of points
+    double value(const int orbital, const double x, const double y, const double z) const; // evaluates an orbital or the density in a point
+
+    ///// public static constants
+    static const int TotalDensity;      ///< The orbital index for the total electron density.
+
+  private:
+    ///// private structs
+    struct Shell
+    /// Contains a contracted shell of basis functions.
+    {
+      int type;                         ///< The Gaussian shell type (0 = s, 1 = p, -1 = sp, 2 = cartesian d, -2 = pure d, ...).
+      unsigned int firstFunction;       ///< The index of the first basis function of the shell.
+      unsigned int numFunctions;        ///< The number of basis functions of the shell.
+      double x, y, z;                   ///< The center of the shell (bohr).
+      std::vector<double> exponents;    ///< The exponents of the primitives.
+      std::vector<double> coefficients; ///< The contraction coefficients including the normalization of the primitives.
+      std::vector<double> coefficientsP;///< The contraction coefficients of the p part of an sp shell.
+      std::vector<double> factors;      ///< The normalization factors of the components of a cartesian shell relative to x^l.
+      double cutoffSquared;             ///< The squared distance beyond which the shell is negligible.
+    };
+
+    ///// private member functions
+    void clear();                       // removes all data
+    bool setupShells(const std::vector<double>& shellTypes, const std::vector<double>& primitivesPerShell, const std::vector<double>& exponents, const std::vector<double>& contractions, const std::vector<double>& contractionsP, const std::vector<double>& shellCoordinates); // sets up the shells
+    void runWorkers(const unsigned int numTasks, QObject* receiver = 0, unsigned int* progress = 0); // divides the work over the worker threads
+    void evaluatePlanes(MolecularOrbitalsWorker* worker);   // evaluates the planes of the grid assigned to a worker
+    void evaluateBlocks(MolecularOrbitalsWorker* worker);   // evaluates the blocks of points assigned to a worker
+    double pointValue(const int orbital, const double x, const double y, const double z, const std::vector<unsigned int>& candidates, std::vector<double>& basis, std::vector<unsigned int>& active) const; // evaluates an orbital or the density in a point
+    void shellValues(const Shell& shell, const double dx, const double dy, const double dz, const double r2, double* values) const; // evaluates the basis functions of a shell
+    double orbitalValue(const double* orbitalCoefficients, const std::vector<double>& basis, const std::vector<unsigned int>& active) const; // combines the basis functions into an orbital
+    const double* coefficients(const unsigned int orbital) const; // returns the MO coefficients of an orbital
+    static double doubleFactorial(const int n);   // returns n!! (1 for n <= 0)
+
+    ///// private member data
+    std::vector<Shell> shells;          ///< The shells of the basis set.
+    std::vector<Point3D<double> > atoms;///< The positions of the atoms (bohr).
+    unsigned int numBasisFunctions;     ///< The number of basis functions.
+    unsigned int numOrbitalsPerSpin;    ///< The number of alpha (and beta) orbitals.
+    unsigned int numAlpha;              ///< The number of alpha electrons.
+    unsigned int numBeta;               ///< The number of beta electrons.
+    std::vector<double> alphaCoefficients;        ///< The MO coefficients of the alpha orbitals (one orbital after the other).
+    std::vector<double> betaCoefficients;         ///< The MO coefficients of the beta orbitals (empty if restricted).
+    std::vector<double> alphaEnergies;  ///< The energies of the alpha orbitals.
+    std::vector<double> betaEnergies;   ///< The energies of the beta orbitals.
+    volatile bool stopRequested;        ///< Is set to true if a running evaluation should be stopped.
+    int gridOrbital;                    ///< The orbital evaluated on the grid.
+    Point3D<unsigned int> gridNumPoints;///< The number of points of the grid in each direction.
+    Point3D<double> gridOrigin;         ///< The origin of the grid (bohr).
+    Point3D<double> gridDelta;          ///< The spacing of the grid (bohr).
+    const std::vector<Point3D<double> >* gridPoints;        ///< The points to evaluate if not on a grid.
+    std::vector<double>* gridValues;    ///< The values on the grid or in the points.
+
+    friend class MolecularOrbitalsWorker;
+
+    ///// private static constants
+    static const double screeningThreshold;       ///< The value below which a basis function is neglected.
+    static const double gridMargin;     ///< The distance between the atoms and the edges of the default grid (bohr).
+    static const unsigned long progressInterval;  ///< The number of milliseconds between progress updates.
+    static const unsigned int pointsPerBlock;     ///< The number of points screened together when evaluating a list of points.
+    static const unsigned int cartesianPowers[35][3];       ///< The powers of x, y and z of the cartesian functions in Gaussian's order for l = 0 - 4.
+};
+
+///// class MolecularOrbitalsWorker ///////////////////////////////////////////
+class MolecularOrbitalsWorker : public QThread
+{
+  public:
+    ///// constructor
+    MolecularOrbitalsWorker(MolecularOrbitals* parentOrbitals, const unsigned int index, const unsigned int number); // constructor
+
+    ///// public member data
+    const unsigned int first;           ///< The first plane (x) of the grid or block of points done by this worker.
+    const unsigned int stride;          ///< The step between the planes or blocks done by this worker (= the number of workers).
+    unsigned int progress;              ///< The number of points done by this worker.
+
+  private:
+    ///// private member functions
+    virtual void run();                 // does the part of the work of this worker
+
+    ///// private member data
+    MolecularOrbitals* orbitals;        ///< The orbitals the work is done for.
+};
+
+#endif
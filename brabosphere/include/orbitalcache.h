@@ -0,0 +1,95 @@
+/***************************************************************************
+                        orbitalcache.h  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+/// \file
+/// Contains the declaration of the class OrbitalCache
+
+#ifndef ORBITALCACHE_H
+#define ORBITALCACHE_H
+
+///// Forward class declarations & header files ///////////////////////////////
+
+// STL header files
+#include <list>
+#include <map>
+#include <vector>
+
+// Qt header files
+#include <qstring.h>
+
+///// class OrbitalCache //////////////////////////////////////////////////////
+class OrbitalCache
+{
+  public:
+    ///// public structs
+    struct Key
+    /// Contains all parameters determining the points of an orbital.
+    {
+      unsigned int type;                ///< The type of visualization.
+      unsigned int atom;                ///< The atomic number.
+      unsigned int n;                   ///< The principal quantum number.
+      unsigned int l;                   ///< The orbital quantum number.
+      int m;                            ///< The angular momentum quantum number.
+      float resolution;                 ///< The resolution.
+      float probability;                ///< The probability.
+      unsigned int dots;                ///< The number of dots.
+      unsigned int seed;                ///< The seed for the random numbers.
+      bool operator<(const Key& other) const;     // orders the keys for the map
+    };
+
+    ///// constructor/destructor
+    OrbitalCache();                     // constructor
+    ~OrbitalCache();                    // destructor
+
+    ///// public member functions
+    void setDirectory(const QString& dir);        // sets the directory for caching on disk (empty to disable)
+    bool find(const Key& key, std::vector<float>& negative, std::vector<float>& positive, double& radius); // retrieves the points of an orbital
+    void insert(const Key& key, const std::vector<float>& negative, const std::vector<float>& positive, const double radius); // stores the points of an orbital
+    void clear();                       // removes all points from memory
+
+  private:
+    ///// private structs
+    struct Entry
+    /// Contains the points of an orbital.
+    {
+      Key key;                          ///< The parameters of the orbital.
+      std::vector<float> coords[2];     ///< The coordinates of the points of each phase (0 = negative, 1 = positive).
+      double radius;                    ///< The radius of the bounding sphere.
+    };
+
+    ///// private member functions
+    void store(const Key& key, const std::vector<float>& negative, const std::vector<float>& positive, const double radius); // stores the points in memory
+    QString fileName(const Key& key) const;       // returns the name of the file for an orbital
+    QString filePrefix() const;         // returns the start of the file names of the current version
+    bool readFile(const Key& key, std::vector<float>& negative, std::vector<float>& positive, double& radius) const; // reads the points from disk
+    void writeFile(const Key& key, const std::vector<float>& negative, const std::vector<float>& positive, const double radius) const; // writes the points to disk
+    void prune() const;                 // removes old and least recently used files from disk
+
+    ///// private member data
+    std::list<Entry> entries;           ///< The cached orbitals, the most recently used first.
+    std::map<Key, std::list<Entry>::iterator> index;        ///< Finds the entry for a key.
+    unsigned int numPoints;             ///< The total number of points in memory.
+    QString directory;                  ///< The directory for caching on disk (empty if disabled).
+
+    ///// private static constants
+    static const unsigned int maxPoints;///< The maximum number of points kept in memory.
+    static const unsigned int maxDiskSize;        ///< The maximum total size in bytes of the files on disk.
+    static const unsigned int fileMagic;///< Identifies the files of the disk cache.
+    static const unsigned int fileVersion;        ///< The version of the format and the calculated points of the files.
+};
+
+#endif
+
@@ -27,9 +27,15 @@
 #include <vector>
 
 // Qt forward class declarations
-class QMutex;
 class QWidget;
 
+// Xbrabo forward class declarations
+class OrbitalWorker;
+class PointStream;
+
+// Qt header files
+#include <qatomic.h>
+
 // Xbrabo header files
 #include "point3d.h"
 
@@ -41,7 +47,7 @@ class OrbitalThread : public QThread
 {
   public:
     ///// constructor/destructor
-    OrbitalThread(QWidget* parentWidget, QMutex* sharedMutex, std::vector<Point3D<float> >* coordinates, const unsigned int type, const unsigned int atom, const unsigned int n, const unsigned int l, const int m, const float res, const float prob, const unsigned int dots);        // constructor
+    OrbitalThread(QWidget* parentWidget, PointStream* pointStream, const unsigned int type, const unsigned int atom, const unsigned int n, const unsigned int l, const int m, const float res, const float prob, const unsigned int dots, const unsigned int seed);        // constructor
     ~OrbitalThread();                   // destructor
 
     ///// public enums
@@ -57,22 +63,26 @@ class OrbitalThread : public QThread
 
     ///// private member functions
     virtual void run();                 // reimplementation of this pure virtual does the actual work
-    void calcIsoProbability();          // calculates an isoprobability
-    void calcAccumulatedProbability();  // calculates points with the given total accumulated probability
-    void calcRandomDots();              // calculates random points according to the probability
-    void calcRadialPart();              // calculates only the radial part of the orbital
-    void calcAngularPart();             // calculates only the angular part of the orbital
-    void updateList(std::vector<Point3D<float> >& newCoords, bool final = false);         // updates the shared list of coordinates with a new set
-    float associatedLegendre(const float x, const int m, const unsigned int l); // returns the associated Legendre polynomial
-    float associatedLaguerre(const float x, const int m, const unsigned int n); // returns the associated Laguerre polynomial
-    template <class T> T factorial(const unsigned int number);        // returns the factorial (n!) of the number (n)
-    float random(const float min, const float max);         // returns a random number between min and max
-    template <class T> T largestResult(const unsigned int n, const unsigned int l, const int m, const unsigned int Z);  // calculates the largest possible result for the given quantum numbers
+    void calcPart(OrbitalWorker* worker);         // does the part of the work of a worker thread
+    template <class T> void calcPart(OrbitalWorker* worker);                  // does the part of the work of a worker thread with precision T
+    template <class T> void calcIsoProbability(OrbitalWorker* worker);         // calculates an isoprobability
+    template <class T> void calcAccumulatedProbability(OrbitalWorker* worker); // calculates points with the given total accumulated probability
+    template <class T> void calcRandomDots(OrbitalWorker* worker);   // calculates random points according to the probability
+    template <class T> void calcRadialPart();              // calculates only the radial part of the orbital
+    template <class T> void calcAngularPart(OrbitalWorker* worker);  // calculates only the angular part of the orbital
+    void updateList(std::vector<Point3D<float> >& newCoords, bool final = false);         // publishes a new set of coordinates to the stream
+    template <class T> T radialFunction(const T rho, const T normR);           // returns the radial part of the orbital
+    template <class T> T associatedLegendre(const T x, const int m, const unsigned int l); // returns the associated Legendre polynomial
+    template <class T> T associatedLaguerre(const T x, const int m, const unsigned int n); // returns the associated Laguerre polynomial
+    long double factorialRatio(const unsigned int numerator, const unsigned int denominator); // returns numerator!/denominator!
+    long double radialNormalization(const unsigned int n, const unsigned int l, const unsigned int Z); // returns the normalization factor of the radial part
+    long double angularNormalization(const unsigned int l, const int m); // returns the normalization factor of the angular part
+    template <class T> T largestAngular(const unsigned int l, const int m);         // calculates the largest intermediate value of the angular part
+    template <class T> T largestRadial(const unsigned int n, const unsigned int l, const unsigned int Z); // calculates the largest intermediate value of the radial part
 
     ///// private member data
     QWidget* receiver;                  ///< The widget that receives any sent events.
-    QMutex* mutex;                      ///< A mutex to lock the access to the vector of calculated points.
-    std::vector<Point3D<float> >* coords;         ///< Coordinates of calculated probability points.
+    PointStream* stream;                ///< The stream receiving the calculated points.
     unsigned int atomNumber;            ///< The atom type for which the orbital is to be shown.
     unsigned int qnPrincipal;           ///< Principal quantum number (n) (1 - x).
     unsigned int qnOrbital;             ///< Orbital quantum number (l) (0 - n-1).
@@ -81,13 +91,45 @@ class OrbitalThread : public QThread
     float probability;                  ///< The iso or accumulated probability.
     float resolution;                   ///< The desired resolution.
     unsigned int numDots;               ///< The number of dots to calculate for random dots.
+    unsigned int randomSeed;            ///< The seed for the random numbers.
     bool stopRequested;                 ///< Is set to true if the thread should be stopped.
     float maximumRadius;                ///< Holds the maximum encountered value of r during the calculation.
     unsigned int progress;              ///< Holds the progress of the calculation.
+    Precision precision;                ///< The precision used for the calculation.
+
+    friend class OrbitalWorker;
 
     // private static constants
     static const float abohr;           ///< The Bohr radius.
-    static const unsigned int updateSize;         // The amount of dots that have to be calculated before the list of dots is updated and the mutex is locked
+    static const unsigned int updateSize;         // The amount of dots that have to be calculated before they are published to the stream
+    static const unsigned long progressInterval;  ///< The number of milliseconds between progress updates.
+    static const unsigned int dotsPerBlock;       ///< The number of random dots calculated with the same random number stream.
+};
+
+///// class OrbitalWorker /////////////////////////////////////////////////////
+class OrbitalWorker : public QThread
+{
+  public:
+    ///// constructor
+    OrbitalWorker(OrbitalThread* parentThread, const unsigned int index, const unsigned int number); // constructor
+
+    ///// public member functions
+    void seed(const unsigned int stream);         // starts the random numbers of the given stream
+    float random(const float min, const float max);         // returns a random number between min and max
+
+    ///// public member data
+    const unsigned int first;           ///< The first row (theta) of the domain done by this worker.
+    const unsigned int stride;          ///< The step between the rows done by this worker (= the number of workers).
+    float maximumRadius;                ///< Holds the maximum encountered value of r by this worker.
+    QAtomicInt progress;                ///< Holds the progress of this worker (read by the parent thread while working).
+
+  private:
+    ///// private member functions
+    virtual void run();                 // does the part of the work of this worker
+
+    ///// private member data
+    OrbitalThread* thread;              ///< The thread the work is done for.
+    unsigned int randomState[4];        ///< The state of the xoshiro128+ random number generator of this worker.
 };
 
 #endif
@@ -33,6 +33,9 @@ class GLOrbitalView;
 class OrbitalOptionsWidget;
 class OrbitalThread;
 
+///// Xbrabo header files
+#include "orbitalcache.h"
+
 ///// Base class header file
 #include <qdialog.h>
 
@@ -56,10 +59,13 @@ class OrbitalViewerBase : public QDialog
     void updateColors();                // updates the view with new colors
     void updateTypeOptions(int type);   // updates the options to correspond to the chosen type
     void cancelCalculation();           // stops calculating a new orbital
+    void updateDiskCache(bool on);      // enables/disables caching the orbitals on disk
     
   private:
     // private member functions
     void finishCalculation();           // finished up a calculation
+    OrbitalCache::Key cacheKey() const; // returns the key of the orbital defined by the widgets
+    QString settingsPrefix() const;     // returns the prefix of the entries in the settings
 
     // private member variables
     QHBoxLayout* BigLayout;             ///< All encompassing horizontal layout.
@@ -69,6 +75,9 @@ class OrbitalViewerBase : public QDialog
     ColorButton* ColorButtonNegative;   ///< The pushbutton for choosing the colour of the negative values.
     OrbitalThread* calcThread;          ///< The thread doing the calculation.
     QTimer* timer;                      ///< Handles periodic updating of the view during a calculation.
+    OrbitalCache cache;                 ///< Keeps the points of finished calculations.
+    OrbitalCache::Key calcKey;          ///< The key of the orbital being calculated.
+    bool calcCancelled;                 ///< Is set to true if the running calculation was cancelled.
 };
 
 #endif
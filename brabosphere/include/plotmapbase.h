@@ -40,6 +40,7 @@ class QString;
 class PlotMapExtensionWidget;
 class PlotMapLabel;
 #include "point3d.h"
+#include "spatialindex.h"
  
 ///// class PlotMapBase ////////////////////////////////////////////////////////
 class PlotMapBase : public PlotMapWidget
@@ -105,6 +106,7 @@ class PlotMapBase : public PlotMapWidget
     unsigned int numAtoms;              ///< The number of atoms.
     vector< vector<double> > points;    ///< The values of the grid points: points[numPointsY][NumPointsX].
     vector< Point3D<double> > coords;   ///< The coordinates of the atoms.
+    SpatialIndex atomIndex;             ///< Spatial index of the coordinates of the atoms.
     PlotMapExtensionWidget* options;    ///< The widget that allows changing the options.
     QPoint mousePosition;               ///< Holds the start position of a mouse drag.
     PlotMapLabel* plotLabel;            ///< Shows the resulting map.
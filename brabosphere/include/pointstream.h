@@ -0,0 +1,61 @@
+/***************************************************************************
+                        pointstream.h  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+/// \file
+/// Contains the declaration of the class PointStream
+
+#ifndef POINTSTREAM_H
+#define POINTSTREAM_H
+
+///// Forward class declarations & header files ///////////////////////////////
+
+// STL header files
+#include <vector>
+
+// Qt header files
+#include <qatomic.h>
+
+// Xbrabo header files
+#include "point3d.h"
+
+///// class PointStream ///////////////////////////////////////////////////////
+class PointStream
+{
+  public:
+    PointStream();                      // constructor
+    ~PointStream();                     // destructor
+
+    ///// public member functions for the producers
+    void publish(std::vector<Point3D<float> >& points);     // appends a chunk of points to the stream
+
+    ///// public member functions for the consumer
+    unsigned int read(std::vector<Point3D<float> >& points);// appends the points published since the last read
+    void clear();                       // removes all chunks from the stream
+
+  private:
+    ///// private structs
+    struct Chunk
+    {
+      std::vector<Point3D<float> > points;        ///< The points of the chunk.
+      QAtomicPointer<Chunk> next;       ///< The chunk published after this one.
+    };
+
+    ///// private member data
+    Chunk* head;                        ///< The chunk read last by the consumer (or an empty one if nothing was read yet).
+    QAtomicPointer<Chunk> tail;         ///< The chunk published last.
+};
+
+#endif
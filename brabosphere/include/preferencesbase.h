@@ -133,8 +133,10 @@ class PreferencesBase : public PreferencesWidget
       unsigned int styleMolecule;       ///< ComboBoxMolecule
       unsigned int styleForces;         ///< ComboBoxForces
       int fastRenderLimit;              ///< SpinBoxFastRender
+      bool impostorSpheres;             ///< CheckBoxImpostors
       bool showElements;                ///< CheckBoxElement
       bool showNumbers;                 ///< CheckBoxNumber
+      bool hideOverlappingLabels;       ///< CheckBoxLabelOverlap
       int sizeLines;                    ///< SliderBondSizeLines
       QString sizeBonds;                ///< LineEditBondSizeTubes
       QString sizeForces;               ///< LineEditForceSizeTubes
@@ -1567,6 +1567,8 @@ void Calculation::runUpdate()
   ///// update the coordinates in case of a geometry optimization
   if(calculationType == GlobalBase::GeometryOptimization && currentCycle != 0)
   {
+    ///// successive cycles have the same atoms, so keep the bond topology
+    atoms->setTopologyReuse(true);
     ///// read the crd file
     QFile file(calcDir + QDir::separator() + calcName + ".crd");
     if(!file.exists() || CrdFactory::readFromFile(atoms, file.name()) != CrdFactory::OK)
@@ -61,6 +61,7 @@
 #include "densitybase.h"
 #include "densityloadthread.h"
 #include "isosurface.h"
+#include "molecularorbitals.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 ///// Public Member Functions                                             /////
@@ -70,6 +71,13 @@
 DensityBase::DensityBase(IsoSurface* surface, QWidget* parent, const char* name, bool modal, WFlags fl) : DensityWidget(parent, name, modal, fl),
   isoSurface(surface),
   loadingThread(0),
+  orbitalsA(0),
+  orbitalsB(0),
+  loadingOrbitals(0),
+  orbitalIndexA(0),
+  orbitalIndexB(0),
+  loadingOrbitalIndex(0),
+  refiningSurface(-1),
   columnColourWidth(-1)
 /// The defaults constructor.
 {
@@ -100,6 +108,9 @@ DensityBase::~DensityBase()
     }
     delete loadingThread;
   }
+  delete orbitalsA;
+  delete orbitalsB;
+  delete loadingOrbitals;
 }
 
 ///// surfaceVisible //////////////////////////////////////////////////////////
@@ -307,6 +318,8 @@ void DensityBase::updateAll()
     {
       if(!(*rit).isNew)
       {
+        if(refiningSurface != -1)
+          loadingThread->stop(); // refining is restarted when the thread has stopped
         isoSurface->removeSurface(surfaceIndex);
         emit deletedSurface(surfaceIndex);
         somethingChanged = true;
@@ -367,7 +380,11 @@ void DensityBase::updateAll()
       surfaceProperties[i].type = typeToNum(it.current()->text(COLUMN_TYPE));
 
       if(levelChanged)
-        isoSurface->changeSurface(i, surfaceProperties[i].level); 
+      {
+        if(refiningSurface != -1)
+          loadingThread->stop(); // refining is restarted when the thread has stopped
+        isoSurface->changeSurface(i, surfaceProperties[i].level);
+      }
       if(levelChanged || colorChanged || opacityChanged || typeChanged)
       {       
         emit updatedSurface(i);
@@ -379,6 +396,7 @@ void DensityBase::updateAll()
   }
   if(somethingChanged)
     emit redrawScene();
+  startRefinement();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -394,7 +412,12 @@ void DensityBase::customEvent(QCustomEvent* e)
     updateProgress(*(static_cast<unsigned int*>(e->data())));
   ///// finish up after the thread has ended
   else if(e->type() == 1002)
-    updateDensity();
+  {
+    if(refiningSurface == -1)
+      updateDensity();
+    else
+      finishRefinement();
+  }
 }
 
 ///// showEvent /////////////////////////////////////////////////////////////
@@ -739,6 +762,34 @@ void DensityBase::updateOpacity()
     LabelOpacity->setText(" " + QString::number(SliderOpacity->value()) + " %");
 }
 
+///// updateRefinement ////////////////////////////////////////////////////////
+void DensityBase::updateRefinement(bool on)
+/// Starts refining the surfaces if on is true. Otherwise any running
+/// refinement is stopped and the refined surfaces are recalculated on the
+/// original grid.
+{
+  if(on)
+  {
+    startRefinement();
+    return;
+  }
+
+  if(refiningSurface != -1)
+    loadingThread->stop();
+  bool somethingChanged = false;
+  for(unsigned int i = 0; i < isoSurface->numSurfaces(); i++)
+  {
+    if(isoSurface->surfaceRefined(i))
+    {
+      isoSurface->changeSurface(i, surfaceProperties[i].level);
+      emit updatedSurface(i);
+      somethingChanged = true;
+    }
+  }
+  if(somethingChanged)
+    emit redrawScene();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Private Member Functions                                            /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -754,6 +805,7 @@ void DensityBase::makeConnections()
   connect(PushButtonAdd2, SIGNAL(clicked()), this, SLOT(addSurfacePair()));
   connect(PushButtonDelete, SIGNAL(clicked()), this, SLOT(deleteSurface()));
   connect(PushButtonUpdate, SIGNAL(clicked()), this, SLOT(updateAll()));
+  connect(CheckBoxRefine, SIGNAL(toggled(bool)), this, SLOT(updateRefinement(bool)));
   connect(PushButtonOK, SIGNAL(clicked()), this, SLOT(accept()));
   connect(PushButtonCancel, SIGNAL(clicked()), this, SLOT(reject()));
 
@@ -784,14 +836,19 @@ void DensityBase::loadDensity(const bool densityA)
   loadingDensityA = densityA;
 
   ///// get the filename of a cube file to open
-  QString dialogText = tr("Select a cube file for density ");
+  QString dialogText = tr("Select a cube or formatted checkpoint file for density ");
   if(densityA)
     dialogText += "A";
   else
     dialogText += "B";
-  QString filename = QFileDialog::getOpenFileName(QString::null, "Potdicht/Gaussian CUBE (*.cube)", this, 0, dialogText);
+  QString filename = QFileDialog::getOpenFileName(QString::null, "Potdicht/Gaussian CUBE (*.cube);;Gaussian formatted checkpoint (*.fchk *.fch)", this, 0, dialogText);
   if(filename.isEmpty())
     return;
+  if(filename.toLower().endsWith(".fchk") || filename.toLower().endsWith(".fch"))
+  {
+    evaluateOrbitals(filename);
+    return;
+  }
   QFile* file = new QFile(filename);
   if(!file->open(IO_ReadOnly))
   {
@@ -801,7 +858,6 @@ void DensityBase::loadDensity(const bool densityA)
   }
 
   ///// load the cube file
-  const double AUTOANG = 1.0/1.889726342;
   QTextStream* stream = new QTextStream(file);
   stream->readLine(); // ignore the first line
   newDescription = stream->readLine(); // the description of the type of density 
@@ -889,6 +945,89 @@ void DensityBase::loadDensity(const bool densityA)
   enableWidgets(); 
 }
 
+///// evaluateOrbitals ////////////////////////////////////////////////////////
+void DensityBase::evaluateOrbitals(const QString& filename)
+/// Evaluates an orbital or the total density from a Gaussian formatted
+/// checkpoint file on a grid encompassing the molecule. It is loaded into
+/// density A or B depending on loadingDensityA.
+{
+  ///// read the basis set and the orbitals
+  MolecularOrbitals* orbitals = new MolecularOrbitals();
+  if(!orbitals->load(filename))
+  {
+    delete orbitals;
+    QMessageBox::warning(this, tr("Load Density"), tr("Unable to read the basis set and the orbitals\nfrom the formatted checkpoint file"));
+    return;
+  }
+
+  ///// ask which orbital should be evaluated
+  QStringList listMO;
+  listMO << tr("Total density");
+  for(unsigned int i = 0; i < orbitals->numOrbitals(); i++)
+    listMO << orbitals->orbitalName(i);
+  bool ok;
+  const QString result = QInputDialog::getItem(tr("Select the desired MO"), tr("Select the total density or the desired\nmolecular orbital"), listMO, orbitals->homo() + 1, false, &ok, this);
+  if(!ok)
+  {
+    delete orbitals;
+    return;
+  }
+  const int orbital = listMO.indexOf(result) - 1; // the total density becomes -1
+  const double spacing = QInputDialog::getDouble(tr("Select the grid spacing"), tr("Grid spacing (Angstrom)"), 0.2, 0.02, 1.0, 3, &ok, this);
+  if(!ok)
+  {
+    delete orbitals;
+    return;
+  }
+
+  ///// set up the grid
+  Point3D<unsigned int> numPoints;
+  Point3D<double> origin;
+  orbitals->defaultGrid(spacing/AUTOANG, numPoints, origin);
+  const Point3D<double> delta(spacing/AUTOANG, spacing/AUTOANG, spacing/AUTOANG);
+  if(loadingDensityA)
+  {
+    numPointsA = numPoints;
+    originA.setValues(origin.x() * AUTOANG, origin.y() * AUTOANG, origin.z() * AUTOANG);
+    deltaA.setValues(spacing, spacing, spacing);
+  }
+  else
+  {
+    numPointsB = numPoints;
+    originB.setValues(origin.x() * AUTOANG, origin.y() * AUTOANG, origin.z() * AUTOANG);
+    deltaB.setValues(spacing, spacing, spacing);
+  }
+  if(orbital == MolecularOrbitals::TotalDensity)
+    newDescription = tr("Total density");
+  else
+    newDescription = orbitals->orbitalName(orbital);
+
+  ///// evaluate all density points in a DensityLoadThread
+  ///// (the orbitals are kept for refining the surfaces)
+  loadingOrbitals = orbitals;
+  loadingOrbitalIndex = orbital;
+  const unsigned int totalPoints = numPoints.x() * numPoints.y() * numPoints.z();
+  if(loadingDensityA)
+  {
+    ProgressBarA->setTotalSteps(totalPoints);
+    ProgressBarA->setProgress(0);
+    ProgressBarA->show();
+    LabelDensityA->hide();
+    loadingThread = new DensityLoadThread(&densityPointsA, loadingOrbitals, loadingOrbitalIndex, numPoints, origin, delta, this);
+  }
+  else
+  {
+    ProgressBarB->setTotalSteps(totalPoints);
+    ProgressBarB->setProgress(0);
+    ProgressBarB->show();
+    LabelDensityB->hide();
+    loadingThread = new DensityLoadThread(&densityPointsB, loadingOrbitals, loadingOrbitalIndex, numPoints, origin, delta, this);
+  }
+  loadingThread->start(QThread::LowPriority);
+
+  enableWidgets();
+}
+
 ///// updateDensity ///////////////////////////////////////////////////////////
 void DensityBase::updateDensity()
 /// Updates everything after a new density is loaded.
@@ -904,6 +1043,8 @@ void DensityBase::updateDensity()
   {
     delete loadingThread;
     loadingThread = 0;
+    delete loadingOrbitals;
+    loadingOrbitals = 0;
     enableWidgets();
     return;
   }
@@ -911,27 +1052,38 @@ void DensityBase::updateDensity()
   delete loadingThread;
   loadingThread = 0;
 
+  ///// replace the orbitals of the density (zero for a cube file)
+  MolecularOrbitals*& orbitals = loadingDensityA ? orbitalsA : orbitalsB;
+  delete orbitals;
+  orbitals = loadingOrbitals;
+  if(loadingDensityA)
+    orbitalIndexA = loadingOrbitalIndex;
+  else
+    orbitalIndexB = loadingOrbitalIndex;
+  loadingOrbitals = 0;
+
   ///// do not update if the number of points of the new density does not
   ///// equal the number of points of the other density
   if( (loadingDensityA && !densityPointsB.empty()) || (!loadingDensityA && !densityPointsA.empty())
       && !identicalGrids())
     QMessageBox::warning(this, tr("Load Density"), tr("The grid of the new density does not equal\nthat of the other density.\nCombinations will not be allowed."));
 
+  ///// (the progressbar is hidden first as updating might start refining)
   if(loadingDensityA)
   {
     ProgressBarA->setProgress(ProgressBarA->totalSteps());
-    updateOperation(1);
     LabelDensityA->setText(newDescription);
     ProgressBarA->hide();
     LabelDensityA->show();
+    updateOperation(1);
   }
   else
   {
     ProgressBarB->setProgress(ProgressBarB->totalSteps());
-    updateOperation(2);
     LabelDensityB->setText(newDescription);
     ProgressBarB->hide();
     LabelDensityB->show();
+    updateOperation(2);
   }
   enableWidgets();
 }
@@ -946,6 +1098,99 @@ void DensityBase::updateProgress(const unsigned int progress)
     ProgressBarB->setProgress(progress);
 }
 
+///// startRefinement /////////////////////////////////////////////////////////
+void DensityBase::startRefinement()
+/// Starts refining the first surface which isn't refined yet if this is
+/// requested and the current density was evaluated from orbitals. The points
+/// of the refined grid are evaluated in loadingThread, which reports its
+/// progress in the progressbar of the density.
+{
+  if(loadingThread != 0 || !CheckBoxRefine->isOn())
+    return;
+
+  MolecularOrbitals* orbitals = 0;
+  int orbital = 0;
+  if(ComboBoxOperation->currentItem() == 0)
+  {
+    orbitals = orbitalsA;
+    orbital = orbitalIndexA;
+  }
+  else if(ComboBoxOperation->currentItem() == 1)
+  {
+    orbitals = orbitalsB;
+    orbital = orbitalIndexB;
+  }
+  if(orbitals == 0)
+    return;
+
+  for(unsigned int i = 0; i < isoSurface->numSurfaces(); i++)
+  {
+    if(isoSurface->surfaceRefined(i) || !isoSurface->refinementPoints(i, refinementPoints))
+      continue;
+    for(std::vector<Point3D<double> >::iterator it = refinementPoints.begin(); it != refinementPoints.end(); it++)
+      it->setValues(it->x()/AUTOANG, it->y()/AUTOANG, it->z()/AUTOANG); // the orbitals are evaluated in atomic units
+
+    refiningSurface = i;
+    loadingDensityA = ComboBoxOperation->currentItem() == 0; // for updateProgress
+    if(loadingDensityA)
+    {
+      ProgressBarA->setTotalSteps(refinementPoints.size());
+      ProgressBarA->setProgress(0);
+      ProgressBarA->show();
+      LabelDensityA->hide();
+    }
+    else
+    {
+      ProgressBarB->setTotalSteps(refinementPoints.size());
+      ProgressBarB->setProgress(0);
+      ProgressBarB->show();
+      LabelDensityB->hide();
+    }
+    loadingThread = new DensityLoadThread(&refinementValues, orbitals, orbital, &refinementPoints, this);
+    loadingThread->start(QThread::LowPriority);
+    enableWidgets();
+    return;
+  }
+}
+
+///// finishRefinement ////////////////////////////////////////////////////////
+void DensityBase::finishRefinement()
+/// Updates the refined surface after loadingThread has finished and starts
+/// refining the next one. Nothing is updated if the thread was stopped.
+{
+  if(!loadingThread->finished())
+    loadingThread->wait(); // blocking wait
+
+  const bool success = loadingThread->success();
+  delete loadingThread;
+  loadingThread = 0;
+  const unsigned int surface = static_cast<unsigned int>(refiningSurface);
+  refiningSurface = -1;
+
+  if(success)
+  {
+    isoSurface->refineSurface(surface, refinementValues);
+    emit updatedSurface(surface);
+    emit redrawScene();
+  }
+  ///// release the memory
+  std::vector<Point3D<double> >().swap(refinementPoints);
+  std::vector<double>().swap(refinementValues);
+
+  if(loadingDensityA)
+  {
+    ProgressBarA->hide();
+    LabelDensityA->show();
+  }
+  else
+  {
+    ProgressBarB->hide();
+    LabelDensityB->show();
+  }
+  enableWidgets();
+  startRefinement();
+}
+
 ///// typeToNum ///////////////////////////////////////////////////////////////
 unsigned int DensityBase::typeToNum(const QString& type)
 /// Returns the number corresponding to a type string.
@@ -994,6 +1239,7 @@ void DensityBase::enableWidgets()
     PushButtonDelete->setEnabled(false);
     PushButtonUpdate->setEnabled(false);
     CheckBoxUpdate->setEnabled(false);
+    CheckBoxRefine->setEnabled(false);
     GroupBoxSettings->setEnabled(false);
   }
   else
@@ -1008,6 +1254,8 @@ void DensityBase::enableWidgets()
       PushButtonAdd2->setEnabled(true);
     PushButtonUpdate->setEnabled(true);
     CheckBoxUpdate->setEnabled(true);
+    ///// only enable refining for densities evaluated from orbitals
+    CheckBoxRefine->setEnabled((ComboBoxOperation->currentItem() == 0 && orbitalsA != 0) || (ComboBoxOperation->currentItem() == 1 && orbitalsB != 0));
     ///// enable/disable widgets that are only available when surfaces are defined
     if(ListViewParameters->childCount() != 0)
     {
@@ -1048,4 +1296,5 @@ bool DensityBase::identicalGrids()
 ///////////////////////////////////////////////////////////////////////////////
 
 const double DensityBase::deltaLevel = 0.001; 
+const double DensityBase::AUTOANG = 1.0/1.889726342;
 
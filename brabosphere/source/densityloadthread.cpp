@@ -18,6 +18,10 @@
 /*!
   \class DensityLoadThread
   \brief This class loads the density data for the class DensityBase.
+
+  The data is either read from a cube file or evaluated from the molecular
+  orbitals read from a formatted checkpoint file. The latter is done on a
+  grid or in a list of points, as needed for refining the surfaces.
 */
 /// \file
 /// Contains the implementation of the class DensityLoadThread.
@@ -36,6 +40,7 @@
 // Xbrabo header files
 #include "densitybase.h"
 #include "densityloadthread.h"
+#include "molecularorbitals.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 ///// Public Member Functions                                             /////
@@ -48,8 +53,11 @@ DensityLoadThread::DensityLoadThread(std::vector<double>* densityPoints, QTextSt
   numSkip(numSkipValues), 
   numValues(totalPoints),
   stopRequested(false),
-  parent(densityDialog) // according to GCC this one should be last to coincide with the declaration order
-                        // But now it doe'sn't anymore AFAICS
+  parent(densityDialog), // according to GCC this one should be last to coincide with the declaration order
+                         // But now it doe'sn't anymore AFAICS
+  molecularOrbitals(0),
+  orbitalIndex(0),
+  evaluationPoints(0)
 /// The default constructor.
 /// \param[out] densityPoints : the resulting density values read from file.
 /// \param[in] stream : the stream connected to an opened file.
@@ -62,6 +70,58 @@ DensityLoadThread::DensityLoadThread(std::vector<double>* densityPoints, QTextSt
   assert(parent != 0);
 }
 
+///// Constructor /////////////////////////////////////////////////////////////
+DensityLoadThread::DensityLoadThread(std::vector<double>* densityPoints, MolecularOrbitals* orbitals, const int orbital, const Point3D<unsigned int>& numPoints, const Point3D<double>& origin, const Point3D<double>& delta, DensityBase* densityDialog) : QThread(),
+  data(densityPoints),
+  textStream(0),
+  numSkip(0),
+  numValues(numPoints.x()*numPoints.y()*numPoints.z()),
+  stopRequested(false),
+  parent(densityDialog),
+  molecularOrbitals(orbitals),
+  orbitalIndex(orbital),
+  gridNumPoints(numPoints),
+  gridOrigin(origin),
+  gridDelta(delta),
+  evaluationPoints(0)
+/// The constructor for evaluating an orbital or the total density.
+/// \param[out] densityPoints : the resulting density values.
+/// \param[in] orbitals : the loaded orbitals.
+/// \param[in] orbital : the orbital to evaluate or MolecularOrbitals::TotalDensity.
+/// \param[in] numPoints : the number of points of the grid in each direction.
+/// \param[in] origin : the origin of the grid (bohr).
+/// \param[in] delta : the spacing of the grid (bohr).
+/// \param[in] densityDialog : the parent DensityBase widget were messages are sent to.
+{
+  assert(data != 0);
+  assert(molecularOrbitals != 0);
+  assert(parent != 0);
+}
+
+///// Constructor /////////////////////////////////////////////////////////////
+DensityLoadThread::DensityLoadThread(std::vector<double>* densityPoints, MolecularOrbitals* orbitals, const int orbital, const std::vector<Point3D<double> >* points, DensityBase* densityDialog) : QThread(),
+  data(densityPoints),
+  textStream(0),
+  numSkip(0),
+  numValues(points->size()),
+  stopRequested(false),
+  parent(densityDialog),
+  molecularOrbitals(orbitals),
+  orbitalIndex(orbital),
+  evaluationPoints(points)
+/// The constructor for evaluating an orbital or the total density in a list
+/// of points.
+/// \param[out] densityPoints : the resulting values.
+/// \param[in] orbitals : the loaded orbitals.
+/// \param[in] orbital : the orbital to evaluate or MolecularOrbitals::TotalDensity.
+/// \param[in] points : the points to evaluate (bohr). They should remain valid while the thread runs.
+/// \param[in] densityDialog : the parent DensityBase widget were messages are sent to.
+{
+  assert(data != 0);
+  assert(molecularOrbitals != 0);
+  assert(parent != 0);
+}
+
 ///// Destructor //////////////////////////////////////////////////////////////
 DensityLoadThread::~DensityLoadThread()
 /// The default destructor.
@@ -74,6 +134,18 @@ void DensityLoadThread::run()
 /// Does the actual reading after the proper parameters
 /// have been set. It is run with a call to start().
 {  
+  ///// evaluate the orbitals if present
+  if(molecularOrbitals != 0)
+  {
+    if(evaluationPoints != 0)
+      molecularOrbitals->evaluate(orbitalIndex, *evaluationPoints, *data, parent, &progress);
+    else
+      molecularOrbitals->evaluate(orbitalIndex, gridNumPoints, gridOrigin, gridDelta, *data, parent, &progress);
+    QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1002));
+    QApplication::postEvent(parent, e);
+    return;
+  }
+
   ///// get the QFile pointer from the stream
   QFile* file = dynamic_cast<QFile*>(textStream->device());
   assert(file != 0);
@@ -126,12 +198,15 @@ void DensityLoadThread::stop()
 /// Requests the thread to stop.
 {
   stopRequested = true;
+  if(molecularOrbitals != 0)
+    molecularOrbitals->stop();
 }
 
 ///// success /////////////////////////////////////////////////////////////////
 bool DensityLoadThread::success()
-/// Returns whether the desired number of points was succesfully read.  
+/// Returns whether the desired number of points was succesfully read and
+/// the thread was not stopped.
 {
-  return data->size() == numValues;
+  return !stopRequested && data->size() == numValues;
 }
 
@@ -62,7 +62,8 @@ GLMoleculeView::GLMoleculeView(AtomSet* atomset, QWidget* parent, const char* na
   atoms(atomset),
   densityDialog(NULL),
   newAtomDialog(NULL),
-  manipulateSelection(false)
+  manipulateSelection(false),
+  dragEditing(false)
 /// The default constructor.
 {
   isoSurface = new IsoSurface();
@@ -74,7 +75,7 @@ GLMoleculeView::~GLMoleculeView()
 {
   makeCurrent();
   for(unsigned int i = 0; i < glSurfaces.size(); i++)
-    glDeleteLists(glSurfaces[i], 1);
+    resizeChunkLists(glSurfaces[i], glSurfaceChunks[i], 0);
   delete isoSurface;
 }
 
@@ -119,6 +120,7 @@ void GLMoleculeView::alterCartesian()
   ///// run the dialog
   if(coords->exec() == QDialog::Accepted)
   {
+    atoms->beginEdit();
     if(coords->RadioButtonAbsolute->isChecked())
     {
       // absolute changes for one atom
@@ -156,6 +158,7 @@ void GLMoleculeView::alterCartesian()
         it++;
       }
     }
+    atoms->endEdit();
   }
   delete coords;
   setModified();
@@ -183,7 +186,11 @@ void GLMoleculeView::alterInternal()
       bool ok;
       double newLength = QInputDialog::getDouble("Xbrabo", tr("Change the distance between atoms ")+QString::number(atom1+1)+" and "+QString::number(atom2+1), bondLength, -1000.0, 1000.0, 4, &ok, this);
       if(ok && fabs(newLength - bondLength) > 0.00001)
+      {
+        atoms->beginEdit();
         atoms->changeBond(newLength - bondLength, atom1, atom2, true);
+        atoms->endEdit();
+      }
       else
         return; // no new value was entered
       break;
@@ -202,7 +209,11 @@ void GLMoleculeView::alterInternal()
       bool ok;
       double newAngle = QInputDialog::getDouble("Xbrabo", tr("Change the angle ")+QString::number(atom1+1)+"-"+QString::number(atom2+1)+"-"+QString::number(atom3+1), angle, -1000.0, 1000.0, 2, &ok, this);
       if(ok && fabs(newAngle - angle) > 0.001)
+      {
+        atoms->beginEdit();
         atoms->changeAngle(newAngle - angle, atom1, atom2, atom3, true);
+        atoms->endEdit();
+      }
       else
         return; // no new value was entered
       break;
@@ -223,7 +234,11 @@ void GLMoleculeView::alterInternal()
       bool ok;
       double newTorsion = QInputDialog::getDouble("Xbrabo", tr("Change the torsion angle ")+QString::number(atom1+1)+"-"+QString::number(atom2+1)+"-"+QString::number(atom3+1)+"-"+QString::number(atom4+1), torsion, -1000.0, 1000.0, 2, &ok, this);
       if(ok && fabs(newTorsion - torsion) > 0.001)
+      {
+        atoms->beginEdit();
         atoms->changeTorsion(torsion - newTorsion, atom1, atom2, atom3, atom4, true);
+        atoms->endEdit();
+      }
       else
         return; // no new value was entered
       break;
@@ -280,8 +295,10 @@ void GLMoleculeView::deleteSelectedAtoms()
   // sort it from largest to smallest
   std::sort(sortedList.begin(), sortedList.end(), std::greater<unsigned int>());
   // delete the atoms
+  atoms->beginEdit();
   for(unsigned int i = 0; i < sortedList.size(); i++)
     atoms->removeAtom(sortedList[i]);
+  atoms->endEdit();
   // clear the selection
   unselectAll();
   if(newAtomDialog != 0)
@@ -298,6 +315,26 @@ void GLMoleculeView::toggleSelection()
   manipulateSelection = !manipulateSelection;
 }
 
+///// undo ////////////////////////////////////////////////////////////////////
+void GLMoleculeView::undo()
+/// Reverts the last change to the atoms.
+{
+  const unsigned int oldCount = atoms->count();
+  if(!atoms->undo())
+    return;
+  updateAfterJournal(oldCount);
+}
+
+///// redo ////////////////////////////////////////////////////////////////////
+void GLMoleculeView::redo()
+/// Reapplies the last change to the atoms reverted by undo().
+{
+  const unsigned int oldCount = atoms->count();
+  if(!atoms->redo())
+    return;
+  updateAfterJournal(oldCount);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Protected Member Functions                                          /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -377,6 +414,7 @@ void GLMoleculeView::mouseMoveEvent(QMouseEvent* e)
   QPoint newPosition = e->pos();
   if(selectionType != SELECTION_NONE && e->state() & Qt::LeftButton && (manipulateSelection || e->state() & Qt::AltButton) && !(e->state() & Qt::ShiftButton && e->state() & Qt::ControlButton))
   {
+    beginDragEdit();
     ///// leftbutton mousemoves for manipulation of the selected atoms
     if(e->state() & Qt::ShiftButton)
     {
@@ -398,20 +436,44 @@ void GLMoleculeView::mouseMoveEvent(QMouseEvent* e)
                       -180.0 * static_cast<double>(newPosition.x() - mousePosition.x()) / static_cast<double>(width()), 0.0);
   }
   else if(selectionType >= SELECTION_BOND && selectionType <= SELECTION_TORSION && e->state() & Qt::LeftButton && e->state() & Qt::ShiftButton && e->state() & Qt::ControlButton)
+  {
     ///// LEFTBUTTON + SHIFT + CONTROL + horizontal movement: change selected internal coordinate
+    beginDragEdit();
     changeSelectedIC(e->pos().x() - mousePosition.x());
+  }
   else
     GLView::mouseMoveEvent(e); // normal manipulation of entire system
 
   mousePosition = newPosition;
 }
 
+///// mouseReleaseEvent ///////////////////////////////////////////////////////
+void GLMoleculeView::mouseReleaseEvent(QMouseEvent* e)
+/// Overridden from GLView::mouseReleaseEvent.
+/// Ends the group of changes made by dragging the selection.
+{
+  if(dragEditing)
+  {
+    dragEditing = false;
+    atoms->endEdit();
+  }
+  GLView::mouseReleaseEvent(e);
+}
+
 ///// keyPressEvent ///////////////////////////////////////////////////////////
 void GLMoleculeView::keyPressEvent(QKeyEvent* e)
 /// Overridden from GLSimpleMoleculeView::keyPressEvent. Handles key presses for manipulating
 /// selections.
 {
-  if(selectionType != SELECTION_NONE && (manipulateSelection || e->state() & Qt::AltButton) && !(e->state() & Qt::ShiftButton && e->state() & Qt::ControlButton))
+  if(e->key() == Qt::Key_Z && e->state() & Qt::ControlButton)
+  {
+    ///// CONTROL + Z: undo, CONTROL + SHIFT + Z: redo
+    if(e->state() & Qt::ShiftButton)
+      redo();
+    else
+      undo();
+  }
+  else if(selectionType != SELECTION_NONE && (manipulateSelection || e->state() & Qt::AltButton) && !(e->state() & Qt::ShiftButton && e->state() & Qt::ControlButton))
   {
     switch(e->key())
     {
@@ -495,12 +557,12 @@ void GLMoleculeView::updateShapes()
 
 ///// addGLSurface ////////////////////////////////////////////////////////////
 void GLMoleculeView::addGLSurface(const unsigned int index)
-/// Creates a display list for a new surface.
+/// Creates the display lists for a new surface.
 {
-  ///// generate a new display list and save it
-  makeCurrent();
-  GLuint newList = glGenLists(1);
-  glSurfaces.push_back(newList);
+  ///// the display lists are allocated by updateGLSurface
+  glSurfaces.push_back(0);
+  glSurfaceChunks.push_back(0);
+  glSurfaceBounds.push_back(std::vector<GLfloat>());
 
   ///// if this is the only surface and no atoms are present: zoomFit
   if(glSurfaces.size() == 1 && atoms->count() == 0)
@@ -513,68 +575,88 @@ void GLMoleculeView::addGLSurface(const unsigned int index)
 
 ///// updateGLSurface /////////////////////////////////////////////////////////
 void GLMoleculeView::updateGLSurface(const unsigned int index)
-/// Updates the display list for an existing surface.
+/// Updates the display lists for an existing surface. The surface is split
+/// into chunks of surfaceChunkSize triangles (or points) with their own
+/// display list and bounding box, so chunks outside the view can be skipped.
 {
   makeCurrent();
   QColor surfaceColor = densityDialog->surfaceColor(index);
   unsigned int surfaceOpacity = densityDialog->surfaceOpacity(index);
+  const unsigned int surfaceType = densityDialog->surfaceType(index);
   Point3D<float> point1, point2, point3, normal1, normal2, normal3;
 
   qDebug("updating surface %d", index);
   qDebug(" which consists of %d vertices and %d triangles",isoSurface->numVertices(index),isoSurface->numTriangles(index));
   qDebug(" with color %d, %d, %d and opacity %d", surfaceColor.red(), surfaceColor.green(), surfaceColor.blue(), surfaceOpacity);
-  glNewList(glSurfaces[index], GL_COMPILE);
-    switch(densityDialog->surfaceType(index))
+
+  const unsigned int numPrimitives = surfaceType == 2 ? isoSurface->numVertices(index) : isoSurface->numTriangles(index);
+  const unsigned int numChunks = (numPrimitives + surfaceChunkSize - 1)/surfaceChunkSize;
+  resizeChunkLists(glSurfaces[index], glSurfaceChunks[index], numChunks);
+  std::vector<GLfloat>& bounds = glSurfaceBounds[index];
+  bounds.resize(6*numChunks);
+  for(unsigned int chunk = 0; chunk < numChunks; chunk++)
+  {
+    const unsigned int first = chunk*surfaceChunkSize;
+    const unsigned int last = std::min(first + surfaceChunkSize, numPrimitives);
+    GLfloat* chunkBounds = &bounds[6*chunk];
+    for(unsigned int i = 0; i < 3; i++)
+    {
+      chunkBounds[i] = 1.0e30f;
+      chunkBounds[i + 3] = -1.0e30f;
+    }
+    glNewList(glSurfaces[index] + chunk, GL_COMPILE);
+    switch(surfaceType)
     {
       case 0: // Solid surface
         glBegin(GL_TRIANGLES);
           glColor4d(surfaceColor.red()/255.0, surfaceColor.green()/255.0, surfaceColor.blue()/255, surfaceOpacity/100.0);
-	        for(unsigned int i = 0; i < isoSurface->numTriangles(index); i++)
-	        {
+          for(unsigned int i = first; i < last; i++)
+          {
             isoSurface->getTriangle(index, i, point1, point2, point3, normal1, normal2, normal3);
-    		    glNormal3f(normal1.x(), normal1.y(), normal1.z());
+            glNormal3f(normal1.x(), normal1.y(), normal1.z());
             glVertex3f(point1.x(), point1.y(), point1.z());
-		        glNormal3f(normal2.x(), normal2.y(), normal2.z());
+            glNormal3f(normal2.x(), normal2.y(), normal2.z());
             glVertex3f(point2.x(), point2.y(), point2.z());
-		        glNormal3f(normal3.x(), normal3.y(), normal3.z());
+            glNormal3f(normal3.x(), normal3.y(), normal3.z());
             glVertex3f(point3.x(), point3.y(), point3.z());
-	        }
+            includePoint(chunkBounds, point1);
+            includePoint(chunkBounds, point2);
+            includePoint(chunkBounds, point3);
+          }
         glEnd();
         break;
       case 1: // Wireframe
-        //glLineWidth(1.0);
-        {
-          double lw, ps;
-          glGetDoublev(GL_LINE_WIDTH, &lw);
-          glGetDoublev(GL_POINT_SIZE, &ps);
-          qDebug("linewidth and pointsize used for generating: %f and %f", lw, ps);
-        }
         glBegin(GL_LINES);
           glColor3d(surfaceColor.red()/255.0, surfaceColor.green()/255.0, surfaceColor.blue()/255.0);
-	        for(unsigned int i = 0; i < isoSurface->numTriangles(index); i++)
-	        {
+          for(unsigned int i = first; i < last; i++)
+          {
             isoSurface->getTriangle(index, i, point1, point2, point3, normal1, normal2, normal3);
             glVertex3f(point1.x(), point1.y(), point1.z());
-		        glVertex3f(point2.x(), point2.y(), point2.z());
+            glVertex3f(point2.x(), point2.y(), point2.z());
             glVertex3f(point1.x(), point1.y(), point1.z());
             glVertex3f(point3.x(), point3.y(), point3.z());
-		        glVertex3f(point2.x(), point2.y(), point2.z());
+            glVertex3f(point2.x(), point2.y(), point2.z());
             glVertex3f(point3.x(), point3.y(), point3.z());
-	        }
+            includePoint(chunkBounds, point1);
+            includePoint(chunkBounds, point2);
+            includePoint(chunkBounds, point3);
+          }
         glEnd();
         break;
       case 2: // Dots
         glPointSize(1.0);
         glBegin(GL_POINTS);
           glColor3d(surfaceColor.red()/255.0, surfaceColor.green()/255.0, surfaceColor.blue()/255.0);
-	        for(unsigned int i = 0; i < isoSurface->numVertices(index); i++)
-	        {
+          for(unsigned int i = first; i < last; i++)
+          {
             point1 = isoSurface->getPoint(index, i);
             glVertex3f(point1.x(), point1.y(), point1.z());
+            includePoint(chunkBounds, point1);
           }
         glEnd();
     }
-  glEndList();
+    glEndList();
+  }
   reorderShapes();
 }
 
@@ -583,10 +665,10 @@ void GLMoleculeView::deleteGLSurface(const unsigned int index)
 /// Deletes the display list for an existing surface.
 {
   makeCurrent();
-  glDeleteLists(glSurfaces[index], 1);
-  std::vector<GLuint>::iterator it = glSurfaces.begin();
-  it += index;
-  glSurfaces.erase(it);
+  resizeChunkLists(glSurfaces[index], glSurfaceChunks[index], 0);
+  glSurfaces.erase(glSurfaces.begin() + index);
+  glSurfaceChunks.erase(glSurfaceChunks.begin() + index);
+  glSurfaceBounds.erase(glSurfaceBounds.begin() + index);
   reorderShapes();
 }
 
@@ -652,14 +734,11 @@ void GLMoleculeView::translateSelection(const int xRange, const int yRange, cons
   const double dy = y - atoms->y(*it);
   const double dz = z - atoms->z(*it);
 
-  // apply this translation vector to all selected atoms
-  while(it != selectionList.end())
-  {
-    atoms->setX(*it, atoms->x(*it) + dx);
-    atoms->setY(*it, atoms->y(*it) + dy);
-    atoms->setZ(*it, atoms->z(*it) + dz);
-    it++;
-  }
+  // apply this translation vector to all selected atoms at once
+  vector<unsigned int> selection(selectionList.begin(), selectionList.end());
+  atoms->beginEdit();
+  atoms->translateAtoms(selection, dx, dy, dz);
+  atoms->endEdit();
 
   updateAtomSet();
   setModified();
@@ -710,20 +789,18 @@ void GLMoleculeView::rotateSelection(const double angleX, const double angleY, c
   centerOfMass.setValues(centerOfMass.x()/selectionList.size(), centerOfMass.y()/selectionList.size(), centerOfMass.z()/selectionList.size());
   //qDebug("centerOfMass = %f, %f, %f", centerOfMass.x(), centerOfMass.y(), centerOfMass.z());
 
+  ///// combine the 3 successive rotations into a single one
+  Quaternion<double> backRotation(backAxis, backAngle);
+  Quaternion<double> rotation(axis, angle);
+  Quaternion<double> forwardRotation(backAxis, -backAngle);
+  Quaternion<double> localRotation = rotation * backRotation;
+  Quaternion<double> totalRotation = forwardRotation * localRotation;
+
   ///// rotate the atoms around this center
-  it = selectionList.begin();
-  while(it != selectionList.end())
-  {
-    Vector3D<double> v(centerOfMass, atoms->coordinates(*it));
-    //v.rotate(axis, angle);
-    v.rotate(backAxis, backAngle);
-    v.rotate(axis, angle);
-    v.rotate(backAxis, -backAngle);
-    atoms->setX(*it, centerOfMass.x() + v.x());
-    atoms->setY(*it, centerOfMass.y() + v.y());
-    atoms->setZ(*it, centerOfMass.z() + v.z());
-    it++;
-  }
+  vector<unsigned int> selection(selectionList.begin(), selectionList.end());
+  atoms->beginEdit();
+  atoms->rotateAtoms(selection, totalRotation, centerOfMass);
+  atoms->endEdit();
   updateAtomSet();
   setModified();
 }
@@ -738,6 +815,7 @@ void GLMoleculeView::changeSelectedIC(const int range)
 
   unsigned int atom1, atom2, atom3, atom4;
   std::list<unsigned int>::iterator it = selectionList.begin();
+  atoms->beginEdit();
   switch(selectionType)
   {
     case SELECTION_BOND:    atom1 = *it++;
@@ -757,8 +835,37 @@ void GLMoleculeView::changeSelectedIC(const int range)
                             atoms->changeTorsion(-180.0 * static_cast<double>(range) / static_cast<double>(width()), atom1, atom2, atom3, atom4, true);
                             break;
   }
+  atoms->endEdit();
+  updateAtomSet();
+  setModified();
+}
+
+///// beginDragEdit ///////////////////////////////////////////////////////////
+void GLMoleculeView::beginDragEdit()
+/// Starts a group of changes for a mouse drag if none is active yet, so the
+/// whole drag can be undone at once.
+{
+  if(dragEditing)
+    return;
+  dragEditing = true;
+  atoms->beginEdit();
+}
+
+///// updateAfterJournal //////////////////////////////////////////////////////
+void GLMoleculeView::updateAfterJournal(const unsigned int oldCount)
+/// Updates the view after an undo or redo. The selection is cleared if the
+/// number of atoms changed as its indices might not be valid anymore.
+{
+  if(atoms->count() != oldCount)
+  {
+    unselectAll();
+    if(newAtomDialog != 0)
+      newAtomDialog->updateAtomLimits();
+  }
   updateAtomSet();
   setModified();
+  if(atoms->count() != oldCount)
+    emit atomsetChanged();
 }
 
 ///// drawItem ////////////////////////////////////////////////////////////////
@@ -774,16 +881,36 @@ void GLMoleculeView::drawItem(const unsigned int index)
 
   if(densityDialog->surfaceVisible(currentSurface))
   {
-    if(densityDialog->surfaceType(currentSurface) == 0)
-    {
-      glCallList(glSurfaces[currentSurface]);
-    }
-    else
-    {
+    ///// only the chunks inside the view are drawn
+    std::vector<unsigned int> ranges;
+    visibleChunks(glSurfaceBounds[currentSurface], ranges);
+    const bool lighting = densityDialog->surfaceType(currentSurface) == 0;
+    if(!lighting)
       glDisable(GL_LIGHTING);
-      glCallList(glSurfaces[currentSurface]);
+    for(unsigned int i = 0; i < ranges.size(); i += 2)
+      for(unsigned int chunk = ranges[i]; chunk < ranges[i + 1]; chunk++)
+        glCallList(glSurfaces[currentSurface] + chunk);
+    if(!lighting)
       glEnable(GL_LIGHTING);
-    }
   }
 }
 
+///// includePoint ////////////////////////////////////////////////////////////
+void GLMoleculeView::includePoint(GLfloat* bounds, const Point3D<float>& point)
+/// Extends the bounding box (minimum x, y, z, maximum x, y, z) to include
+/// the point.
+{
+  bounds[0] = std::min(bounds[0], point.x());
+  bounds[1] = std::min(bounds[1], point.y());
+  bounds[2] = std::min(bounds[2], point.z());
+  bounds[3] = std::max(bounds[3], point.x());
+  bounds[4] = std::max(bounds[4], point.y());
+  bounds[5] = std::max(bounds[5], point.z());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Static Variables                                                    /////
+///////////////////////////////////////////////////////////////////////////////
+
+const unsigned int GLMoleculeView::surfaceChunkSize = 4096;
+
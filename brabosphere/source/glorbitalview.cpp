@@ -37,6 +37,7 @@
 #include <qapplication.h>
 #include <qcolor.h>
 #include <qfiledialog.h>
+#include <qglbuffer.h>
 #include <qimage.h>
 #include <qmessagebox.h>
 #include <qprogressdialog.h>
@@ -56,18 +57,26 @@
 GLOrbitalView::GLOrbitalView(QWidget* parent, const char* name) : GLView(parent, name),
   colorPositive(QColor(0, 0, 255)),
   colorNegative(QColor(255, 0, 0)),
+  buffersChecked(false),
   maximumRadius(1.0f),
   scaleFactor(1.0f)
 /// The default constructor.
 {
-
+  for(unsigned int phase = 0; phase < 2; phase++)
+  {
+    phaseBuffers[phase] = 0;
+    bufferCapacity[phase] = 0;
+    bufferSize[phase] = 0;
+  }
 }
 
 ///// destructor //////////////////////////////////////////////////////////////
 GLOrbitalView::~GLOrbitalView()
 /// The default destructor.
 {
-  
+  makeCurrent();
+  delete phaseBuffers[0];
+  delete phaseBuffers[1];
 }
 
 ///// updateColors ////////////////////////////////////////////////////////////
@@ -78,18 +87,44 @@ void GLOrbitalView::updateColors(QColor pos, QColor neg)
   colorNegative = neg;
 }
 
-///// getCoordinates //////////////////////////////////////////////////////////
-std::vector<Point3D<float> >* GLOrbitalView::getCoordinates()
-/// Returns a pointer to the coords vector.
+///// getStream ///////////////////////////////////////////////////////////////
+PointStream* GLOrbitalView::getStream()
+/// Returns a pointer to the stream the calculated coordinates should be
+/// published to.
 {
-  return &coords;
+  return &stream;
 }
 
-///// getMutex ////////////////////////////////////////////////////////////////
-QMutex* GLOrbitalView::getMutex()
-/// Returns a pointer to the mutex used for accessing the coords vector.
+///// clearPoints /////////////////////////////////////////////////////////////
+void GLOrbitalView::clearPoints()
+/// Removes all points. No calculation may be publishing to the stream.
 {
-  return &mutex;
+  stream.clear();
+  for(unsigned int phase = 0; phase < 2; phase++)
+  {
+    phaseCoords[phase].clear();
+    bufferSize[phase] = 0; // keep the allocated buffers for the next calculation
+  }
+}
+
+///// getPoints ///////////////////////////////////////////////////////////////
+void GLOrbitalView::getPoints(std::vector<GLfloat>& negative, std::vector<GLfloat>& positive)
+/// Returns the coordinates of the points of the negative and the positive
+/// phase, including those not drawn yet.
+{
+  readStream();
+  negative = phaseCoords[0];
+  positive = phaseCoords[1];
+}
+
+///// setPoints ///////////////////////////////////////////////////////////////
+void GLOrbitalView::setPoints(const std::vector<GLfloat>& negative, const std::vector<GLfloat>& positive)
+/// Replaces all points by the given coordinates of the negative and the
+/// positive phase. No calculation may be publishing to the stream.
+{
+  clearPoints();
+  phaseCoords[0] = negative;
+  phaseCoords[1] = positive;
 }
 
 ///// setMaximumRadius ////////////////////////////////////////////////////////
@@ -204,25 +239,53 @@ void GLOrbitalView::drawScene()
   // scale if the boundaries exceed 100.0f (the far z-value)
   glScalef(scaleFactor, scaleFactor, scaleFactor);
   
+  ///// create the vertex buffers once a context is current
+  if(!buffersChecked)
+  {
+    buffersChecked = true;
+    for(unsigned int phase = 0; phase < 2; phase++)
+    {
+      phaseBuffers[phase] = new QGLBuffer(QGLBuffer::VertexBuffer);
+      phaseBuffers[phase]->setUsagePattern(QGLBuffer::DynamicDraw);
+      if(!phaseBuffers[phase]->create())
+      {
+        // no vertex buffer objects: draw from client memory
+        delete phaseBuffers[phase];
+        phaseBuffers[phase] = 0;
+      }
+    }
+  }
+
+  ///// sort the points published since the last frame by phase
+  readStream();
+
   //*  
   ///// draw the precalculated isoprobability points
   glDisable(GL_LIGHTING);
 
-  glBegin(GL_POINTS);
-    mutex.lock();
-    std::vector<Point3D<float> >::iterator it = coords.begin();
-    while(it != coords.end())
+  glEnableClientState(GL_VERTEX_ARRAY);
+  for(unsigned int phase = 0; phase < 2; phase++)
+  {
+    if(phaseCoords[phase].empty())
+      continue;
+    qglColor(phase == 1 ? colorPositive : colorNegative);
+    if(phaseBuffers[phase] != 0)
     {
-      if(it->id() == 1)
-        qglColor(colorPositive);
-      else
-        qglColor(colorNegative);
-      glVertex3f(it->x(), it->y(), it->z());
-      it++;
+      uploadPoints(phase);
+      phaseBuffers[phase]->bind();
+      glVertexPointer(3, GL_FLOAT, 0, 0);
+      glDrawArrays(GL_POINTS, 0, phaseCoords[phase].size()/3);
+      phaseBuffers[phase]->release();
     }
-    mutex.unlock();
-  glEnd();
-  // no use in making a display list as the coordinates might be updated at any time
+    else
+    {
+      glVertexPointer(3, GL_FLOAT, 0, &phaseCoords[phase][0]);
+      glDrawArrays(GL_POINTS, 0, phaseCoords[phase].size()/3);
+    }
+  }
+  glDisableClientState(GL_VERTEX_ARRAY);
+  // no use in making a display list as the coordinates might be updated at any time,
+  // only the new points are uploaded to the vertex buffers
 
   /*// lines
   glBegin(GL_LINE_LOOP);
@@ -341,3 +404,47 @@ float GLOrbitalView::boundingSphereRadius()
   return static_cast<float>(maximumRadius*scaleFactor); 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///// Private Member Functions                                            /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// readStream //////////////////////////////////////////////////////////////
+void GLOrbitalView::readStream()
+/// Sorts the points published to the stream since the last call by phase.
+{
+  if(stream.read(newCoords) == 0)
+    return;
+
+  for(std::vector<Point3D<float> >::iterator it = newCoords.begin(); it != newCoords.end(); it++)
+  {
+    std::vector<GLfloat>& coords = phaseCoords[it->id() == 1 ? 1 : 0];
+    coords.push_back(it->x());
+    coords.push_back(it->y());
+    coords.push_back(it->z());
+  }
+  newCoords.clear();
+}
+
+///// uploadPoints ////////////////////////////////////////////////////////////
+void GLOrbitalView::uploadPoints(const unsigned int phase)
+/// Uploads the coordinates of the given phase which are not in its vertex
+/// buffer yet. The buffer only grows: when the points don't fit anymore it is
+/// reallocated at twice the needed size and filled again.
+{
+  const int numBytes = static_cast<int>(phaseCoords[phase].size()*sizeof(GLfloat));
+  if(numBytes == bufferSize[phase])
+    return;
+
+  QGLBuffer* buffer = phaseBuffers[phase];
+  buffer->bind();
+  if(numBytes > bufferCapacity[phase])
+  {
+    bufferCapacity[phase] = 2*numBytes;
+    buffer->allocate(bufferCapacity[phase]);
+    bufferSize[phase] = 0;
+  }
+  buffer->write(bufferSize[phase], &phaseCoords[phase][bufferSize[phase]/sizeof(GLfloat)], numBytes - bufferSize[phase]);
+  buffer->release();
+  bufferSize[phase] = numBytes;
+}
+
@@ -27,12 +27,22 @@
   'Marching Cubes' algorithm (patented!). The class stores the density points
   and an unlimited number of isosurfaces generated from them. Individual surfaces
   can be added, changed and removed.
+
+  A surface can be recalculated on a refined grid if the density can be
+  evaluated in arbitrary points. refinementPoints subdivides the cells crossed
+  by the surface and their neighbours and returns the new points of these
+  cells. The refinement factor is chosen such that at most maxRefinedSamples
+  points are used. The values in these points are then passed to
+  refineSurface. Only features of the density found on the original grid or
+  within one cell of it are refined: where the refined surface leaves the
+  refined cells, it is left open.
 */
 /// \file
 /// Contains the implementation of the class IsoSurface
 
 ///// Header files ////////////////////////////////////////////////////////////
 // C++ header files
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -45,7 +55,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 ///// constructor /////////////////////////////////////////////////////////////
-IsoSurface::IsoSurface()
+IsoSurface::IsoSurface() :
+  refinedLevel(0.0),
+  refinedFactor(0)
 /// The default constructor.
 {
 
@@ -82,6 +94,7 @@ void IsoSurface::addSurface(const double isoDensity)
 /// The surface is added to the list of surfaces.
 {
   isoLevels.push_back(isoDensity);
+  refinedSurfaces.push_back(false);
   calculateSurface(isoDensity);
 
   // renaming
@@ -105,11 +118,150 @@ void IsoSurface::changeSurface(const unsigned int surface, const double isoDensi
     return;
 
   isoLevels[surface] = isoDensity;
+  refinedSurfaces[surface] = false;
   calculateSurface(isoDensity);
   renameVerticesAndTriangles(verticesList[surface], triangleIndices[surface]);
   calculateNormals(normals[surface], surface);
 }
 
+///// refinementPoints ////////////////////////////////////////////////////////
+bool IsoSurface::refinementPoints(const unsigned int surface, vector<Point3D<double> >& points)
+/// Sets up the refined grid for a surface and returns the points (in the
+/// units of the grid) in which the density should be evaluated. Only the cells
+/// crossed by the surface on the original grid and their neighbours are
+/// refined and only their points which are not on the original grid are
+/// returned. The values in these points should be passed in the same order to
+/// refineSurface. Returns false if the surface cannot be refined.
+{
+  points.clear();
+  refinedCells.clear();
+  refinedIndices.clear();
+  if(surface >= numSurfaces() || numPoints.x() < 2 || numPoints.y() < 2 || numPoints.z() < 2)
+    return false;
+  const unsigned int cellsX = numPoints.x() - 1;
+  const unsigned int cellsY = numPoints.y() - 1;
+  const unsigned int cellsZ = numPoints.z() - 1;
+  refinedLevel = isoLevels[surface];
+
+  ///// mark the cells crossed by the surface
+  vector<bool> crossed(cellsX*cellsY*cellsZ, false);
+  for(unsigned int x = 0; x < cellsX; x++)
+    for(unsigned int y = 0; y < cellsY; y++)
+      for(unsigned int z = 0; z < cellsZ; z++)
+      {
+        unsigned int numBelow = 0;
+        for(unsigned int c = 0; c < 8; c++)
+          if(densityValues[getArrayIndex(x + cornerOffsets[c][0], y + cornerOffsets[c][1], z + cornerOffsets[c][2])] < refinedLevel)
+            numBelow++;
+        crossed[(x*cellsY + y)*cellsZ + z] = numBelow != 0 && numBelow != 8;
+      }
+
+  ///// also refine their neighbours to catch the parts of the surface
+  ///// which pass between the original points
+  vector<bool> marked(crossed.size(), false);
+  for(unsigned int x = 0; x < cellsX; x++)
+    for(unsigned int y = 0; y < cellsY; y++)
+      for(unsigned int z = 0; z < cellsZ; z++)
+      {
+        if(!crossed[(x*cellsY + y)*cellsZ + z])
+          continue;
+        for(unsigned int nx = (x > 0 ? x - 1 : 0); nx <= x + 1 && nx < cellsX; nx++)
+          for(unsigned int ny = (y > 0 ? y - 1 : 0); ny <= y + 1 && ny < cellsY; ny++)
+            for(unsigned int nz = (z > 0 ? z - 1 : 0); nz <= z + 1 && nz < cellsZ; nz++)
+              marked[(nx*cellsY + ny)*cellsZ + nz] = true;
+      }
+  crossed.clear();
+  for(unsigned int i = 0; i < marked.size(); i++)
+    if(marked[i])
+      refinedCells.push_back(i);
+  marked.clear();
+  if(refinedCells.empty())
+    return false; // no surface at all
+
+  refinedFactor = refinementFactor(refinedCells.size());
+  if(refinedFactor < 2)
+  {
+    refinedCells.clear();
+    return false;
+  }
+  refinedNumPoints.setValues(cellsX*refinedFactor + 1, cellsY*refinedFactor + 1, cellsZ*refinedFactor + 1);
+  const Point3D<float> refinedDelta(delta.x()/refinedFactor, delta.y()/refinedFactor, delta.z()/refinedFactor);
+
+  ///// collect the points of the refined cells
+  refinedIndices.reserve(refinedCells.size()*(refinedFactor + 1)*(refinedFactor + 1)*(refinedFactor + 1));
+  for(vector<unsigned int>::const_iterator it = refinedCells.begin(); it != refinedCells.end(); it++)
+  {
+    const unsigned int x = *it/(cellsY*cellsZ)*refinedFactor;
+    const unsigned int y = *it/cellsZ % cellsY*refinedFactor;
+    const unsigned int z = *it % cellsZ*refinedFactor;
+    for(unsigned int fx = 0; fx <= refinedFactor; fx++)
+      for(unsigned int fy = 0; fy <= refinedFactor; fy++)
+        for(unsigned int fz = 0; fz <= refinedFactor; fz++)
+          refinedIndices.push_back(getRefinedArrayIndex(x + fx, y + fy, z + fz));
+  }
+  std::sort(refinedIndices.begin(), refinedIndices.end());
+  refinedIndices.erase(std::unique(refinedIndices.begin(), refinedIndices.end()), refinedIndices.end());
+
+  ///// return the ones not on the original grid
+  points.reserve(refinedIndices.size());
+  for(vector<unsigned int>::const_iterator it = refinedIndices.begin(); it != refinedIndices.end(); it++)
+  {
+    const unsigned int x = *it/(refinedNumPoints.y()*refinedNumPoints.z());
+    const unsigned int y = *it/refinedNumPoints.z() % refinedNumPoints.y();
+    const unsigned int z = *it % refinedNumPoints.z();
+    if(x % refinedFactor == 0 && y % refinedFactor == 0 && z % refinedFactor == 0)
+      continue;
+    points.push_back(Point3D<double>(origin.x() + x*refinedDelta.x(),
+                                     origin.y() + y*refinedDelta.y(),
+                                     origin.z() + z*refinedDelta.z()));
+  }
+  return true;
+}
+
+///// refineSurface ///////////////////////////////////////////////////////////
+void IsoSurface::refineSurface(const unsigned int surface, const vector<double>& values)
+/// Recalculates a surface on the refined grid set up by the last call to
+/// refinementPoints, given the values in the points it returned. The values
+/// in the points of the original grid are reused. Nothing is done if the
+/// refined grid was not set up for this surface.
+{
+  if(surface >= numSurfaces() || refinedCells.empty() || isoLevels[surface] != refinedLevel)
+    return;
+
+  ///// combine the values with the ones on the original grid
+  refinedValues.clear();
+  refinedValues.reserve(refinedIndices.size());
+  vector<double>::const_iterator itValue = values.begin();
+  for(vector<unsigned int>::const_iterator it = refinedIndices.begin(); it != refinedIndices.end(); it++)
+  {
+    const unsigned int x = *it/(refinedNumPoints.y()*refinedNumPoints.z());
+    const unsigned int y = *it/refinedNumPoints.z() % refinedNumPoints.y();
+    const unsigned int z = *it % refinedNumPoints.z();
+    if(x % refinedFactor == 0 && y % refinedFactor == 0 && z % refinedFactor == 0)
+      refinedValues.push_back(densityValues[getArrayIndex(x/refinedFactor, y/refinedFactor, z/refinedFactor)]);
+    else if(itValue != values.end())
+      refinedValues.push_back(*itValue++);
+    else
+      break;
+  }
+  if(refinedValues.size() != refinedIndices.size() || itValue != values.end())
+  {
+    refinedValues.clear();
+    return; // the values don't belong to this grid
+  }
+
+  currentIsoLevel = refinedLevel;
+  vertices.clear();
+  triangles.clear();
+  calculateRefinedSurface();
+  renameVerticesAndTriangles(verticesList[surface], triangleIndices[surface]);
+  calculateNormals(normals[surface], surface);
+  refinedSurfaces[surface] = true;
+
+  refinedCells.clear();
+  refinedIndices.clear();
+  refinedValues.clear();
+}
 ///// densityPresent //////////////////////////////////////////////////////////
 bool IsoSurface::densityPresent() const
 /// Returns whether a density is loaded and parameters are set.
@@ -144,6 +296,16 @@ unsigned int IsoSurface::numVertices(const unsigned int surface) const
   return verticesList[surface]->size();
 }
 
+///// surfaceRefined //////////////////////////////////////////////////////////
+bool IsoSurface::surfaceRefined(const unsigned int surface) const
+/// Returns whether a surface was calculated on a refined grid.
+{
+  if(surface >= numSurfaces())
+    return false;
+
+  return refinedSurfaces[surface];
+}
+
 ///// getTriangle /////////////////////////////////////////////////////////////
 void IsoSurface::getTriangle(const unsigned int surface, const unsigned int index, Point3D<float>& point1, Point3D<float>& point2, Point3D<float>& point3, Point3D<float>& normal1, Point3D<float>& normal2, Point3D<float>& normal3) const
 /// Returns the data for a triangle on a specified surface.
@@ -214,6 +376,8 @@ void IsoSurface::clearParameters()
 {
   clearSurfaces();
   densityValues.clear();
+  refinedCells.clear();
+  refinedIndices.clear();
 }
 
 ///// clearSurfaces ///////////////////////////////////////////////////////////
@@ -227,6 +391,7 @@ void IsoSurface::clearSurfaces()
     delete normals[i];
   }
   isoLevels.clear();
+  refinedSurfaces.clear();
   verticesList.clear();
   triangleIndices.clear();
   normals.clear();
@@ -254,6 +419,9 @@ void IsoSurface::removeSurface(const unsigned int surface)
   vector<double>::iterator iti = isoLevels.begin();
   iti += surface;
   isoLevels.erase(iti);
+  vector<bool>::iterator itr = refinedSurfaces.begin();
+  itr += surface;
+  refinedSurfaces.erase(itr);
 }
 
 ///// getOrigin ///////////////////////////////////////////////////////////////
@@ -419,6 +587,111 @@ void IsoSurface::calculateSurface(const double isoDensity)
 	    }
 }
 
+///// calculateRefinedSurface /////////////////////////////////////////////////
+void IsoSurface::calculateRefinedSurface()
+/// Calculates the isosurface for currentIsoLevel on the refined grid set up by
+/// refinementPoints, using the values in refinedValues.
+{
+  const unsigned int cellsY = numPoints.y() - 1;
+  const unsigned int cellsZ = numPoints.z() - 1;
+  const Point3D<float> refinedDelta(delta.x()/refinedFactor, delta.y()/refinedFactor, delta.z()/refinedFactor);
+
+  for(vector<unsigned int>::const_iterator it = refinedCells.begin(); it != refinedCells.end(); it++)
+  {
+    const unsigned int cellX = *it/(cellsY*cellsZ)*refinedFactor;
+    const unsigned int cellY = *it/cellsZ % cellsY*refinedFactor;
+    const unsigned int cellZ = *it % cellsZ*refinedFactor;
+    for(unsigned int x = cellX; x < cellX + refinedFactor; x++)
+      for(unsigned int y = cellY; y < cellY + refinedFactor; y++)
+        for(unsigned int z = cellZ; z < cellZ + refinedFactor; z++)
+        {
+          double values[8];
+          unsigned int tableIndex = 0;
+          for(unsigned int c = 0; c < 8; c++)
+          {
+            values[c] = refinedValue(x + cornerOffsets[c][0], y + cornerOffsets[c][1], z + cornerOffsets[c][2]);
+            if(values[c] < currentIsoLevel)
+              tableIndex |= 1 << c;
+          }
+          if(edgeTable[tableIndex] == 0)
+            continue;
+
+          ///// the intersections with the edges not yet done by a neighbouring cell
+          for(unsigned int edge = 0; edge < 12; edge++)
+          {
+            if(!(edgeTable[tableIndex] & (1 << edge)))
+              continue;
+            const unsigned int id = getRefinedEdgeID(x, y, z, edge);
+            if(vertices.find(id) != vertices.end())
+              continue;
+            const unsigned int* corner1 = cornerOffsets[edgeCorners[edge][0]];
+            const unsigned int* corner2 = cornerOffsets[edgeCorners[edge][1]];
+            Point3D<float> point1((x + corner1[0])*refinedDelta.x(), (y + corner1[1])*refinedDelta.y(), (z + corner1[2])*refinedDelta.z());
+            Point3D<float> point2((x + corner2[0])*refinedDelta.x(), (y + corner2[1])*refinedDelta.y(), (z + corner2[2])*refinedDelta.z());
+            vertices.insert(std::map<unsigned int, Point3D<float> >::value_type(id, interpolate(point1, point2, values[edgeCorners[edge][0]], values[edgeCorners[edge][1]])));
+          }
+
+          for(unsigned int i = 0; triTable[tableIndex][i] != -1; i += 3)
+          {
+            Triangle triangle;
+            triangle.pointID[0] = getRefinedEdgeID(x, y, z, triTable[tableIndex][i]);
+            triangle.pointID[1] = getRefinedEdgeID(x, y, z, triTable[tableIndex][i+1]);
+            triangle.pointID[2] = getRefinedEdgeID(x, y, z, triTable[tableIndex][i+2]);
+            triangles.push_back(triangle);
+          }
+        }
+  }
+}
+
+///// refinementFactor ////////////////////////////////////////////////////////
+unsigned int IsoSurface::refinementFactor(const unsigned int numCells) const
+/// Returns the largest refinement factor up to maxRefinement for which the
+/// given number of cells needs at most maxRefinedSamples points and for which
+/// the edge ID's of the refined grid still fit into an unsigned int.
+{
+  unsigned int factor = maxRefinement;
+  while(factor > 1)
+  {
+    const double numSamples = static_cast<double>(numCells)*factor*factor*factor;
+    const double numEdges = 3.0*((numPoints.x() - 1)*factor + 1)*((numPoints.y() - 1)*factor + 1)*((numPoints.z() - 1)*factor + 1);
+    if(numSamples <= maxRefinedSamples && numEdges < static_cast<double>(static_cast<unsigned int>(-1)))
+      break;
+    factor--;
+  }
+  return factor;
+}
+
+///// refinedValue ////////////////////////////////////////////////////////////
+double IsoSurface::refinedValue(const unsigned int x, const unsigned int y, const unsigned int z) const
+/// Returns the evaluated value in a point of the refined grid.
+{
+  vector<unsigned int>::const_iterator it = std::lower_bound(refinedIndices.begin(), refinedIndices.end(), getRefinedArrayIndex(x, y, z));
+  assert(it != refinedIndices.end() && *it == getRefinedArrayIndex(x, y, z));
+  return refinedValues[it - refinedIndices.begin()];
+}
+
+///// getRefinedEdgeID ////////////////////////////////////////////////////////
+unsigned int IsoSurface::getRefinedEdgeID(const unsigned int x, const unsigned int y, const unsigned int z, const unsigned int edge) const
+/// Returns the ID of an edge of the refined grid. As for getEdgeID, it is
+/// 3 times the index of the lowest corner plus the direction of the edge.
+{
+  const unsigned int* corner1 = cornerOffsets[edgeCorners[edge][0]];
+  const unsigned int* corner2 = cornerOffsets[edgeCorners[edge][1]];
+  unsigned int direction = 2;
+  if(corner1[0] != corner2[0])
+    direction = 0;
+  else if(corner1[1] != corner2[1])
+    direction = 1;
+  return 3*getRefinedArrayIndex(x + std::min(corner1[0], corner2[0]), y + std::min(corner1[1], corner2[1]), z + std::min(corner1[2], corner2[2])) + direction;
+}
+
+///// getRefinedArrayIndex ////////////////////////////////////////////////////
+unsigned int IsoSurface::getRefinedArrayIndex(const unsigned int x, const unsigned int y, const unsigned int z) const
+/// Determines the index of a point of the refined grid.
+{
+  return x*refinedNumPoints.y()*refinedNumPoints.z() + y*refinedNumPoints.z() + z;
+}
+
 ///// intersection ////////////////////////////////////////////////////////////
 Point3D<float> IsoSurface::intersection(const unsigned int x, const unsigned int y, const unsigned int z, const unsigned int edge)
 /// Calculates the intersection point.
@@ -913,3 +1186,13 @@ const int IsoSurface::triTable[256][16] =
   {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
 };
 
+const unsigned int IsoSurface::cornerOffsets[8][3] = {
+  {0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}, {0, 0, 1}, {0, 1, 1}, {1, 1, 1}, {1, 0, 1}
+};
+
+const unsigned int IsoSurface::edgeCorners[12][2] = {
+  {0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6}, {6, 7}, {7, 4}, {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
+const unsigned int IsoSurface::maxRefinement = 4;
+const double IsoSurface::maxRefinedSamples = 4.0e6;
@@ -0,0 +1,782 @@
+/***************************************************************************
+                    molecularorbitals.cpp  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+///// Comments ////////////////////////////////////////////////////////////////
+
+/*!
+  \class MolecularOrbitals
+  \brief Evaluates molecular orbitals and the electron density from a Gaussian basis set.
+
+  The basis set and the MO coefficients are read from a Gaussian formatted
+  checkpoint file (.fchk). Shells up to g functions are supported, both
+  cartesian and pure. All values are in atomic units.
+
+  Orbitals or the total density are evaluated on a grid or in a list of
+  points by a number of MolecularOrbitalsWorker threads, each doing every
+  stride'th plane or block of points. Every
+  shell has a cutoff radius beyond which all its functions are smaller than
+  screeningThreshold. For each row of the grid only the shells reaching that
+  row are considered and for each point only those reaching the point are
+  evaluated.
+
+*/
+/// \file
+/// Contains the implementation of the class MolecularOrbitals.
+
+///// Header files ////////////////////////////////////////////////////////////
+
+// C++ header files
+#include <cassert>
+#include <cmath>
+
+// Qt header files
+#include <qapplication.h>
+#include <qevent.h>
+#include <qfile.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qtextstream.h>
+
+// Xbrabo header files
+#include "molecularorbitals.h"
+
+///////////////////////////////////////////////////////////////////////////////
+///// Public Member Functions                                             /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// Constructor /////////////////////////////////////////////////////////////
+MolecularOrbitals::MolecularOrbitals() :
+  numBasisFunctions(0),
+  numOrbitalsPerSpin(0),
+  numAlpha(0),
+  numBeta(0),
+  stopRequested(false),
+  gridOrbital(TotalDensity),
+  gridPoints(0),
+  gridValues(0)
+/// The default constructor.
+{
+
+}
+
+///// Destructor //////////////////////////////////////////////////////////////
+MolecularOrbitals::~MolecularOrbitals()
+/// The default destructor.
+{
+
+}
+
+///// load ////////////////////////////////////////////////////////////////////
+bool MolecularOrbitals::load(const QString& filename)
+/// Reads the basis set and the MO coefficients from a Gaussian formatted
+/// checkpoint file. Returns false if the file could not be read or contains
+/// unsupported shells.
+{
+  clear();
+
+  QFile file(filename);
+  if(!file.open(IO_ReadOnly))
+    return false;
+  QTextStream stream(&file);
+
+  std::vector<double> coordinates, shellTypes, primitivesPerShell, exponents, contractions, contractionsP, shellCoordinates;
+  while(!stream.atEnd())
+  {
+    ///// every section starts with a line containing a label (A40), a type
+    ///// (I, R, C or L) and either a value or N= and the number of values
+    const QString line = stream.readLine();
+    if(line.length() < 50 || line[0] == ' ')
+      continue;
+    const QString label = line.left(40).trimmed();
+    const QChar type = line[43];
+    if(line.mid(47,2) != "N=")
+    {
+      ///// a scalar
+      if(label == "Number of alpha electrons")
+        numAlpha = line.mid(49).trimmed().toUInt();
+      else if(label == "Number of beta electrons")
+        numBeta = line.mid(49).trimmed().toUInt();
+      else if(label == "Number of basis functions")
+        numBasisFunctions = line.mid(49).trimmed().toUInt();
+      else if(label == "Number of independent functions")
+        numOrbitalsPerSpin = line.mid(49).trimmed().toUInt();
+      continue;
+    }
+
+    ///// an array
+    const unsigned int count = line.mid(49).trimmed().toUInt();
+    std::vector<double>* values = 0;
+    if(label == "Current cartesian coordinates")
+      values = &coordinates;
+    else if(label == "Shell types")
+      values = &shellTypes;
+    else if(label == "Number of primitives per shell")
+      values = &primitivesPerShell;
+    else if(label == "Primitive exponents")
+      values = &exponents;
+    else if(label == "Contraction coefficients")
+      values = &contractions;
+    else if(label == "P(S=P) Contraction coefficients")
+      values = &contractionsP;
+    else if(label == "Coordinates of each shell")
+      values = &shellCoordinates;
+    else if(label == "Alpha Orbital Energies")
+      values = &alphaEnergies;
+    else if(label == "Beta Orbital Energies")
+      values = &betaEnergies;
+    else if(label == "Alpha MO coefficients")
+      values = &alphaCoefficients;
+    else if(label == "Beta MO coefficients")
+      values = &betaCoefficients;
+
+    if(values != 0)
+    {
+      values->resize(count);
+      for(unsigned int i = 0; i < count; i++)
+        stream >> (*values)[i];
+    }
+    else
+    {
+      ///// skip the lines of the values (6I12, 5E16.8, 5A12 or 72L1)
+      unsigned int perLine = 5;
+      if(type == 'I')
+        perLine = 6;
+      else if(type == 'L')
+        perLine = 72;
+      for(unsigned int i = 0; i < (count + perLine - 1)/perLine; i++)
+        stream.readLine();
+    }
+  }
+
+  ///// check the consistency
+  if(numBasisFunctions == 0 || coordinates.empty() || coordinates.size() % 3 != 0 || alphaCoefficients.empty())
+  {
+    clear();
+    return false;
+  }
+  if(numOrbitalsPerSpin == 0)
+    numOrbitalsPerSpin = alphaCoefficients.size()/numBasisFunctions;
+  if(alphaCoefficients.size() != numOrbitalsPerSpin*numBasisFunctions
+     || (!betaCoefficients.empty() && betaCoefficients.size() != numOrbitalsPerSpin*numBasisFunctions))
+  {
+    clear();
+    return false;
+  }
+
+  ///// the atoms
+  for(unsigned int i = 0; i < coordinates.size(); i += 3)
+    atoms.push_back(Point3D<double>(coordinates[i], coordinates[i+1], coordinates[i+2]));
+
+  ///// the shells
+  if(!setupShells(shellTypes, primitivesPerShell, exponents, contractions, contractionsP, shellCoordinates))
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+///// stop ////////////////////////////////////////////////////////////////////
+void MolecularOrbitals::stop()
+/// Requests a running evaluation to stop.
+{
+  stopRequested = true;
+}
+
+///// numOrbitals /////////////////////////////////////////////////////////////
+unsigned int MolecularOrbitals::numOrbitals() const
+/// Returns the number of orbitals. For unrestricted wavefunctions the beta
+/// orbitals follow the alpha orbitals.
+{
+  return betaCoefficients.empty() ? numOrbitalsPerSpin : 2*numOrbitalsPerSpin;
+}
+
+///// homo ////////////////////////////////////////////////////////////////////
+unsigned int MolecularOrbitals::homo() const
+/// Returns the index of the highest occupied (alpha) orbital.
+{
+  return numAlpha > 0 ? numAlpha - 1 : 0;
+}
+
+///// orbitalName /////////////////////////////////////////////////////////////
+QString MolecularOrbitals::orbitalName(const unsigned int orbital) const
+/// Returns a description of the given orbital containing its number, its
+/// energy and whether it is the HOMO or the LUMO.
+{
+  const bool beta = orbital >= numOrbitalsPerSpin;
+  const unsigned int index = beta ? orbital - numOrbitalsPerSpin : orbital;
+  const unsigned int numOccupied = beta ? numBeta : numAlpha;
+  const std::vector<double>& energies = beta ? betaEnergies : alphaEnergies;
+
+  QString name;
+  if(betaCoefficients.empty())
+    name = QObject::tr("MO %1").arg(index + 1);
+  else if(beta)
+    name = QObject::tr("Beta MO %1").arg(index + 1);
+  else
+    name = QObject::tr("Alpha MO %1").arg(index + 1);
+  if(index < energies.size())
+    name += QString(" (%1 au)").arg(energies[index], 0, 'f', 4);
+  if(index + 1 == numOccupied)
+    name += " HOMO";
+  else if(index == numOccupied)
+    name += " LUMO";
+  return name;
+}
+
+///// defaultGrid /////////////////////////////////////////////////////////////
+void MolecularOrbitals::defaultGrid(const double spacing, Point3D<unsigned int>& numPoints, Point3D<double>& origin) const
+/// Returns the number of points and the origin of a grid with the given
+/// spacing which encompasses all atoms with a margin of gridMargin.
+{
+  assert(spacing > 0.0);
+  if(atoms.empty())
+  {
+    numPoints.setValues(0, 0, 0);
+    origin.setValues(0.0, 0.0, 0.0);
+    return;
+  }
+
+  Point3D<double> minimum = atoms[0];
+  Point3D<double> maximum = atoms[0];
+  for(unsigned int i = 1; i < atoms.size(); i++)
+  {
+    minimum.setValues(atoms[i].x() < minimum.x() ? atoms[i].x() : minimum.x(),
+                      atoms[i].y() < minimum.y() ? atoms[i].y() : minimum.y(),
+                      atoms[i].z() < minimum.z() ? atoms[i].z() : minimum.z());
+    maximum.setValues(atoms[i].x() > maximum.x() ? atoms[i].x() : maximum.x(),
+                      atoms[i].y() > maximum.y() ? atoms[i].y() : maximum.y(),
+                      atoms[i].z() > maximum.z() ? atoms[i].z() : maximum.z());
+  }
+  origin.setValues(minimum.x() - gridMargin, minimum.y() - gridMargin, minimum.z() - gridMargin);
+  numPoints.setValues(static_cast<unsigned int>(ceil((maximum.x() - minimum.x() + 2.0*gridMargin)/spacing)) + 1,
+                      static_cast<unsigned int>(ceil((maximum.y() - minimum.y() + 2.0*gridMargin)/spacing)) + 1,
+                      static_cast<unsigned int>(ceil((maximum.z() - minimum.z() + 2.0*gridMargin)/spacing)) + 1);
+}
+
+///// evaluate ////////////////////////////////////////////////////////////////
+void MolecularOrbitals::evaluate(const int orbital, const Point3D<unsigned int>& numPoints, const Point3D<double>& origin, const Point3D<double>& delta, std::vector<double>& values, QObject* receiver, unsigned int* progress)
+/// Evaluates the given orbital (or the total density if orbital equals
+/// TotalDensity) on a grid. The values are stored with z running fastest,
+/// as in cube files. The work is divided over a worker thread per processor.
+/// If a receiver is given, the number of evaluated points is regularly
+/// stored in progress and announced to the receiver with an event of type
+/// 1001. When stopped, values is cleared.
+{
+  assert(orbital == TotalDensity || (orbital >= 0 && static_cast<unsigned int>(orbital) < numOrbitals()));
+  assert(receiver == 0 || progress != 0);
+
+  stopRequested = false;
+  values.assign(numPoints.x()*numPoints.y()*numPoints.z(), 0.0);
+  if(values.empty() || shells.empty())
+    return;
+  gridOrbital = orbital;
+  gridNumPoints = numPoints;
+  gridOrigin = origin;
+  gridDelta = delta;
+  gridValues = &values;
+  runWorkers(numPoints.x(), receiver, progress);
+  gridValues = 0;
+  if(stopRequested)
+    values.clear();
+}
+
+///// evaluate ////////////////////////////////////////////////////////////////
+void MolecularOrbitals::evaluate(const int orbital, const std::vector<Point3D<double> >& points, std::vector<double>& values, QObject* receiver, unsigned int* progress)
+/// Evaluates the given orbital (or the total density if orbital equals
+/// TotalDensity) in a list of points. Blocks of pointsPerBlock points are
+/// divided over a worker thread per processor, so points close in space
+/// should be close in the list for the screening to be effective. The
+/// progress is reported as for a grid. When stopped, values is cleared.
+{
+  assert(orbital == TotalDensity || (orbital >= 0 && static_cast<unsigned int>(orbital) < numOrbitals()));
+  assert(receiver == 0 || progress != 0);
+
+  stopRequested = false;
+  values.assign(points.size(), 0.0);
+  if(values.empty() || shells.empty())
+    return;
+  gridOrbital = orbital;
+  gridPoints = &points;
+  gridValues = &values;
+  runWorkers((points.size() + pointsPerBlock - 1)/pointsPerBlock, receiver, progress);
+  gridPoints = 0;
+  gridValues = 0;
+  if(stopRequested)
+    values.clear();
+}
+
+///// value ///////////////////////////////////////////////////////////////////
+double MolecularOrbitals::value(const int orbital, const double x, const double y, const double z) const
+/// Returns the value of the given orbital (or the total density if orbital
+/// equals TotalDensity) in the point (x, y, z).
+{
+  assert(orbital == TotalDensity || (orbital >= 0 && static_cast<unsigned int>(orbital) < numOrbitals()));
+
+  std::vector<unsigned int> candidates(shells.size());
+  for(unsigned int i = 0; i < shells.size(); i++)
+    candidates[i] = i;
+  std::vector<double> basis(numBasisFunctions);
+  std::vector<unsigned int> active;
+  return pointValue(orbital, x, y, z, candidates, basis, active);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Private Member Functions                                            /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// clear ///////////////////////////////////////////////////////////////////
+void MolecularOrbitals::clear()
+/// Removes all data.
+{
+  shells.clear();
+  atoms.clear();
+  numBasisFunctions = 0;
+  numOrbitalsPerSpin = 0;
+  numAlpha = 0;
+  numBeta = 0;
+  alphaCoefficients.clear();
+  betaCoefficients.clear();
+  alphaEnergies.clear();
+  betaEnergies.clear();
+}
+
+///// setupShells /////////////////////////////////////////////////////////////
+bool MolecularOrbitals::setupShells(const std::vector<double>& shellTypes, const std::vector<double>& primitivesPerShell, const std::vector<double>& exponents, const std::vector<double>& contractions, const std::vector<double>& contractionsP, const std::vector<double>& shellCoordinates)
+/// Sets up the shells from the arrays read from a formatted checkpoint file.
+/// The primitives are normalized, the contractions are renormalized and the
+/// cutoff radius of each shell is determined. Returns false if the arrays are
+/// inconsistent or contain shells with l > 4.
+{
+  if(shellTypes.empty() || primitivesPerShell.size() != shellTypes.size() || shellCoordinates.size() != 3*shellTypes.size()
+     || contractions.size() != exponents.size())
+    return false;
+
+  unsigned int firstPrimitive = 0;
+  unsigned int firstFunction = 0;
+  for(unsigned int i = 0; i < shellTypes.size(); i++)
+  {
+    Shell shell;
+    shell.type = static_cast<int>(shellTypes[i]);
+    const int l = abs(shell.type);
+    if(l > 4)
+      return false;
+    const unsigned int numPrimitives = static_cast<unsigned int>(primitivesPerShell[i]);
+    if(firstPrimitive + numPrimitives > exponents.size() || (shell.type == -1 && contractionsP.size() != exponents.size()))
+      return false;
+
+    shell.firstFunction = firstFunction;
+    if(shell.type == -1)
+      shell.numFunctions = 4;
+    else if(shell.type < 0)
+      shell.numFunctions = 2*l + 1;
+    else
+      shell.numFunctions = (l + 1)*(l + 2)/2;
+    firstFunction += shell.numFunctions;
+    shell.x = shellCoordinates[3*i];
+    shell.y = shellCoordinates[3*i + 1];
+    shell.z = shellCoordinates[3*i + 2];
+    shell.exponents.assign(exponents.begin() + firstPrimitive, exponents.begin() + firstPrimitive + numPrimitives);
+
+    ///// normalize the primitives (as x^l) and the contraction
+    for(unsigned int part = 0; part < (shell.type == -1 ? 2u : 1u); part++)
+    {
+      const int partL = shell.type == -1 ? static_cast<int>(part) : l;
+      const std::vector<double>& source = part == 0 ? contractions : contractionsP;
+      std::vector<double>& target = part == 0 ? shell.coefficients : shell.coefficientsP;
+      target.assign(source.begin() + firstPrimitive, source.begin() + firstPrimitive + numPrimitives);
+      double overlap = 0.0;
+      for(unsigned int p = 0; p < numPrimitives; p++)
+        for(unsigned int q = 0; q < numPrimitives; q++)
+          overlap += target[p]*target[q]*pow(2.0*sqrt(shell.exponents[p]*shell.exponents[q])/(shell.exponents[p] + shell.exponents[q]), partL + 1.5);
+      if(overlap <= 0.0)
+        return false;
+      for(unsigned int p = 0; p < numPrimitives; p++)
+        target[p] *= pow(2.0*shell.exponents[p]/Point3D<double>::PI, 0.75) * pow(4.0*shell.exponents[p], 0.5*partL)
+                     / sqrt(doubleFactorial(2*partL - 1)) / sqrt(overlap);
+    }
+
+    ///// the relative normalization of the cartesian components
+    if(shell.type > 1)
+    {
+      const unsigned int offset = l*(l + 1)*(l + 2)/6; // the number of cartesian functions with a lower l
+      for(unsigned int f = 0; f < shell.numFunctions; f++)
+        shell.factors.push_back(sqrt(doubleFactorial(2*l - 1)/(doubleFactorial(2*cartesianPowers[offset + f][0] - 1)
+                                *doubleFactorial(2*cartesianPowers[offset + f][1] - 1)*doubleFactorial(2*cartesianPowers[offset + f][2] - 1))));
+    }
+
+    ///// determine the radius beyond which the shell can be neglected
+    ///// (the angular parts are bounded by sqrt((2l-1)!!) times r^l). The s
+    ///// and p parts of an sp shell are bounded separately.
+    double minimumExponent = shell.exponents[0];
+    for(unsigned int p = 1; p < numPrimitives; p++)
+      if(shell.exponents[p] < minimumExponent)
+        minimumExponent = shell.exponents[p];
+    double r = 0.0;
+    for(unsigned int part = 0; part < (shell.type == -1 ? 2u : 1u); part++)
+    {
+      const int partL = shell.type == -1 ? static_cast<int>(part) : l;
+      const std::vector<double>& partCoefficients = part == 0 ? shell.coefficients : shell.coefficientsP;
+      const double angularBound = sqrt(doubleFactorial(2*partL - 1)) > 1.0 ? sqrt(doubleFactorial(2*partL - 1)) : 1.0;
+      double partR = sqrt(0.5*partL/minimumExponent); // the maximum of the most diffuse primitive
+      while(true)
+      {
+        double bound = 0.0;
+        for(unsigned int p = 0; p < numPrimitives; p++)
+          bound += fabs(partCoefficients[p])*angularBound*pow(partR, partL)*exp(-shell.exponents[p]*partR*partR);
+        if(bound < screeningThreshold)
+          break;
+        partR += 0.1;
+      }
+      if(partR > r)
+        r = partR;
+    }
+    shell.cutoffSquared = r*r;
+
+    shells.push_back(shell);
+    firstPrimitive += numPrimitives;
+  }
+  return firstFunction == numBasisFunctions;
+}
+
+///// runWorkers //////////////////////////////////////////////////////////////
+void MolecularOrbitals::runWorkers(const unsigned int numTasks, QObject* receiver, unsigned int* progress)
+/// Divides numTasks planes or blocks of points over a worker thread per
+/// processor and waits until they have finished. If a receiver is given, the
+/// combined progress of the workers is regularly announced to it.
+{
+  unsigned int numWorkers = QThread::idealThreadCount() > 1 ? QThread::idealThreadCount() : 1;
+  if(numWorkers > numTasks)
+    numWorkers = numTasks;
+  std::vector<MolecularOrbitalsWorker*> workers;
+  for(unsigned int i = 0; i < numWorkers; i++)
+  {
+    workers.push_back(new MolecularOrbitalsWorker(this, i, numWorkers));
+    workers.back()->start(QThread::LowPriority);
+  }
+
+  ///// notify the combined progress until all workers have finished
+  for(unsigned int i = 0; i < numWorkers; i++)
+  {
+    while(!workers[i]->wait(progressInterval))
+    {
+      if(receiver == 0)
+        continue;
+      unsigned int totalProgress = 0;
+      for(unsigned int j = 0; j < numWorkers; j++)
+        totalProgress += workers[j]->progress;
+      *progress = totalProgress;
+      QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1001), progress);
+      QApplication::postEvent(receiver, e);
+    }
+  }
+  for(unsigned int i = 0; i < numWorkers; i++)
+    delete workers[i];
+}
+
+///// evaluatePlanes //////////////////////////////////////////////////////////
+void MolecularOrbitals::evaluatePlanes(MolecularOrbitalsWorker* worker)
+/// Evaluates the planes of the grid assigned to the worker. It is called
+/// from the worker threads.
+{
+  const unsigned int numY = gridNumPoints.y();
+  const unsigned int numZ = gridNumPoints.z();
+  std::vector<double> basis(numBasisFunctions);
+  std::vector<unsigned int> rowShells;
+  std::vector<unsigned int> active;
+  rowShells.reserve(shells.size());
+  active.reserve(shells.size());
+
+  for(unsigned int ix = worker->first; ix < gridNumPoints.x(); ix += worker->stride)
+  {
+    const double x = gridOrigin.x() + ix*gridDelta.x();
+    for(unsigned int iy = 0; iy < numY; iy++)
+    {
+      const double y = gridOrigin.y() + iy*gridDelta.y();
+
+      ///// only consider the shells reaching this row
+      rowShells.clear();
+      for(unsigned int s = 0; s < shells.size(); s++)
+      {
+        const double dx = x - shells[s].x;
+        const double dy = y - shells[s].y;
+        if(dx*dx + dy*dy < shells[s].cutoffSquared)
+          rowShells.push_back(s);
+      }
+      if(rowShells.empty())
+        continue; // the values are already zero
+
+      double* row = &(*gridValues)[(ix*numY + iy)*numZ];
+      for(unsigned int iz = 0; iz < numZ; iz++)
+        row[iz] = pointValue(gridOrbital, x, y, gridOrigin.z() + iz*gridDelta.z(), rowShells, basis, active);
+    }
+    worker->progress += numY*numZ;
+    if(stopRequested)
+      return;
+  }
+}
+
+///// evaluateBlocks //////////////////////////////////////////////////////////
+void MolecularOrbitals::evaluateBlocks(MolecularOrbitalsWorker* worker)
+/// Evaluates the blocks of gridPoints assigned to the worker. It is called
+/// from the worker threads.
+{
+  const std::vector<Point3D<double> >& points = *gridPoints;
+  std::vector<double> basis(numBasisFunctions);
+  std::vector<unsigned int> blockShells;
+  std::vector<unsigned int> active;
+  blockShells.reserve(shells.size());
+  active.reserve(shells.size());
+
+  for(unsigned int first = worker->first*pointsPerBlock; first < points.size(); first += worker->stride*pointsPerBlock)
+  {
+    const unsigned int last = first + pointsPerBlock < points.size() ? first + pointsPerBlock : points.size();
+
+    ///// only consider the shells reaching the bounding box of the block
+    Point3D<double> minimum = points[first];
+    Point3D<double> maximum = points[first];
+    for(unsigned int i = first + 1; i < last; i++)
+    {
+      minimum.setValues(points[i].x() < minimum.x() ? points[i].x() : minimum.x(),
+                        points[i].y() < minimum.y() ? points[i].y() : minimum.y(),
+                        points[i].z() < minimum.z() ? points[i].z() : minimum.z());
+      maximum.setValues(points[i].x() > maximum.x() ? points[i].x() : maximum.x(),
+                        points[i].y() > maximum.y() ? points[i].y() : maximum.y(),
+                        points[i].z() > maximum.z() ? points[i].z() : maximum.z());
+    }
+    blockShells.clear();
+    for(unsigned int s = 0; s < shells.size(); s++)
+    {
+      const double dx = shells[s].x < minimum.x() ? minimum.x() - shells[s].x : (shells[s].x > maximum.x() ? shells[s].x - maximum.x() : 0.0);
+      const double dy = shells[s].y < minimum.y() ? minimum.y() - shells[s].y : (shells[s].y > maximum.y() ? shells[s].y - maximum.y() : 0.0);
+      const double dz = shells[s].z < minimum.z() ? minimum.z() - shells[s].z : (shells[s].z > maximum.z() ? shells[s].z - maximum.z() : 0.0);
+      if(dx*dx + dy*dy + dz*dz < shells[s].cutoffSquared)
+        blockShells.push_back(s);
+    }
+
+    if(!blockShells.empty())
+    {
+      for(unsigned int i = first; i < last; i++)
+        (*gridValues)[i] = pointValue(gridOrbital, points[i].x(), points[i].y(), points[i].z(), blockShells, basis, active);
+    }
+    worker->progress += last - first;
+    if(stopRequested)
+      return;
+  }
+}
+
+///// pointValue //////////////////////////////////////////////////////////////
+double MolecularOrbitals::pointValue(const int orbital, const double x, const double y, const double z, const std::vector<unsigned int>& candidates, std::vector<double>& basis, std::vector<unsigned int>& active) const
+/// Returns the value of the orbital (or the density) in a point. Only the
+/// candidate shells reaching the point are evaluated. basis and active are
+/// scratch space for the values of the basis functions and the list of
+/// evaluated shells.
+{
+  ///// evaluate the basis functions of the shells reaching the point
+  active.clear();
+  for(std::vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+  {
+    const Shell& shell = shells[*it];
+    const double dx = x - shell.x;
+    const double dy = y - shell.y;
+    const double dz = z - shell.z;
+    const double r2 = dx*dx + dy*dy + dz*dz;
+    if(r2 >= shell.cutoffSquared)
+      continue;
+    shellValues(shell, dx, dy, dz, r2, &basis[shell.firstFunction]);
+    active.push_back(*it);
+  }
+  if(active.empty())
+    return 0.0;
+
+  ///// a single orbital
+  if(orbital != TotalDensity)
+    return orbitalValue(coefficients(orbital), basis, active);
+
+  ///// the total density from the occupied orbitals
+  const bool unrestricted = !betaCoefficients.empty();
+  double density = 0.0;
+  for(unsigned int i = 0; i < numAlpha; i++)
+  {
+    const double psi = orbitalValue(&alphaCoefficients[i*numBasisFunctions], basis, active);
+    density += (unrestricted || i >= numBeta ? 1.0 : 2.0)*psi*psi;
+  }
+  if(unrestricted)
+  {
+    for(unsigned int i = 0; i < numBeta; i++)
+    {
+      const double psi = orbitalValue(&betaCoefficients[i*numBasisFunctions], basis, active);
+      density += psi*psi;
+    }
+  }
+  return density;
+}
+
+///// shellValues /////////////////////////////////////////////////////////////
+void MolecularOrbitals::shellValues(const Shell& shell, const double dx, const double dy, const double dz, const double r2, double* values) const
+/// Calculates the values of the basis functions of a shell at the relative
+/// position (dx, dy, dz) with squared length r2. The functions are in
+/// Gaussian's order, the pure functions are real solid harmonics with the
+/// same normalization as x^l.
+{
+  ///// the contracted radial parts
+  double radial = 0.0;
+  double radialP = 0.0;
+  for(unsigned int p = 0; p < shell.exponents.size(); p++)
+  {
+    const double e = exp(-shell.exponents[p]*r2);
+    radial += shell.coefficients[p]*e;
+    if(shell.type == -1)
+      radialP += shell.coefficientsP[p]*e;
+  }
+
+  const double xx = dx*dx;
+  const double yy = dy*dy;
+  const double zz = dz*dz;
+  switch(shell.type)
+  {
+    case 0: // s
+            values[0] = radial;
+            break;
+    case 1: // p (x, y, z)
+            values[0] = radial*dx;
+            values[1] = radial*dy;
+            values[2] = radial*dz;
+            break;
+    case -1: // sp (s, x, y, z)
+            values[0] = radial;
+            values[1] = radialP*dx;
+            values[2] = radialP*dy;
+            values[3] = radialP*dz;
+            break;
+    case -2: // pure d (0, +1, -1, +2, -2)
+            values[0] = radial*(zz - 0.5*(xx + yy));
+            values[1] = radial*sqrt(3.0)*dx*dz;
+            values[2] = radial*sqrt(3.0)*dy*dz;
+            values[3] = radial*0.5*sqrt(3.0)*(xx - yy);
+            values[4] = radial*sqrt(3.0)*dx*dy;
+            break;
+    case -3: // pure f (0, +1, -1, +2, -2, +3, -3)
+            values[0] = radial*dz*(zz - 1.5*(xx + yy));
+            values[1] = radial*sqrt(0.375)*dx*(4.0*zz - xx - yy);
+            values[2] = radial*sqrt(0.375)*dy*(4.0*zz - xx - yy);
+            values[3] = radial*0.5*sqrt(15.0)*dz*(xx - yy);
+            values[4] = radial*sqrt(15.0)*dx*dy*dz;
+            values[5] = radial*sqrt(0.625)*dx*(xx - 3.0*yy);
+            values[6] = radial*sqrt(0.625)*dy*(3.0*xx - yy);
+            break;
+    case -4: // pure g (0, +1, -1, +2, -2, +3, -3, +4, -4)
+            values[0] = radial*(35.0*zz*zz - 30.0*zz*r2 + 3.0*r2*r2)/8.0;
+            values[1] = radial*0.25*sqrt(10.0)*dx*dz*(7.0*zz - 3.0*r2);
+            values[2] = radial*0.25*sqrt(10.0)*dy*dz*(7.0*zz - 3.0*r2);
+            values[3] = radial*0.25*sqrt(5.0)*(xx - yy)*(7.0*zz - r2);
+            values[4] = radial*0.5*sqrt(5.0)*dx*dy*(7.0*zz - r2);
+            values[5] = radial*0.25*sqrt(70.0)*dx*dz*(xx - 3.0*yy);
+            values[6] = radial*0.25*sqrt(70.0)*dy*dz*(3.0*xx - yy);
+            values[7] = radial*sqrt(35.0)/8.0*(xx*xx - 6.0*xx*yy + yy*yy);
+            values[8] = radial*0.5*sqrt(35.0)*dx*dy*(xx - yy);
+            break;
+    default: // cartesian d, f and g
+    {
+      const double powersX[5] = {1.0, dx, xx, xx*dx, xx*xx};
+      const double powersY[5] = {1.0, dy, yy, yy*dy, yy*yy};
+      const double powersZ[5] = {1.0, dz, zz, zz*dz, zz*zz};
+      const unsigned int l = shell.type;
+      const unsigned int offset = l*(l + 1)*(l + 2)/6;
+      for(unsigned int f = 0; f < shell.numFunctions; f++)
+        values[f] = radial*shell.factors[f]*powersX[cartesianPowers[offset + f][0]]*powersY[cartesianPowers[offset + f][1]]*powersZ[cartesianPowers[offset + f][2]];
+    }
+  }
+}
+
+///// orbitalValue ////////////////////////////////////////////////////////////
+double MolecularOrbitals::orbitalValue(const double* orbitalCoefficients, const std::vector<double>& basis, const std::vector<unsigned int>& active) const
+/// Returns the value of an orbital from the values of the basis functions of
+/// the active shells.
+{
+  double result = 0.0;
+  for(std::vector<unsigned int>::const_iterator it = active.begin(); it != active.end(); it++)
+  {
+    const unsigned int first = shells[*it].firstFunction;
+    const unsigned int last = first + shells[*it].numFunctions;
+    for(unsigned int f = first; f < last; f++)
+      result += orbitalCoefficients[f]*basis[f];
+  }
+  return result;
+}
+
+///// coefficients ////////////////////////////////////////////////////////////
+const double* MolecularOrbitals::coefficients(const unsigned int orbital) const
+/// Returns the MO coefficients of the given orbital.
+{
+  if(orbital < numOrbitalsPerSpin)
+    return &alphaCoefficients[orbital*numBasisFunctions];
+  return &betaCoefficients[(orbital - numOrbitalsPerSpin)*numBasisFunctions];
+}
+
+///// doubleFactorial /////////////////////////////////////////////////////////
+double MolecularOrbitals::doubleFactorial(const int n)
+/// Returns n!! (1 for n <= 0).
+{
+  double result = 1.0;
+  for(int i = n; i > 1; i -= 2)
+    result *= static_cast<double>(i);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// class MolecularOrbitalsWorker                                       /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// Constructor /////////////////////////////////////////////////////////////
+MolecularOrbitalsWorker::MolecularOrbitalsWorker(MolecularOrbitals* parentOrbitals, const unsigned int index, const unsigned int number) : QThread(),
+  first(index),
+  stride(number),
+  progress(0),
+  orbitals(parentOrbitals)
+/// The constructor. The worker does every number'th plane of the grid
+/// starting at plane index.
+{
+  assert(parentOrbitals != 0);
+  assert(index < number);
+}
+
+///// run /////////////////////////////////////////////////////////////////////
+void MolecularOrbitalsWorker::run()
+/// Does the part of the work of this worker.
+{
+  if(orbitals->gridPoints != 0)
+    orbitals->evaluateBlocks(this);
+  else
+    orbitals->evaluatePlanes(this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Static Variables                                                    /////
+///////////////////////////////////////////////////////////////////////////////
+
+const int MolecularOrbitals::TotalDensity = -1;
+const double MolecularOrbitals::screeningThreshold = 1.0e-8;
+const double MolecularOrbitals::gridMargin = 4.0;
+const unsigned long MolecularOrbitals::progressInterval = 100;
+const unsigned int MolecularOrbitals::pointsPerBlock = 256;
+const unsigned int MolecularOrbitals::cartesianPowers[35][3] = {
+  {0,0,0},                                                          // s
+  {1,0,0}, {0,1,0}, {0,0,1},                                        // p
+  {2,0,0}, {0,2,0}, {0,0,2}, {1,1,0}, {1,0,1}, {0,1,1},             // d: xx, yy, zz, xy, xz, yz
+  {3,0,0}, {0,3,0}, {0,0,3}, {1,2,0}, {2,1,0}, {2,0,1}, {1,0,2}, {0,1,2}, {0,2,1}, {1,1,1}, // f: xxx, yyy, zzz, xyy, xxy, xxz, xzz, yzz, yyz, xyz
+  {0,0,4}, {0,1,3}, {0,2,2}, {0,3,1}, {0,4,0}, {1,0,3}, {1,1,2}, {1,2,1}, {1,3,0}, {2,0,2}, {2,1,1}, {2,2,0}, {3,0,1}, {3,1,0}, {4,0,0} // g: zzzz, yzzz, ..., xxxx
+};
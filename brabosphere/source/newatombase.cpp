@@ -156,6 +156,7 @@ void NewAtomBase::addAtom()
 /// Adds an atom based on the status of the widgets
 {
   unsigned int selectedAtomType = ButtonGroupType->selectedId();
+  atoms->beginEdit();
   if(RadioButtonCartesian->isOn())
   {
     ///// Add the atom by absolute or relative cartesian coordinates
@@ -208,6 +209,7 @@ void NewAtomBase::addAtom()
       }
     }
   }
+  atoms->endEdit();
   emit atomAdded();
   /*
   qDebug("finished, coordinates of all atoms:");
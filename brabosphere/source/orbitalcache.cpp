@@ -0,0 +1,290 @@
+/***************************************************************************
+                       orbitalcache.cpp  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+///// Comments ////////////////////////////////////////////////////////////////
+
+/*!
+  \class OrbitalCache
+  \brief Keeps the points of finished orbital calculations.
+
+  The points are kept in memory in least recently used order until their
+  total number exceeds maxPoints. When a directory is set, each orbital is
+  also written to a file in it and orbitals not in memory are looked up
+  there, so they survive the session. The files carry fileVersion in their
+  name and header, which should be increased whenever the format or the
+  calculated points change. Files from other versions are removed and the
+  least recently used files are removed when their total size exceeds
+  maxDiskSize.
+
+  The key should only contain the parameters that matter for its type of
+  visualization, the others set to zero.
+*/
+/// \file
+/// Contains the implementation of the class OrbitalCache.
+
+///// Header files ////////////////////////////////////////////////////////////
+
+// Qt header files
+#include <qdatastream.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qstringlist.h>
+
+// C header files (after the Qt headers, which define Q_OS_WIN32)
+#ifdef Q_OS_WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+// Xbrabo header files
+#include "orbitalcache.h"
+
+///////////////////////////////////////////////////////////////////////////////
+///// Public Member Functions                                             /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// Key::operator< //////////////////////////////////////////////////////////
+bool OrbitalCache::Key::operator<(const Key& other) const
+/// Orders the keys lexicographically.
+{
+  if(type != other.type)
+    return type < other.type;
+  if(atom != other.atom)
+    return atom < other.atom;
+  if(n != other.n)
+    return n < other.n;
+  if(l != other.l)
+    return l < other.l;
+  if(m != other.m)
+    return m < other.m;
+  if(resolution != other.resolution)
+    return resolution < other.resolution;
+  if(probability != other.probability)
+    return probability < other.probability;
+  if(dots != other.dots)
+    return dots < other.dots;
+  return seed < other.seed;
+}
+
+///// Constructor /////////////////////////////////////////////////////////////
+OrbitalCache::OrbitalCache() :
+  numPoints(0)
+/// The default constructor.
+{
+
+}
+
+///// Destructor //////////////////////////////////////////////////////////////
+OrbitalCache::~OrbitalCache()
+/// The default destructor.
+{
+
+}
+
+///// setDirectory ////////////////////////////////////////////////////////////
+void OrbitalCache::setDirectory(const QString& dir)
+/// Sets the directory where the orbitals are cached on disk. It is created
+/// if it doesn't exist. An empty string disables caching on disk.
+{
+  directory = dir;
+  if(directory.isEmpty())
+    return;
+  if(!QDir(directory).exists())
+    QDir().mkpath(directory);
+  prune();
+}
+
+///// find ////////////////////////////////////////////////////////////////////
+bool OrbitalCache::find(const Key& key, std::vector<float>& negative, std::vector<float>& positive, double& radius)
+/// Retrieves the points of the orbital with the given key from memory or
+/// from disk. Returns false if they are not cached.
+{
+  std::map<Key, std::list<Entry>::iterator>::iterator it = index.find(key);
+  if(it != index.end())
+  {
+    ///// mark the entry as the most recently used
+    entries.splice(entries.begin(), entries, it->second);
+    negative = it->second->coords[0];
+    positive = it->second->coords[1];
+    radius = it->second->radius;
+    return true;
+  }
+
+  if(directory.isEmpty() || !readFile(key, negative, positive, radius))
+    return false;
+  store(key, negative, positive, radius);
+  return true;
+}
+
+///// insert //////////////////////////////////////////////////////////////////
+void OrbitalCache::insert(const Key& key, const std::vector<float>& negative, const std::vector<float>& positive, const double radius)
+/// Stores the points of the orbital with the given key.
+{
+  store(key, negative, positive, radius);
+  if(!directory.isEmpty())
+  {
+    writeFile(key, negative, positive, radius);
+    prune();
+  }
+}
+
+///// clear ///////////////////////////////////////////////////////////////////
+void OrbitalCache::clear()
+/// Removes all orbitals from memory. The files on disk are kept.
+{
+  entries.clear();
+  index.clear();
+  numPoints = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Private Member Functions                                            /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// store ///////////////////////////////////////////////////////////////////
+void OrbitalCache::store(const Key& key, const std::vector<float>& negative, const std::vector<float>& positive, const double radius)
+/// Stores the points in memory as the most recently used entry and removes
+/// the least recently used entries exceeding maxPoints.
+{
+  std::map<Key, std::list<Entry>::iterator>::iterator it = index.find(key);
+  if(it != index.end())
+  {
+    numPoints -= (it->second->coords[0].size() + it->second->coords[1].size())/3;
+    entries.erase(it->second);
+    index.erase(it);
+  }
+  const unsigned int newPoints = (negative.size() + positive.size())/3;
+  if(newPoints > maxPoints)
+    return;
+
+  entries.push_front(Entry());
+  entries.front().key = key;
+  entries.front().coords[0] = negative;
+  entries.front().coords[1] = positive;
+  entries.front().radius = radius;
+  index[key] = entries.begin();
+  numPoints += newPoints;
+
+  while(numPoints > maxPoints)
+  {
+    numPoints -= (entries.back().coords[0].size() + entries.back().coords[1].size())/3;
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+///// fileName ////////////////////////////////////////////////////////////////
+QString OrbitalCache::fileName(const Key& key) const
+/// Returns the name of the file on disk for the given key.
+{
+  return directory + QDir::separator() + filePrefix() + QString("%1_%2_%3_%4_%5_%6_%7_%8_%9.pts")
+         .arg(key.type).arg(key.atom).arg(key.n).arg(key.l).arg(key.m)
+         .arg(QString::number(key.resolution, 'g', 9)).arg(QString::number(key.probability, 'g', 9))
+         .arg(key.dots).arg(key.seed);
+}
+
+///// filePrefix //////////////////////////////////////////////////////////////
+QString OrbitalCache::filePrefix() const
+/// Returns the start of the names of the files of the current version.
+{
+  return QString("orbital%1_").arg(fileVersion);
+}
+
+///// readFile ////////////////////////////////////////////////////////////////
+bool OrbitalCache::readFile(const Key& key, std::vector<float>& negative, std::vector<float>& positive, double& radius) const
+/// Reads the points of the orbital with the given key from disk. Returns
+/// false if the file doesn't exist or is invalid.
+{
+  QFile file(fileName(key));
+  if(!file.open(IO_ReadOnly))
+    return false;
+  QDataStream stream(&file);
+
+  unsigned int magic, version;
+  stream >> magic >> version;
+  if(magic != fileMagic || version != fileVersion)
+    return false;
+  stream >> radius;
+  for(unsigned int phase = 0; phase < 2; phase++)
+  {
+    std::vector<float>& coords = phase == 0 ? negative : positive;
+    unsigned int size;
+    stream >> size;
+    if(size > 3*maxPoints)
+      return false;
+    coords.resize(size);
+    for(unsigned int i = 0; i < size; i++)
+      stream >> coords[i];
+  }
+  if(stream.status() != QDataStream::Ok)
+    return false;
+
+  ///// mark the file as the most recently used
+  file.close();
+  utime(QFile::encodeName(file.name()), 0);
+  return true;
+}
+
+///// writeFile ///////////////////////////////////////////////////////////////
+void OrbitalCache::writeFile(const Key& key, const std::vector<float>& negative, const std::vector<float>& positive, const double radius) const
+/// Writes the points of the orbital with the given key to disk.
+{
+  QFile file(fileName(key));
+  if(!file.open(IO_WriteOnly))
+    return;
+  QDataStream stream(&file);
+
+  stream << fileMagic << fileVersion << radius;
+  for(unsigned int phase = 0; phase < 2; phase++)
+  {
+    const std::vector<float>& coords = phase == 0 ? negative : positive;
+    stream << static_cast<unsigned int>(coords.size());
+    for(std::vector<float>::const_iterator it = coords.begin(); it != coords.end(); it++)
+      stream << *it;
+  }
+}
+
+///// prune ///////////////////////////////////////////////////////////////////
+void OrbitalCache::prune() const
+/// Removes the files of other versions and the least recently used files
+/// exceeding maxDiskSize from the directory.
+{
+  QDir dir(directory);
+  const QStringList files = dir.entryList("orbital*.pts", QDir::Files, QDir::Time); // most recent first
+  const QString prefix = filePrefix();
+  unsigned int totalSize = 0;
+  for(QStringList::ConstIterator it = files.begin(); it != files.end(); it++)
+  {
+    if((*it).startsWith(prefix))
+    {
+      totalSize += QFileInfo(dir, *it).size();
+      if(totalSize <= maxDiskSize)
+        continue;
+    }
+    dir.remove(*it);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Static Variables                                                    /////
+///////////////////////////////////////////////////////////////////////////////
+
+const unsigned int OrbitalCache::maxPoints = 5000000;
+const unsigned int OrbitalCache::maxDiskSize = 268435456; // 256 MB
+const unsigned int OrbitalCache::fileMagic = 0x4f524243; // "ORBC"
+const unsigned int OrbitalCache::fileVersion = 1;
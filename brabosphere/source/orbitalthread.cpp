@@ -19,9 +19,10 @@
   \class OrbitalThread
   \brief This class calculates Hydrogen orbitals for visualisation in 3D in a thread.
 
-  It uses increased precision (double, long double) only when needed. They are, however, not implemented
-  yet so the limit for 'n' (the main quantum number) lies somewhere around 15 
-  depending on the values of the other quantum numbers.
+  It uses increased precision (double, long double) only when needed: all
+  calculations are templates on the floating point type and the cheapest type
+  able to hold the largest intermediate value for the given quantum numbers
+  is chosen when the thread starts.
 
 */
 /// \file
@@ -33,26 +34,26 @@
 #include <cassert>
 #include <cfloat>
 #include <cmath>
+#include <limits>
 
 // Qt header files
 #include <qapplication.h>
-#include <qmutex.h>
 
 // Xbrabo header files
 #include "orbitalthread.h"
+#include "pointstream.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 ///// Public Member Functions                                             /////
 ///////////////////////////////////////////////////////////////////////////////
 
 ///// Constructor /////////////////////////////////////////////////////////////
-OrbitalThread::OrbitalThread(QWidget* parentWidget, QMutex* sharedMutex, std::vector<Point3D<float> >* coordinates, 
-                             const unsigned int type, const unsigned int atom, const unsigned int n, 
+OrbitalThread::OrbitalThread(QWidget* parentWidget, PointStream* pointStream, const unsigned int type, 
+                             const unsigned int atom, const unsigned int n, 
                              const unsigned int l, const int m, const float res, const float prob, 
-                             const unsigned int dots) : QThread(),
+                             const unsigned int dots, const unsigned int seed) : QThread(),
   receiver(parentWidget),
-  mutex(sharedMutex),
-  coords(coordinates),
+  stream(pointStream),
   atomNumber(atom),
   qnPrincipal(n),
   qnOrbital(l),
@@ -61,13 +62,14 @@ OrbitalThread::OrbitalThread(QWidget* parentWidget, QMutex* sharedMutex, std::ve
   probability(prob),
   resolution(res),        
   numDots(dots),
+  randomSeed(seed),
   stopRequested(false)
 /// The default constructor. All needed parameters are passed upon creation of the thread as it is one-shot.
-/// Using multiple threads is easily accomplished by further providing start and end values for the angle Phi.
+/// The thread divides the work over a number of OrbitalWorker threads.
+/// The same seed always gives the same points.
 {
   assert(parentWidget != 0);
-  assert(sharedMutex != 0);
-  assert(coordinates != 0);
+  assert(pointStream != 0);
   assert(atom > 0);
   assert(prob >= 0.0f && prob <= 1.0f);
   assert(res > 1.0f);
@@ -79,10 +81,6 @@ OrbitalThread::OrbitalThread(QWidget* parentWidget, QMutex* sharedMutex, std::ve
   //qDebug("maximum float = %e (%d bits)", FLT_MAX, sizeof(float));
   //qDebug("maximum double = %e (%d bits)", DBL_MAX, sizeof(double));
   //qDebug("maximum long double = %Le (%d bits)", LDBL_MAX, sizeof(long double));
-
-  ///// comment: maybe template-ize the getXXX functions and find the lowest
-  ///// precision that can represent (4Zn)^n (as occurs in associatedLaguerre for r=2n^2)
-  ///// => not needed for getAngularPart => largest number is
 }
 
 ///// Destructor //////////////////////////////////////////////////////////////
@@ -115,89 +113,140 @@ void OrbitalThread::run()
 /// Dispatches the work to the proper calculating
 /// routine. It is run with a call to start().
 {  
-  ////// determine the needed precision (float, double or long double
-  unsigned int neededPrecision = PRECISION_UNKNOWN;
-  if(calculationType != AngularPart)
-  {
-    ///// PRECISION CHECKS FOR ALL BUT GETANGULARPART
-    // check whether the largest possible number ((4n)^n) can be represented by a float
-    if(largestResult<float>(qnPrincipal, qnOrbital, qnMomentum, atomNumber) != HUGE_VAL)
-    //if(powf(static_cast<float>(4 * atomNumber * qnPrincipal), qnPrincipal) != HUGE_VALF)
-      neededPrecision = PRECISION_FLOAT;
-    // by a double
-    else if(largestResult<double>(qnPrincipal, qnOrbital, qnMomentum, atomNumber) != HUGE_VAL)
-    //else if(pow(static_cast<double>(4 * atomNumber * qnPrincipal), qnPrincipal) != HUGE_VAL)
-      neededPrecision = PRECISION_DOUBLE;
-    // or by a long double
-    else if(largestResult<long double>(qnPrincipal, qnOrbital, qnMomentum, atomNumber) != HUGE_VAL)
-      neededPrecision = PRECISION_LONG_DOUBLE;
-  }
-  else
-  {     
-    ///// PRECISION CHECKS FOR ANGULAR PART
-    // check whether the largest possible number ((2l)!) can be represented by a float
-    if(factorial<float>(2*qnOrbital) != HUGE_VAL)
-      neededPrecision = PRECISION_FLOAT;
-    // by a double
-    else if(factorial<float>(2*qnOrbital) != HUGE_VAL)
-      neededPrecision = PRECISION_DOUBLE;
-    // or by a long double
-    else if(factorial<float>(2*qnOrbital) != HUGE_VAL)
-      neededPrecision = PRECISION_LONG_DOUBLE;
-  }
-  qDebug("required precision = %d", neededPrecision);
-  if(neededPrecision == PRECISION_UNKNOWN)
+  ////// determine the needed precision (float, double or long double)
+  ////// from the largest intermediate value of the polynomials
+  precision = PRECISION_UNKNOWN;
+  const bool radial = calculationType != AngularPart;
+  ////// and the smallest normalization factor
+  const long double normR = radial ? radialNormalization(qnPrincipal, qnOrbital, atomNumber) : 1.0L;
+  const long double normTheta = std::fabs(angularNormalization(qnOrbital, qnMomentum));
+  if(largestAngular<float>(qnOrbital, qnMomentum) != HUGE_VAL &&
+     (!radial || largestRadial<float>(qnPrincipal, qnOrbital, atomNumber) != HUGE_VAL) &&
+     normTheta >= std::numeric_limits<float>::min() && normR >= std::numeric_limits<float>::min())
+    precision = PRECISION_FLOAT;
+  else if(largestAngular<double>(qnOrbital, qnMomentum) != HUGE_VAL &&
+          (!radial || largestRadial<double>(qnPrincipal, qnOrbital, atomNumber) != HUGE_VAL) &&
+          normTheta >= std::numeric_limits<double>::min() && normR >= std::numeric_limits<double>::min())
+    precision = PRECISION_DOUBLE;
+  else if(largestAngular<long double>(qnOrbital, qnMomentum) != HUGE_VAL &&
+          (!radial || largestRadial<long double>(qnPrincipal, qnOrbital, atomNumber) != HUGE_VAL) &&
+          normTheta >= std::numeric_limits<long double>::min() && normR >= std::numeric_limits<long double>::min())
+    precision = PRECISION_LONG_DOUBLE;
+  qDebug("required precision = %d", precision);
+  if(precision == PRECISION_UNKNOWN)
   {
-  // notify the thread has ended
-  QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1002));
-  QApplication::postEvent(receiver, e);
+    // notify the thread has ended
+    QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1002));
+    QApplication::postEvent(receiver, e);
     qDebug("exceeded long double limits");
     return;
   }
-  if(neededPrecision != PRECISION_FLOAT)
+
+  // clear the data (the stream is cleared by its consumer)
+  maximumRadius = 0.0f;
+  progress = 0;
+
+  if(calculationType == RadialPart)
+  {
+    // a single line of points is not worth dividing
+    if(precision == PRECISION_FLOAT)
+      calcRadialPart<float>();
+    else if(precision == PRECISION_DOUBLE)
+      calcRadialPart<double>();
+    else
+      calcRadialPart<long double>();
+  }
+  else
   {
+    ///// divide the rows of the (theta, phi) domain or the dots over a worker per processor
+    const unsigned int numWorkers = QThread::idealThreadCount() > 1 ? QThread::idealThreadCount() : 1;
+    std::vector<OrbitalWorker*> workers;
+    for(unsigned int i = 0; i < numWorkers; i++)
+    {
+      workers.push_back(new OrbitalWorker(this, i, numWorkers));
+      workers.back()->start(QThread::LowPriority);
+    }
+
+    ///// notify the combined progress until all workers have finished
+    for(unsigned int i = 0; i < numWorkers; i++)
+    {
+      while(!workers[i]->wait(progressInterval))
+      {
+        unsigned int totalProgress = 0;
+        for(unsigned int j = 0; j < numWorkers; j++)
+          totalProgress += static_cast<int>(workers[j]->progress);
+        progress = totalProgress;
+        QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1001),&progress);
+        QApplication::postEvent(receiver, e);
+      }
+    }
+
+    ///// merge the results
+    for(unsigned int i = 0; i < numWorkers; i++)
+    {
+      if(workers[i]->maximumRadius > maximumRadius)
+        maximumRadius = workers[i]->maximumRadius;
+      delete workers[i];
+    }
+  }
+
   // notify the thread has ended
   QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1002));
   QApplication::postEvent(receiver, e);
-    qDebug("precision higher than float not implemented yet");
-    return;
+}
+
+///// calcPart ////////////////////////////////////////////////////////////////
+void OrbitalThread::calcPart(OrbitalWorker* worker)
+/// Does the part of the calculation assigned to a worker with the needed
+/// precision. It is called from the worker threads.
+{
+  switch(precision)
+  {
+    case PRECISION_FLOAT:
+            calcPart<float>(worker);
+            break;
+    case PRECISION_DOUBLE:
+            calcPart<double>(worker);
+            break;
+    case PRECISION_LONG_DOUBLE:
+            calcPart<long double>(worker);
+            break;
+    default:
+            break;
   }
+}
 
+///// calcPart ////////////////////////////////////////////////////////////////
+template <class T> void OrbitalThread::calcPart(OrbitalWorker* worker)
+/// Does the part of the calculation assigned to a worker using the
+/// floating point type T.
+{
   switch(calculationType)
   {
     case IsoProbability: 
-            calcIsoProbability();
+            calcIsoProbability<T>(worker);
             break;
     case AccumulatedProbability: 
-            calcAccumulatedProbability();
+            calcAccumulatedProbability<T>(worker);
             break;
     case Density: 
-            calcRandomDots();
-            break;
-    case RadialPart: 
-            calcRadialPart();
+            calcRandomDots<T>(worker);
             break;
     case AngularPart: 
-            calcAngularPart();
+            calcAngularPart<T>(worker);
             break;
   }
-  // notify the thread has ended
-  QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1002));
-  QApplication::postEvent(receiver, e);
 }
 
 ///// calcIsoProbability //////////////////////////////////////////////////////
-void OrbitalThread::calcIsoProbability()
+template <class T> void OrbitalThread::calcIsoProbability(OrbitalWorker* worker)
 /// Calculates the points having the given probability
 /// ( |psi|^2 ). (between 0.0 and 1.0 by definition)
+/// Only the rows of theta assigned to the worker are done.
+/// As the angular part only rescales the radial profile, R(r) is tabulated
+/// once and the crossings of each direction are found by bisecting the
+/// monotonic segments of R^2 which contain them.
 {
-  const int updateFreq = static_cast<int>(resolution*resolution)/100;
-
-  // clear the data
-  mutex->lock();
-  coords->clear();
-  mutex->unlock();
-  maximumRadius = 0.0f;
   std::vector<Point3D<float> > coordsList;
   coordsList.reserve(updateSize);
 
@@ -207,126 +256,144 @@ void OrbitalThread::calcIsoProbability()
   const int m = qnMomentum;
 
   // values independent of r, theta or phi
-  const float zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
-  const float normR = pow(2.0f*zna, 1.5f) * sqrt(factorial<float>(n-l-1)/2.0f/n/factorial<float>(n+l)); // normalization factor for the radial part
-  const float normTheta = pow(-1.0f, (m + abs(m))/2) * sqrtf( (2*l+1) * factorial<float>(l-abs(m)) / (2.0f * factorial<float>(l+abs(m)))); // normalization factor for the angular part (Theta dependent)
-  const float normPhi = 1.0f / sqrtf(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
-  const float incTheta = 180.0f/resolution; // increment for theta
-  const float incPhi = 360.0f/resolution; // increment for phi
-  const float maxR = 2.0f*static_cast<float>(n*n); // maximum value for r to check
-  const float incR = maxR / (10.0f * resolution); // increment for r
+  const T zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
+  const T normR = static_cast<T>(radialNormalization(n, l, atomNumber)); // normalization factor for the radial part
+  const T normTheta = static_cast<T>(angularNormalization(l, m)); // normalization factor for the angular part (Theta dependent)
+  const T normPhi = 1.0f / std::sqrt(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
+  const T incTheta = 180.0f/resolution; // increment for theta
+  const T incPhi = 360.0f/resolution; // increment for phi
+  const T maxR = 2.0f*static_cast<float>(n*n); // maximum value for r to check
+  const T incR = maxR / (10.0f * resolution); // increment for r
+  const T tolerance = incR / 100.0f; // the accuracy of r for points beyond maxR
+
+  ///// tabulate the radial part once for all directions
+  const unsigned int numR = static_cast<unsigned int>(maxR/incR) + 1;
+  std::vector<T> radial(numR); // R at r = i*incR
+  std::vector<T> radialSquared(numR); // R^2 at r = i*incR
+  for(unsigned int i = 0; i < numR; i++)
+  {
+    radial[i] = radialFunction<T>(2.0f*zna*incR*static_cast<T>(i), normR);
+    radialSquared[i] = radial[i]*radial[i];
+  }
+  // split R^2 in monotonic segments, bounded by its extrema (the maxima and the nodes)
+  std::vector<unsigned int> extrema;
+  extrema.push_back(0);
+  int direction = 0;
+  for(unsigned int i = 1; i < numR; i++)
+  {
+    const int newDirection = radialSquared[i] > radialSquared[i-1] ? 1 : (radialSquared[i] < radialSquared[i-1] ? -1 : 0);
+    if(newDirection == 0)
+      continue;
+    if(direction != 0 && newDirection != direction)
+      extrema.push_back(i - 1);
+    direction = newDirection;
+  }
+  extrema.push_back(numR - 1);
 
   ///// loop over THETA ///////////////
-  for(float theta = 0.0f; theta < 180.0f; theta += incTheta) // rotation away from z-axis: only 180 degrees
+  const unsigned int numTheta = static_cast<unsigned int>(ceilf(resolution)); // the number of rows of theta
+  for(unsigned int row = worker->first; row < numTheta; row += worker->stride) // rotation away from z-axis: only 180 degrees
   {
+    worker->seed(row);
+    const T theta = row*incTheta;
     ///// loop over PHI ///////////////
-    for(float phi = 0.0f; phi < 360.0f; phi += incPhi) // rotation around z-axis: full 360 degrees
+    for(T phi = 0.0f; phi < 360.0f; phi += incPhi) // rotation around z-axis: full 360 degrees
     {
-      // notify the progress
-      progress = static_cast<int>(theta/incTheta * resolution + phi/incPhi);
-      if(progress % updateFreq == 0)
-      {
-        QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1001),&progress);
-        QApplication::postEvent(receiver, e);
-      }
+      worker->progress.fetchAndAddRelaxed(1);
                         
       // randomize theta within its square
-      const float randTheta = theta + random(-incTheta/2.0f, incTheta/2.0f);
+      const T randTheta = theta + worker->random(-incTheta/2.0f, incTheta/2.0f);
       // determine whether this point is to be drawn (|sin(theta)| function is maximum near the equator and zero at the poles)
-      if(random(0.0f, 1.0f) > fabs(sinf(randTheta*Point3D<float>::DEGTORAD)))
+      if(worker->random(0.0f, 1.0f) > std::fabs(std::sin(randTheta*Point3D<float>::DEGTORAD)))
         continue;
       // randomize phi within its square
-      const float randPhi = phi + random(-incPhi/2.0f, incPhi/2.0f);
+      const T randPhi = phi + worker->random(-incPhi/2.0f, incPhi/2.0f);
         
       // get the result for theta
-      const float partTheta = normTheta * associatedLegendre(cosf(randTheta*Point3D<float>::DEGTORAD), abs(m), l);
+      const T partTheta = normTheta * associatedLegendre<T>(std::cos(randTheta*Point3D<float>::DEGTORAD), abs(m), l);
       // get the result for phi
-      float partPhi = normPhi;
+      T partPhi = normPhi;
       if(m == 0)
-        partPhi /= sqrtf(2.0f);
+        partPhi /= std::sqrt(2.0f);
       else if(m > 0)
-       partPhi *= sinf(m*randPhi*Point3D<float>::DEGTORAD);
+       partPhi *= std::sin(m*randPhi*Point3D<float>::DEGTORAD);
       else
-       partPhi *= cosf(m*randPhi*Point3D<float>::DEGTORAD);
+       partPhi *= std::cos(m*randPhi*Point3D<float>::DEGTORAD);
 
       // total angular result
-      const float partY = partTheta * partPhi;
-
-      ///// loop over R ///////////////
-      float r = incR;
-      float newProbability = 0.0f;
-      const unsigned int maxPoints = l == 0 ? 2*n -1 : 2*(n - l); // the maximum number of times a value can be the given probability
-      unsigned int numPoints = 0;
-      // determine a starting oldProbability (for r = 0.0f)
-      float oldProbability = pow(partY * normR * associatedLaguerre(0.0f, 2*l+1, n-l-1) , 2);
-      // start the loop
-      while(r < maxR && numPoints < maxPoints)
-      {
-        if(stopRequested)
-          return;
-        const float rho = 2.0f * zna * r;
-        const float partR = normR * pow(rho, static_cast<int>(l)) * exp(-rho/2.0f) * associatedLaguerre(rho, 2*l+1, n-l-1);
+      const T partY = partTheta * partPhi;
 
-        newProbability = partY * partR * partY * partR;
-        //totalProbability += 4.0f * Point3D<float>::PI * newProbability * r*r / resolution;
+      if(partY == 0.0f)
+        continue; // on an angular node
+      if(stopRequested)
+        return;
 
-        if(r > incR && ((oldProbability <= probability && newProbability >= probability) || (oldProbability >= probability && newProbability <= probability)))
+      ///// find the crossings in the radial profile ///////////////
+      // |Y*R|^2 = probability <=> R^2 = probability/Y^2
+      const T level = probability/(partY*partY);
+      for(unsigned int segment = 1; segment < extrema.size(); segment++)
+      {
+        unsigned int lower = extrema[segment - 1];
+        unsigned int upper = extrema[segment];
+        const bool lowerAbove = radialSquared[lower] >= level;
+        if((radialSquared[upper] >= level) == lowerAbove)
+          continue; // R^2 is monotonic in this segment, so no crossing
+        // bisect down to the interval containing the crossing
+        while(upper - lower > 1)
         {
-            // found a point
-            const float minProb = oldProbability < newProbability ? oldProbability : newProbability;
-            const float maxProb = oldProbability > newProbability ? oldProbability : newProbability;
-            const float interpolatedR = r + incR * (probability - minProb)/(maxProb-minProb);
-
-            //if(theta <= 180.0f/resolution && phi <= 360.0f/resolution)
-            //  qDebug("point found at r = %f, interpolatedR = %f", r, interpolatedR);
-
-            numPoints++;
-            Point3D<float> newCoord;
-            newCoord.setPolar(randTheta, randPhi, interpolatedR);
-            newCoord.setID(partY*partR > 0.0f ? 1 : 0); // misuse Point3D's ID to store the phase (1 = pos, 0 = neg)
-            coordsList.push_back(newCoord);
-            updateList(coordsList);
-            if(r > maximumRadius) maximumRadius = r;
+          const unsigned int middle = (lower + upper)/2;
+          if((radialSquared[middle] >= level) == lowerAbove)
+            lower = middle;
+          else
+            upper = middle;
         }
-        oldProbability = newProbability;
-        r += incR;
+        const T r = (static_cast<T>(lower) + (level - radialSquared[lower])/(radialSquared[upper] - radialSquared[lower])) * incR;
+        const T partR = radialSquared[lower] > radialSquared[upper] ? radial[lower] : radial[upper]; // the sign of R between the nodes
+
+        Point3D<float> newCoord;
+        newCoord.setPolar(randTheta, randPhi, r);
+        newCoord.setID(partY*partR > 0.0f ? 1 : 0); // misuse Point3D's ID to store the phase (1 = pos, 0 = neg)
+        coordsList.push_back(newCoord);
+        updateList(coordsList);
+        if(r > worker->maximumRadius) worker->maximumRadius = r;
       }
-      
-      if(numPoints < maxPoints && oldProbability > probability)
-      {
-        //if(theta < 180.0f/resolution && phi < 360.0f/resolution)
-        //  qDebug("trying remaining space");
 
-        // the remaining cloud still has at least one point with the given probability
-        while(true)
+      if(radialSquared.back() > level)
+      {
+        // the remaining cloud still has a point with the given probability
+        // beyond the table, where R^2 only decreases: bracket and bisect it
+        T lowerR = incR * static_cast<T>(radialSquared.size() - 1);
+        T upperR = lowerR + maxR;
+        T partR = radialFunction<T>(2.0f*zna*upperR, normR);
+        while(partR*partR > level)
         {
           if(stopRequested)
             return;
-          const float rho = 2.0f * zna * r;
-          const float partR = normR * pow(rho, static_cast<int>(l)) * exp(-rho/2.0f) * associatedLaguerre(rho, 2*l+1, n-l-1);
-          newProbability = partY * partR * partY * partR;
-          if(oldProbability >= probability && newProbability <= probability)
+          lowerR = upperR;
+          upperR += maxR;
+          partR = radialFunction<T>(2.0f*zna*upperR, normR);
+        }
+        while(upperR - lowerR > tolerance)
+        {
+          const T middleR = (lowerR + upperR)/2.0f;
+          const T middlePartR = radialFunction<T>(2.0f*zna*middleR, normR);
+          if(middlePartR*middlePartR > level)
+            lowerR = middleR;
+          else
           {
-            const float interpolatedR = r + incR * (probability - newProbability)/(oldProbability-newProbability);
-
-            //if(theta <= 180.0f/resolution && phi <= 360.0f/resolution)
-            //  qDebug("extra point found at r = %f, interpolatedR = %f", r, interpolatedR);
-
-            numPoints++;
-            Point3D<float> newCoord;
-            newCoord.setPolar(randTheta, randPhi, interpolatedR);
-            newCoord.setID(partY*partR > 0.0f ? 1 : 0); 
-            //mutex->lock();
-            //coords->push_back(newCoord);
-            //mutex->unlock();
-            coordsList.push_back(newCoord);
-            updateList(coordsList);
-            if(r > maximumRadius) maximumRadius = r;
-            break;
+            upperR = middleR;
+            partR = middlePartR;
           }
-          oldProbability = newProbability;
-          r += incR;
         }
+        if(partR == 0.0f)
+          partR = radial.back(); // underflow: the tail keeps the sign of the last segment
+
+        Point3D<float> newCoord;
+        newCoord.setPolar(randTheta, randPhi, upperR);
+        newCoord.setID(partY*partR > 0.0f ? 1 : 0); 
+        coordsList.push_back(newCoord);
+        updateList(coordsList);
+        if(upperR > worker->maximumRadius) worker->maximumRadius = upperR;
       }
     }    
   }
@@ -334,17 +401,11 @@ void OrbitalThread::calcIsoProbability()
 }
 
 ///// calcAccumulatedProbability //////////////////////////////////////////////
-void OrbitalThread::calcAccumulatedProbability()
+template <class T> void OrbitalThread::calcAccumulatedProbability(OrbitalWorker* worker)
 /// Calculates the points having the given accumulated probability
 /// ( |psi|^2 ). (between 0.0 and 1.0 by definition);
+/// Only the rows of theta assigned to the worker are done.
 {
-  const int updateFreq = static_cast<int>(resolution*resolution)/100;
-
-  // clear the data
-  mutex->lock();
-  coords->clear();
-  mutex->unlock();
-  maximumRadius = 0.0f;
   std::vector<Point3D<float> > coordsList;
   coordsList.reserve(updateSize);
 
@@ -354,63 +415,60 @@ void OrbitalThread::calcAccumulatedProbability()
   const int m = qnMomentum;
   
   // values independent of r, theta or phi
-  const float zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
-  const float normR = pow(2.0f*zna, 1.5f) * sqrt(factorial<float>(n-l-1)/2.0f/n/factorial<float>(n+l)); // normalization factor for the radial part
-  const float normTheta = pow(-1.0f, (m + abs(m))/2) * sqrtf( (2*l+1) * factorial<float>(l-abs(m)) / (2.0f * factorial<float>(l+abs(m)))); // normalization factor for the angular part (Theta dependent)
-  const float normPhi = 1.0f / sqrtf(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
-  const float incTheta = 180.0f/resolution; // increment for theta
-  const float incPhi = 360.0f/resolution; // increment for phi
-  const float maxR = 2.0f*static_cast<float>(n*n); // maximum value for r to check
-  const float incR = maxR / (10.0f * resolution); // increment for r
+  const T zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
+  const T normR = static_cast<T>(radialNormalization(n, l, atomNumber)); // normalization factor for the radial part
+  const T normTheta = static_cast<T>(angularNormalization(l, m)); // normalization factor for the angular part (Theta dependent)
+  const T normPhi = 1.0f / std::sqrt(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
+  const T incTheta = 180.0f/resolution; // increment for theta
+  const T incPhi = 360.0f/resolution; // increment for phi
+  const T maxR = 2.0f*static_cast<float>(n*n); // maximum value for r to check
+  const T incR = maxR / (10.0f * resolution); // increment for r
   
   ///// loop over THETA ///////////////
-  for(float theta = 0.0f; theta < 180.0f; theta += incTheta) // rotation away from z-axis: only 180 degrees
+  const unsigned int numTheta = static_cast<unsigned int>(ceilf(resolution)); // the number of rows of theta
+  for(unsigned int row = worker->first; row < numTheta; row += worker->stride) // rotation away from z-axis: only 180 degrees
   {
+    worker->seed(row);
+    const T theta = row*incTheta;
 
     ///// loop over PHI ///////////////
-    for(float phi = 0.0f; phi < 360.0f; phi += incPhi) // rotation around z-axis: full 360 degrees
+    for(T phi = 0.0f; phi < 360.0f; phi += incPhi) // rotation around z-axis: full 360 degrees
     {
-      // notify the progress
-      progress = static_cast<int>(theta/incTheta * resolution + phi/incPhi);
-      if(progress % updateFreq == 0)
-      {
-        QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1001),&progress);
-        QApplication::postEvent(receiver, e);
-      }
+      worker->progress.fetchAndAddRelaxed(1);
 
       // randomize theta within its square
-      const float randTheta = theta + random(-incTheta/2.0f, incTheta/2.0f);
+      const T randTheta = theta + worker->random(-incTheta/2.0f, incTheta/2.0f);
       // determine whether this point is to be drawn (|sin(theta)| function is maximum near the equator and zero at the poles)
-      if(random(0.0f, 1.0f) > fabs(sinf(randTheta*Point3D<float>::DEGTORAD)))
+      if(worker->random(0.0f, 1.0f) > std::fabs(std::sin(randTheta*Point3D<float>::DEGTORAD)))
         continue;
       
       // get the result for theta
-      const float partTheta = normTheta * associatedLegendre(cosf(randTheta*Point3D<float>::DEGTORAD), abs(m), l);
+      const T partTheta = normTheta * associatedLegendre<T>(std::cos(randTheta*Point3D<float>::DEGTORAD), abs(m), l);
 
       // randomize phi within its square
-      const float randPhi = phi + random(-incPhi/2.0f, incPhi/2.0f);
+      const T randPhi = phi + worker->random(-incPhi/2.0f, incPhi/2.0f);
       // get the result for phi
-      float partPhi = normPhi;
+      T partPhi = normPhi;
       if(m == 0)
-        partPhi /= sqrtf(2.0f);
+        partPhi /= std::sqrt(2.0f);
       else if(m > 0)
-       partPhi *= sinf(m*randPhi*Point3D<float>::DEGTORAD);
+       partPhi *= std::sin(m*randPhi*Point3D<float>::DEGTORAD);
       else
-       partPhi *= cosf(m*randPhi*Point3D<float>::DEGTORAD);
+       partPhi *= std::cos(m*randPhi*Point3D<float>::DEGTORAD);
 
       // total angular result
-      const float partY = partTheta * partPhi;
+      const T partY = partTheta * partPhi;
 
       ///// loop over R ///////////////
-      float r = 0.0f;
-      float totalProbability = 0.0f;
-      float amplitude = 0.0f;
+      T r = 0.0f;
+      T totalProbability = 0.0f;
+      T amplitude = 0.0f;
       while (r < maxR)
       {
         if(stopRequested)
           return;
-        const float rho = 2.0f * zna * r;
-        const float partR = normR * pow(rho, static_cast<int>(l)) * exp(-rho/2.0f) * associatedLaguerre(rho, 2*l+1, n-l-1);
+        const T rho = 2.0f * zna * r;
+        const T partR = normR * std::pow(rho, static_cast<T>(l)) * std::exp(-rho/2.0f) * associatedLaguerre<T>(rho, 2*l+1, n-l-1);
 
         // total amplitude
         amplitude = partY * partR;
@@ -430,23 +488,18 @@ void OrbitalThread::calcAccumulatedProbability()
       newCoord.setID(amplitude > 0.0f ? 1 : 0); 
       coordsList.push_back(newCoord);
       updateList(coordsList);
-      if(r > maximumRadius) maximumRadius = r;
+      if(r > worker->maximumRadius) worker->maximumRadius = r;
     }
   }
   updateList(coordsList, true);
 }
 
 ///// calcRandomDots //////////////////////////////////////////////////////////
-void OrbitalThread::calcRandomDots()
+template <class T> void OrbitalThread::calcRandomDots(OrbitalWorker* worker)
 /// Calculates random points according to the probability at a random point.
+/// The dots are calculated in blocks with their own random number stream
+/// and the worker calculates every stride'th block.
 {
-  const int updateFreq = static_cast<int>(numDots)/100;
-
-  // clear the data
-  mutex->lock();
-  coords->clear();
-  mutex->unlock();
-  maximumRadius = 0.0f;
   std::vector<Point3D<float> > coordsList;
   coordsList.reserve(updateSize);
 
@@ -456,115 +509,118 @@ void OrbitalThread::calcRandomDots()
   const int m = qnMomentum;
 
   // values independent of r, theta or phi
-  const float zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
-  const float normR = pow(2.0f*zna, 1.5f) * sqrt(factorial<float>(n-l-1)/2.0f/n/factorial<float>(n+l)); // normalization factor for the radial part
-  const float normTheta = pow(-1.0f, (m + abs(m))/2) * sqrtf( (2*l+1) * factorial<float>(l-abs(m)) / (2.0f * factorial<float>(l+abs(m)))); // normalization factor for the angular part (Theta dependent)
-  const float normPhi = 1.0f / sqrtf(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
-  const float maxR = 2.0f * static_cast<float>(n*n); // n*n is maximum radial probability for ns => this is the maximum radius for drawing points
-  float maxRtest = 0.0f; // => this is the maximum radius needed for the maximum probability test (0 if l == 0)
+  const T zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
+  const T normR = static_cast<T>(radialNormalization(n, l, atomNumber)); // normalization factor for the radial part
+  const T normTheta = static_cast<T>(angularNormalization(l, m)); // normalization factor for the angular part (Theta dependent)
+  const T normPhi = 1.0f / std::sqrt(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
+  const T maxR = 2.0f * static_cast<float>(n*n); // n*n is maximum radial probability for ns => this is the maximum radius for drawing points
+  T maxRtest = 0.0f; // => this is the maximum radius needed for the maximum probability test (0 if l == 0)
   if(l == n-1)
     maxRtest = static_cast<float>(n*l); // correct (= l*(l+1))
   else if(l != 0)
     maxRtest = static_cast<float>(l*(l+1)); // maximum (higher n is smaller maxRtest)
 
+  const unsigned int numBlocks = (numDots + dotsPerBlock - 1)/dotsPerBlock;
+
   // run for 1/10th of the amount (1000 points max) to get an estimate on the maximum probability
-  float maxProb = 0.0f;
-  float maxProbR = 0.0f;
+  // (all workers use the same stream for this so they start from the same estimate)
+  worker->seed(numBlocks);
+  T estimatedMaxProb = 0.0f;
+  T maxProbR = 0.0f;
   unsigned int testLimit = numDots/10 < 1000 ? numDots/10 : 1000;
   for(unsigned int i = 0; i < testLimit; i++)
   {
     if(stopRequested)
       return;
-    const float theta = random(0.0f, 180.0f);
-    const float phi = random(0.0f, 360.0f);
-    const float r = random(0.0f, maxRtest);
+    const T theta = worker->random(0.0f, 180.0f);
+    const T phi = worker->random(0.0f, 360.0f);
+    const T r = worker->random(0.0f, maxRtest);
     // calculate the probability
-    const float partTheta = normTheta * associatedLegendre(cosf(theta*Point3D<float>::DEGTORAD), abs(m), l);
-    float partPhi = normPhi;
+    const T partTheta = normTheta * associatedLegendre<T>(std::cos(theta*Point3D<float>::DEGTORAD), abs(m), l);
+    T partPhi = normPhi;
     if(m == 0)
-      partPhi /= sqrtf(2.0f);
+      partPhi /= std::sqrt(2.0f);
     else if(m > 0)
-     partPhi *= sinf(m*phi*Point3D<float>::DEGTORAD);
+     partPhi *= std::sin(m*phi*Point3D<float>::DEGTORAD);
     else
-     partPhi *= cosf(m*phi*Point3D<float>::DEGTORAD);
-    const float rho = 2.0f * zna * r;
-    const float partR = normR * pow(rho, static_cast<int>(l)) * exp(-rho/2.0f) * associatedLaguerre(rho, 2*l+1, n-l-1);
-    const float probability = pow(partTheta * partPhi * partR, 2);
-    if(probability > maxProb)
+     partPhi *= std::cos(m*phi*Point3D<float>::DEGTORAD);
+    const T rho = 2.0f * zna * r;
+    const T partR = normR * std::pow(rho, static_cast<T>(l)) * std::exp(-rho/2.0f) * associatedLaguerre<T>(rho, 2*l+1, n-l-1);
+    const T amplitude = partTheta * partPhi * partR;
+    const T probability = amplitude * amplitude;
+    if(probability > estimatedMaxProb)
     {
-      maxProb = probability;
+      estimatedMaxProb = probability;
       maxProbR = r;
     }
   }
-  qDebug("estimated maximum probability = %f", maxProb);
+  qDebug("estimated maximum probability = %f", static_cast<double>(estimatedMaxProb));
 
   // do the actual run
-  unsigned int currentDots = 0;
-  while(currentDots < numDots)
+  T maxProb = estimatedMaxProb;
+  for(unsigned int block = worker->first; block < numBlocks; block += worker->stride)
   {
-    if(stopRequested)
-      return;
+    worker->seed(block);
+    maxProb = estimatedMaxProb; // adjustments made in other blocks would depend on the number of workers
+    const unsigned int blockDots = block == numBlocks - 1 ? numDots - block*dotsPerBlock : dotsPerBlock;
+    unsigned int currentDots = 0;
+    while(currentDots < blockDots)
+    {
+      if(stopRequested)
+        return;
 
-    // generate a position in spherical coordinates
-    const float theta = random(0.1f, 179.9f);
-    const float phi = random(0.0f, 360.0f);
-    const float r = random(0.0f, maxR);
+      // generate a position in spherical coordinates
+      const T theta = worker->random(0.1f, 179.9f);
+      const T phi = worker->random(0.0f, 360.0f);
+      const T r = worker->random(0.0f, maxR);
 
-    // determine whether this point is to be drawn (|sin(theta)| function is maximum near the equator and zero at the poles)
-    if(random(0.0f, 1.0f) > fabs(sinf(theta*Point3D<float>::DEGTORAD)))
-      continue;
+      // determine whether this point is to be drawn (|sin(theta)| function is maximum near the equator and zero at the poles)
+      if(worker->random(0.0f, 1.0f) > std::fabs(std::sin(theta*Point3D<float>::DEGTORAD)))
+        continue;
 
-    // calculate the probability
-    const float partTheta = normTheta * associatedLegendre(cosf(theta*Point3D<float>::DEGTORAD), abs(m), l);
-    float partPhi = normPhi;
-    if(m == 0)
-      partPhi /= sqrtf(2.0f);
-    else if(m > 0)
-     partPhi *= sinf(m*phi*Point3D<float>::DEGTORAD);
-    else
-     partPhi *= cosf(m*phi*Point3D<float>::DEGTORAD);
-    const float rho = 2.0f * zna * r;
-    const float partR = normR * pow(rho, static_cast<int>(l)) * exp(-rho/2.0f) * associatedLaguerre(rho, 2*l+1, n-l-1);
-    const float probability = pow(partTheta * partPhi * partR, 2);
-    if(probability > maxProb)
-    {
-      maxProb = probability; // adjust while in the loop
-      maxProbR = r;
-    }
-    if(probability > random(0.0f, maxProb))
-    {
-      // add this point
-      Point3D<float> newCoord;
-      newCoord.setPolar(theta, phi, r);
-      newCoord.setID(partTheta*partPhi*partR > 0.0f ? 1 : 0); 
-      coordsList.push_back(newCoord);
-      updateList(coordsList);
-      if(r > maximumRadius) maximumRadius = r;
-      currentDots++;
-      // notify the progress
-      if(currentDots % updateFreq == 0)
+      // calculate the probability
+      const T partTheta = normTheta * associatedLegendre<T>(std::cos(theta*Point3D<float>::DEGTORAD), abs(m), l);
+      T partPhi = normPhi;
+      if(m == 0)
+        partPhi /= std::sqrt(2.0f);
+      else if(m > 0)
+       partPhi *= std::sin(m*phi*Point3D<float>::DEGTORAD);
+      else
+       partPhi *= std::cos(m*phi*Point3D<float>::DEGTORAD);
+      const T rho = 2.0f * zna * r;
+      const T partR = normR * std::pow(rho, static_cast<T>(l)) * std::exp(-rho/2.0f) * associatedLaguerre<T>(rho, 2*l+1, n-l-1);
+      const T amplitude = partTheta * partPhi * partR;
+      const T probability = amplitude * amplitude;
+      if(probability > maxProb)
       {
-        progress = currentDots;
-        QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1001),&progress);
-        QApplication::postEvent(receiver, e);
+        maxProb = probability; // adjust while in the loop
+        maxProbR = r;
+      }
+      if(probability > worker->random(0.0f, maxProb))
+      {
+        // add this point
+        Point3D<float> newCoord;
+        newCoord.setPolar(theta, phi, r);
+        newCoord.setID(amplitude > 0.0f ? 1 : 0); 
+        coordsList.push_back(newCoord);
+        updateList(coordsList);
+        if(r > worker->maximumRadius) worker->maximumRadius = r;
+        currentDots++;
+        worker->progress.fetchAndAddRelaxed(1);
       }
     }
   }
   updateList(coordsList, true);
-  qDebug("final maximum probability = %f", maxProb);
-  qDebug(" corresponding radius = %f", maxProbR);
+  qDebug("final maximum probability = %f", static_cast<double>(maxProb));
+  qDebug(" corresponding radius = %f", static_cast<double>(maxProbR));
 }
 
 ///// calcRadialPart //////////////////////////////////////////////////////////
-void OrbitalThread::calcRadialPart()
+template <class T> void OrbitalThread::calcRadialPart()
 /// Draws the radial part of the orbital.
 {
   const int updateFreq = static_cast<int>(10.0f * resolution)/100;
 
-  // clear the data
-  mutex->lock();
-  coords->clear();
-  mutex->unlock();
   std::vector<Point3D<float> > coordsList;
   coordsList.reserve(updateSize);
   
@@ -573,18 +629,18 @@ void OrbitalThread::calcRadialPart()
   const unsigned int l = qnOrbital;
 
   // values independent of r
-  const float zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
-  const float normR = pow(2.0f*zna, 1.5f) * sqrt(factorial<float>(n-l-1)/2.0f/n/factorial<float>(n+l)); // normalization factor for the radial part
-  const float maxR = 2.0f*static_cast<float>(n*n); // maximum value for r to check
-  const float incR = maxR / (10.0f * resolution); // increment for r
+  const T zna = static_cast<float>(atomNumber) / static_cast<float>(n) / abohr; // conversion factor for r->rho
+  const T normR = static_cast<T>(radialNormalization(n, l, atomNumber)); // normalization factor for the radial part
+  const T maxR = 2.0f*static_cast<float>(n*n); // maximum value for r to check
+  const T incR = maxR / (10.0f * resolution); // increment for r
 
   maximumRadius = maxR;
 
-  //float probability = 0.0f;
-  //float probabilityRadius = 0.0f;
+  //T probability = 0.0f;
+  //T probabilityRadius = 0.0f;
 
   // loop over r
-  for(float r = 0.0f; r < maxR; r += incR)
+  for(T r = 0.0f; r < maxR; r += incR)
   {
     if(stopRequested)
       return;
@@ -598,8 +654,8 @@ void OrbitalThread::calcRadialPart()
     }
 
     // calculate the value
-    const float rho = 2.0f * zna * r;
-    const float partR = normR * pow(rho, static_cast<int>(l)) * exp(-rho/2.0f) * associatedLaguerre(rho, 2*l+1, n-l-1);
+    const T rho = 2.0f * zna * r;
+    const T partR = normR * std::pow(rho, static_cast<T>(l)) * std::exp(-rho/2.0f) * associatedLaguerre<T>(rho, 2*l+1, n-l-1);
 
     // the radial part => amplitude
     Point3D<float> newCoord1(r, partR, 0.0f);
@@ -623,16 +679,10 @@ void OrbitalThread::calcRadialPart()
 }
 
 ///// calcAngularPart /////////////////////////////////////////////////////////
-void OrbitalThread::calcAngularPart()
+template <class T> void OrbitalThread::calcAngularPart(OrbitalWorker* worker)
 /// Calculates the angular part of the orbital.
+/// Only the rows of theta assigned to the worker are done.
 {
-  const int updateFreq = static_cast<int>(resolution * resolution)/100;
-
-  // clear the data
-  mutex->lock();
-  coords->clear();
-  mutex->unlock();
-  maximumRadius = 0.0f;
   std::vector<Point3D<float> > coordsList;
   coordsList.reserve(updateSize);
   
@@ -641,59 +691,56 @@ void OrbitalThread::calcAngularPart()
   const int m = qnMomentum;
 
   // values independent of theta or phi
-  const float normTheta = pow(-1.0f, (m + abs(m))/2) * sqrtf( (2*l+1) * factorial<float>(l-abs(m)) / (2.0f * factorial<float>(l+abs(m)))); // normalization factor for the angular part (Theta dependent)
-  const float normPhi = 1.0f / sqrtf(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
-  const float incTheta = 180.0f/resolution; // increment for theta
-  const float incPhi = 360.0f/resolution; // increment for phi
+  const T normTheta = static_cast<T>(angularNormalization(l, m)); // normalization factor for the angular part (Theta dependent)
+  const T normPhi = 1.0f / std::sqrt(Point3D<float>::PI); // normalization factor for the angular part (Phi dependent)
+  const T incTheta = 180.0f/resolution; // increment for theta
+  const T incPhi = 360.0f/resolution; // increment for phi
 
   ///// loop over THETA ///////////////
-  for(float theta = 0.0f; theta < 180.0f; theta += incTheta) // rotation away from z-axis: only 180 degrees
+  const unsigned int numTheta = static_cast<unsigned int>(ceilf(resolution)); // the number of rows of theta
+  for(unsigned int row = worker->first; row < numTheta; row += worker->stride) // rotation away from z-axis: only 180 degrees
   {
+    worker->seed(row);
+    const T theta = row*incTheta;
 
     ///// loop over PHI ///////////////
-    for(float phi = 0.0f; phi < 360.0f; phi += incPhi) // rotation around z-axis: full 360 degrees
+    for(T phi = 0.0f; phi < 360.0f; phi += incPhi) // rotation around z-axis: full 360 degrees
     {              
       if(stopRequested)
         return;
 
-      // notify the progress
-      progress = static_cast<int>(theta/incTheta * resolution + phi/incPhi);
-      if(progress % updateFreq == 0)
-      {
-        QCustomEvent* e = new QCustomEvent(static_cast<QEvent::Type>(1001),&progress);
-        QApplication::postEvent(receiver, e);
-      }
+      worker->progress.fetchAndAddRelaxed(1);
 
       // randomize theta within its square
-      const float randTheta = theta + random(-incTheta/2.0f, incTheta/2.0f);
+      const T randTheta = theta + worker->random(-incTheta/2.0f, incTheta/2.0f);
       // determine whether this point is to be drawn (|sin(theta)| function is maximum near the equator and zero at the poles)
-      if(random(0.0f, 1.0f) > fabs(sinf(randTheta*Point3D<float>::DEGTORAD)))      
+      if(worker->random(0.0f, 1.0f) > std::fabs(std::sin(randTheta*Point3D<float>::DEGTORAD)))      
         continue;
       // get the result for theta
-      const float partTheta = normTheta * associatedLegendre(cosf(randTheta*Point3D<float>::DEGTORAD), abs(m), l);
+      const T partTheta = normTheta * associatedLegendre<T>(std::cos(randTheta*Point3D<float>::DEGTORAD), abs(m), l);
 
       // randomize phi within its square
-      const float randPhi = phi + random(-incPhi/2.0f, incPhi/2.0f);
+      const T randPhi = phi + worker->random(-incPhi/2.0f, incPhi/2.0f);
       // get the result for phi
-      float partPhi = normPhi;
+      T partPhi = normPhi;
       if(m == 0)
-        partPhi /= sqrtf(2.0f);
+        partPhi /= std::sqrt(2.0f);
       else if(m > 0)
-       partPhi *= sinf(m*randPhi*Point3D<float>::DEGTORAD);
+       partPhi *= std::sin(m*randPhi*Point3D<float>::DEGTORAD);
       else
-       partPhi *= cosf(m*randPhi*Point3D<float>::DEGTORAD);
+       partPhi *= std::cos(m*randPhi*Point3D<float>::DEGTORAD);
 
       // total angular result
-      const float partY = partTheta * partPhi;
+      const T partY = partTheta * partPhi;
 
       // save the data
-      const float r = fabs(partY);
+      const T r = std::fabs(partY);
       Point3D<float> newCoord;
       newCoord.setPolar(randTheta, randPhi, r);
       newCoord.setID(partY > 0.0f ? 1 : 0); 
       coordsList.push_back(newCoord);
       updateList(coordsList);
-      if(r > maximumRadius) maximumRadius = r;
+      if(r > worker->maximumRadius) worker->maximumRadius = r;
     }
   }
   updateList(coordsList, true);
@@ -701,90 +748,205 @@ void OrbitalThread::calcAngularPart()
 
 ///// updateList //////////////////////////////////////////////////////////////
 void OrbitalThread::updateList(std::vector<Point3D<float> >& newCoords, bool final)
-/// Updates the shared coordinate list with a set of newly calculated points.
-/// If final is true, the update is forces, even if less than updateSize values are present.
+/// Publishes a set of newly calculated points to the stream without
+/// waiting for the view. If final is true, the update is forced, even if less
+/// than updateSize values are present.
 {
   if(newCoords.size() >= updateSize || (final && !newCoords.empty()))
   {
-    mutex->lock();
-    coords->insert(coords->end(), newCoords.begin(), newCoords.end());
-    mutex->unlock();
-    newCoords.clear();
-    qDebug("Added %d new points", updateSize);
+    stream->publish(newCoords); // leaves newCoords empty
+    newCoords.reserve(updateSize);
   }
 }
 
+///// radialFunction ////////////////////////////////////////////////////////
+template <class T> T OrbitalThread::radialFunction(const T rho, const T normR)
+/// Returns the radial part R of the orbital for rho = 2Zr/(n*a0), given
+/// its normalization factor.
+{
+  const unsigned int n = qnPrincipal;
+  const unsigned int l = qnOrbital;
+  return normR * std::pow(rho, static_cast<T>(l)) * std::exp(-rho/2.0f) * associatedLaguerre<T>(rho, 2*l+1, n-l-1);
+}
+
 ///// associatedLegendre //////////////////////////////////////////////////////
-float OrbitalThread::associatedLegendre(const float x, const int m, const unsigned int l)
-/// Calculates the associated Legendre polynomial P ^m _l (x).
+template <class T> T OrbitalThread::associatedLegendre(const T x, const int m, const unsigned int l)
+/// Calculates the associated Legendre polynomial P ^m _l (x) (without the
+/// Condon-Shortley phase) for m >= 0. It uses the upward recurrence in l
+/// starting from P ^m _m (x) = (2m-1)!! (1-x^2)^(m/2), which is stable and
+/// needs no factorials.
 {
-  float prefactor = pow(1.0f - x*x, static_cast<float>(m)/2.0f) / pow(2.0f, static_cast<int>(l));
-  int upperBound = 0;
-  if(((l-m) % 2) == 0) // l-m is even
-    upperBound = (l-m)/2;
-  else // l-m is odd
-    upperBound = (l-m-1)/2;
-
-  float result = 0.0f;
-  for(int j = 0; j <= upperBound; j++)
+  ///// P ^m _m
+  T pmm = 1.0f;
+  if(m > 0)
+  {
+    const T sinTheta = std::sqrt((1.0f - x)*(1.0f + x));
+    T oddFactor = 1.0f;
+    for(int i = 1; i <= m; i++)
+    {
+      pmm *= oddFactor*sinTheta;
+      oddFactor += 2.0f;
+    }
+  }
+  if(l == static_cast<unsigned int>(m))
+    return pmm;
+
+  ///// P ^m _m+1
+  T pmm1 = x*static_cast<float>(2*m + 1)*pmm;
+
+  ///// P ^m _l
+  for(unsigned int ll = m + 2; ll <= l; ll++)
   {
-    float tempvar = pow(-1.0f, j)*factorial<float>(2*l-2*j);
-    tempvar /= factorial<float>(j)*factorial<float>(l-j)*factorial<float>(l-abs(m)-2*j);
-    tempvar *= pow(x, static_cast<int>(l-m-2*j));
-    result +=  tempvar;
+    const T pll = (x*static_cast<float>(2*ll - 1)*pmm1 - static_cast<float>(ll + m - 1)*pmm) / static_cast<float>(ll - m);
+    pmm = pmm1;
+    pmm1 = pll;
   }
-  return prefactor*result;
+  return pmm1;
 }
 
 ///// associatedLaguerre //////////////////////////////////////////////////////
-float OrbitalThread::associatedLaguerre(const float x, const int m, const unsigned int n)
-/// Calculates the associated Laguerre polynomial L ^m _n (x).
+template <class T> T OrbitalThread::associatedLaguerre(const T x, const int m, const unsigned int n)
+/// Calculates the associated Laguerre polynomial L ^m _n (x) with the upward
+/// recurrence (k+1) L ^m _k+1 = (2k+1+m-x) L ^m _k - (k+m) L ^m _k-1.
 {  
-  // from MathWorld: Rodrigues representation of the Laguerre polynomial (Arfken & Webers definition)
   if(n == 0)
     return 1.0f;
-  float result = 0.0f;
-  for(unsigned int j = 0; j <= n; j++)
-    result += pow(-1.0f, static_cast<int>(j)) * factorial<float>(n+m) / factorial<float>(n-j) / factorial<float>(m+j) / factorial<float>(j) * pow(x, static_cast<int>(j));
+  T lk1 = 1.0f; // L ^m _k-1
+  T lk = 1.0f + static_cast<float>(m) - x; // L ^m _k
+  for(unsigned int k = 1; k < n; k++)
+  {
+    const T lk2 = ((static_cast<float>(2*k + 1 + m) - x)*lk - static_cast<float>(k + m)*lk1) / static_cast<float>(k + 1);
+    lk1 = lk;
+    lk = lk2;
+  }
+  return lk;
+}
+
+///// factorialRatio //////////////////////////////////////////////////////////
+long double OrbitalThread::factorialRatio(const unsigned int numerator, const unsigned int denominator)
+/// Returns numerator!/denominator! without calculating the factorials
+/// themselves, so the ratio doesn't overflow for large arguments. It is
+/// always calculated in long double as it easily underflows a float.
+{
+  long double result = 1.0L;
+  for(unsigned int i = denominator + 1; i <= numerator; i++)
+    result *= static_cast<long double>(i);
+  for(unsigned int i = numerator + 1; i <= denominator; i++)
+    result /= static_cast<long double>(i);
+  return result;
+}
+
+///// radialNormalization /////////////////////////////////////////////////////
+long double OrbitalThread::radialNormalization(const unsigned int n, const unsigned int l, const unsigned int Z)
+/// Returns the normalization factor of the radial part for the given
+/// quantum numbers.
+{
+  const long double zna = static_cast<long double>(Z) / static_cast<long double>(n) / static_cast<long double>(abohr);
+  return std::pow(2.0L*zna, 1.5L) * std::sqrt(factorialRatio(n-l-1, n+l)/static_cast<long double>(2*n));
+}
+
+///// angularNormalization ////////////////////////////////////////////////////
+long double OrbitalThread::angularNormalization(const unsigned int l, const int m)
+/// Returns the normalization factor of the Theta dependent angular part for
+/// the given quantum numbers, including the Condon-Shortley phase.
+{
+  return ((m + abs(m))/2 % 2 == 0 ? 1.0L : -1.0L) * std::sqrt(static_cast<long double>(2*l+1) * factorialRatio(l-abs(m), l+abs(m)) / 2.0L);
+}
+
+///// largestAngular //////////////////////////////////////////////////////////
+template <class T> T OrbitalThread::largestAngular(const unsigned int l, const int m)
+/// Returns an approximation to the largest intermediate value of the angular
+/// part for the given quantum numbers: (2|m|-1)!! from P ^m _m, with a factor
+/// 2l+1 as a margin for the recurrence.
+{
+  T result = static_cast<T>(2*l + 1);
+  for(int i = 3; i < 2*abs(m); i += 2)
+    result *= static_cast<T>(i);
   return result;
 }
 
-///// factorial ///////////////////////////////////////////////////////////////
-template <class T> T OrbitalThread::factorial(const unsigned int number)
-/// Calculates the factorial function of the given number.
-/// Not too efficient but does the job.
-/// Converted to template because the limits of unsigned int's are reached for n+l=13
-/// (for unsigned long int's it's n+l=21).
+///// largestRadial ///////////////////////////////////////////////////////////
+template <class T> T OrbitalThread::largestRadial(const unsigned int n, const unsigned int l, const unsigned int Z)
+/// Returns an approximation to the largest intermediate value of the radial
+/// part for the given quantum numbers: rho^l times the leading term of the
+/// Laguerre polynomial, rho^(n-l-1)/(n-l-1)!, at the largest radius (rho =
+/// 4Zn). An extra factor rho is a margin for the recurrence.
 {
-  if(number <= 1)
-    return 1;
-  unsigned int counter = number - 1;
-  T result = static_cast<T>(number);
-  while(counter > 1)
+  const T rhoMax = static_cast<T>(4*Z*n)/static_cast<T>(abohr);
+  T result = rhoMax;
+  for(unsigned int i = 0; i < l; i++)
+    result *= rhoMax;
+  for(unsigned int k = 1; k < n - l; k++)
+    result *= rhoMax/static_cast<T>(k);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// class OrbitalWorker                                                 /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// Constructor /////////////////////////////////////////////////////////////
+OrbitalWorker::OrbitalWorker(OrbitalThread* parentThread, const unsigned int index, const unsigned int number) : QThread(),
+  first(index),
+  stride(number),
+  maximumRadius(0.0f),
+  progress(0),
+  thread(parentThread)
+/// The constructor. The worker does every number'th row of the domain
+/// starting at row index.
+{
+  assert(parentThread != 0);
+  assert(index < number);
+  seed(0);
+}
+
+///// seed ////////////////////////////////////////////////////////////////////
+void OrbitalWorker::seed(const unsigned int stream)
+/// Starts the random number sequence of the given stream (a row of the
+/// domain or a block of dots) for the seed of the calculation. As every
+/// stream always gives the same numbers, the result does not depend on the
+/// number of workers.
+{
+  unsigned int z = thread->randomSeed;
+  z = (z ^ (z >> 16))*0x85ebca6bu;
+  z = (z ^ (z >> 13))*0xc2b2ae35u;
+  z ^= z >> 16;
+  z += 4u*0x9e3779b9u*stream;
+  for(unsigned int i = 0; i < 4; i++)
   {
-    result *= static_cast<T>(counter);
-    counter--;
+    // splitmix-like expansion of (seed, stream) into the four state words
+    z += 0x9e3779b9u;
+    unsigned int x = z;
+    x = (x ^ (x >> 16))*0x85ebca6bu;
+    x = (x ^ (x >> 13))*0xc2b2ae35u;
+    randomState[i] = x ^ (x >> 16);
   }
-  return result;
+  if((randomState[0] | randomState[1] | randomState[2] | randomState[3]) == 0)
+    randomState[0] = 1; // the all zero state is a fixed point
 }
 
 ///// random //////////////////////////////////////////////////////////////////
-float OrbitalThread::random(const float min, const float max)
-/// Returns a random floating point number between min and max.
-{  
-  return min + static_cast<float>(rand())/RAND_MAX*(max - min);
+float OrbitalWorker::random(const float min, const float max)
+/// Returns a random floating point number between min and max. Each worker
+/// has its own xoshiro128+ generator, as rand() is not thread-safe. The upper
+/// 24 bits of the result fill the mantissa of the float.
+{
+  const unsigned int result = randomState[0] + randomState[3];
+  const unsigned int t = randomState[1] << 9;
+  randomState[2] ^= randomState[0];
+  randomState[3] ^= randomState[1];
+  randomState[1] ^= randomState[2];
+  randomState[0] ^= randomState[3];
+  randomState[2] ^= t;
+  randomState[3] = (randomState[3] << 11) | (randomState[3] >> 21);
+  return min + static_cast<float>(result >> 8)/16777216.0f*(max - min);
 }
 
-///// largestResult ///////////////////////////////////////////////////////////
-template <class T> T OrbitalThread::largestResult(const unsigned int n, const unsigned int l, const int m, const unsigned int Z)
-/// Returns an approximation to the largest possible result for
-/// the given quantum numbers.
+///// run /////////////////////////////////////////////////////////////////////
+void OrbitalWorker::run()
+/// Does the part of the work of this worker.
 {
-  T partPhi = static_cast<T>(0.5641895835); // 1/sqrt(PI) // is partial specialization for local variables possible
-  T partTheta = sqrt(factorial<T>(2*l+1) * factorial<T>(l-abs(m)) / 2.0 / factorial<T>(l+abs(m))) * associatedLegendre(1.0f, abs(m), l);
-  T rmax = static_cast<T>(3*n*n);
-  T partR = pow(2.0*Z/n/abohr, 1.5) * sqrt(factorial<T>(n-l-1)/2.0/n/factorial<T>(n+l)) * pow(2.0*Z/n/abohr*rmax, static_cast<int>(l)) * associatedLaguerre(2.0*Z/n/abohr*rmax, 2*l+1, n-l-1);
-  return partPhi*partTheta*partR;
+  thread->calcPart(this);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -793,4 +955,6 @@ template <class T> T OrbitalThread::largestResult(const unsigned int n, const un
 
 const float OrbitalThread::abohr = 1.0f;
 const unsigned int OrbitalThread::updateSize = 1000;
+const unsigned long OrbitalThread::progressInterval = 100;
+const unsigned int OrbitalThread::dotsPerBlock = 1000;
 
@@ -30,11 +30,14 @@
 ///// Header files ////////////////////////////////////////////////////////////
 
 // Qt header files
+#include <qcheckbox.h>
 #include <qcombobox.h>
+#include <qdir.h>
 #include <qlabel.h>
 #include <qlayout.h>
 #include <qlineedit.h>
 #include <qprogressbar.h>
+#include <qsettings.h>
 #include <qslider.h>
 #include <qspinbox.h>
 #include <qtimer.h>
@@ -58,7 +61,8 @@
 
 ///// Constructor /////////////////////////////////////////////////////////////
 OrbitalViewerBase::OrbitalViewerBase(QWidget* parent, const char* name, bool modal, WFlags fl) : QDialog(parent, name, modal, fl),
-  calcThread(0)
+  calcThread(0),
+  calcCancelled(false)
 /// The default constructor.
 {
   // Construct the widget layout
@@ -103,6 +107,7 @@ OrbitalViewerBase::OrbitalViewerBase(QWidget* parent, const char* name, bool mod
   connect(options->PushButtonReset, SIGNAL(clicked()), view, SLOT(resetView()));
   connect(options->PushButtonSave, SIGNAL(clicked()), view, SLOT(saveImage()));
   connect(options->ToolButtonCancel, SIGNAL(clicked()), this, SLOT(cancelCalculation()));
+  connect(options->CheckBoxDiskCache, SIGNAL(toggled(bool)), this, SLOT(updateDiskCache(bool)));
   connect(options->PushButtonClose, SIGNAL(clicked()), this, SLOT(close()));
 
   connect(timer, SIGNAL(timeout()), view, SLOT(updateGL()));  
@@ -119,6 +124,11 @@ OrbitalViewerBase::OrbitalViewerBase(QWidget* parent, const char* name, bool mod
   QWhatsThis::add(options->ToolButtonUpdate, tr("Starts calculating the orbital with the requested characteristics."));
   QWhatsThis::add(options->ToolButtonCancel, tr("Stops the calculation in progress."));
 
+  // restore the settings
+  QSettings settings;
+  settings.setPath(Version::appCompany, Version::appName.lower(), QSettings::User);
+  options->CheckBoxDiskCache->setChecked(settings.readBoolEntry(settingsPrefix() + "disk_cache", false));
+
   //update the view
   updateTypeOptions(0);
   update();
@@ -129,6 +139,11 @@ OrbitalViewerBase::OrbitalViewerBase(QWidget* parent, const char* name, bool mod
 OrbitalViewerBase::~OrbitalViewerBase()
 /// The default destructor.
 {
+  // save the settings
+  QSettings settings;
+  settings.setPath(Version::appCompany, Version::appName.lower(), QSettings::User);
+  settings.writeEntry(settingsPrefix() + "disk_cache", options->CheckBoxDiskCache->isChecked());
+
   if(calcThread != 0)
   {
     if(calcThread->running())
@@ -164,10 +179,22 @@ void OrbitalViewerBase::customEvent(QCustomEvent* e)
 void OrbitalViewerBase::update()
 /// Updates the view with the values of the widgets.
 {
-  options->ToolButtonUpdate->setEnabled(false);
-  options->ToolButtonCancel->setEnabled(true);
   // update the view
   updateColors();
+
+  // show the points of a previous calculation if available
+  calcKey = cacheKey();
+  std::vector<GLfloat> negative, positive;
+  double radius;
+  if(cache.find(calcKey, negative, positive, radius))
+  {
+    view->setPoints(negative, positive);
+    view->setMaximumRadius(radius); // this forces a zoomfit and a redraw
+    return;
+  }
+
+  options->ToolButtonUpdate->setEnabled(false);
+  options->ToolButtonCancel->setEnabled(true);
   // setup the progressbar
   options->ProgressBar->setProgress(0);
   const int resolution = options->SliderResolution->value();
@@ -188,7 +215,9 @@ void OrbitalViewerBase::update()
   }
 
   // start a computation thread
-  calcThread = new OrbitalThread(this, view->getMutex(), view->getCoordinates(), 
+  view->clearPoints();
+  calcCancelled = false;
+  calcThread = new OrbitalThread(this, view->getStream(),
                                  static_cast<unsigned int>(options->ComboBoxType->currentItem()),
                                  static_cast<unsigned int>(options->ComboBoxAtom->currentItem() + 1),
                                  static_cast<unsigned int>(options->SpinBoxN->value()),
@@ -196,7 +225,8 @@ void OrbitalViewerBase::update()
                                  static_cast<int>(options->SpinBoxM->value()),
                                  static_cast<float>(options->SliderResolution->value()),
                                  options->LineEditProbability->text().toFloat(),
-                                 static_cast<unsigned int>(options->SpinBoxDots->value()));
+                                 static_cast<unsigned int>(options->SpinBoxDots->value()),
+                                 static_cast<unsigned int>(options->SpinBoxSeed->value()));
   calcThread->start(QThread::LowPriority);
 
   // update the scene every 100 ms
@@ -220,7 +250,7 @@ void OrbitalViewerBase::adjustM(int newL)
   options->SpinBoxM->setMaxValue(newL);
 }
 
-///// updateColors ///////////////////////////////////////////////////////////
+///// updateColors ////////////////////////////////////////////////////////////
 void OrbitalViewerBase::updateColors()
 /// Updates the colors for drawing the positive and negative phases of the orbitals
 {
@@ -241,6 +271,8 @@ void OrbitalViewerBase::updateTypeOptions(int type)
             options->LabelDots->setEnabled(false);
             options->SliderDots->setEnabled(false);
             options->SpinBoxDots->setEnabled(false);
+            options->LabelSeed->setEnabled(true);
+            options->SpinBoxSeed->setEnabled(true);
             if(options->LineEditProbability->text().toFloat() > 0.1f) 
               options->LineEditProbability->setText("0.0001");            
             break;
@@ -252,6 +284,8 @@ void OrbitalViewerBase::updateTypeOptions(int type)
             options->LabelDots->setEnabled(false);
             options->SliderDots->setEnabled(false);
             options->SpinBoxDots->setEnabled(false);
+            options->LabelSeed->setEnabled(true);
+            options->SpinBoxSeed->setEnabled(true);
             if(options->LineEditProbability->text().toFloat() < 0.1f)
             options->LineEditProbability->setText("0.95");
             break;
@@ -263,6 +297,8 @@ void OrbitalViewerBase::updateTypeOptions(int type)
             options->LabelDots->setEnabled(true);
             options->SliderDots->setEnabled(true);
             options->SpinBoxDots->setEnabled(true);
+            options->LabelSeed->setEnabled(true);
+            options->SpinBoxSeed->setEnabled(true);
             break;
     case OrbitalThread::RadialPart:
             options->LabelResolution->setEnabled(true);
@@ -272,6 +308,8 @@ void OrbitalViewerBase::updateTypeOptions(int type)
             options->LabelDots->setEnabled(false);
             options->SliderDots->setEnabled(false);
             options->SpinBoxDots->setEnabled(false);
+            options->LabelSeed->setEnabled(false);
+            options->SpinBoxSeed->setEnabled(false);
             break;
     case OrbitalThread::AngularPart:
             options->LabelResolution->setEnabled(true);
@@ -281,6 +319,8 @@ void OrbitalViewerBase::updateTypeOptions(int type)
             options->LabelDots->setEnabled(false);
             options->SliderDots->setEnabled(false);
             options->SpinBoxDots->setEnabled(false);
+            options->LabelSeed->setEnabled(true);
+            options->SpinBoxSeed->setEnabled(true);
   }
 }
 
@@ -291,9 +331,21 @@ void OrbitalViewerBase::cancelCalculation()
   if(calcThread == 0)
     return;
 
+  calcCancelled = true;
   calcThread->stop();
 }
 
+///// updateDiskCache /////////////////////////////////////////////////////////
+void OrbitalViewerBase::updateDiskCache(bool on)
+/// Enables or disables caching the points of the orbitals on disk in
+/// addition to memory.
+{
+  if(on)
+    cache.setDirectory(QDir::convertSeparators(QDir::homeDirPath()) + QDir::separator() + "." + Version::appName.lower() + QDir::separator() + "orbitals");
+  else
+    cache.setDirectory(QString::null);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Private Member Functions                                            /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -311,6 +363,14 @@ void OrbitalViewerBase::finishCalculation()
 
   view->setMaximumRadius(calcThread->boundingSphereRadius()); // this forces a zoomfit and a redraw
 
+  ///// keep the points of a completed calculation
+  if(!calcCancelled)
+  {
+    std::vector<GLfloat> negative, positive;
+    view->getPoints(negative, positive);
+    cache.insert(calcKey, negative, positive, calcThread->boundingSphereRadius());
+  }
+
   delete calcThread;
   calcThread = 0;
 
@@ -323,3 +383,32 @@ void OrbitalViewerBase::finishCalculation()
   timer->stop();
 }
 
+///// cacheKey ////////////////////////////////////////////////////////////////
+OrbitalCache::Key OrbitalViewerBase::cacheKey() const
+/// Returns the key identifying the orbital defined by the widgets. Only the
+/// parameters used by the chosen type are included, so changing the others
+/// doesn't force a new calculation.
+{
+  OrbitalCache::Key key;
+  key.type = static_cast<unsigned int>(options->ComboBoxType->currentItem());
+  key.atom = static_cast<unsigned int>(options->ComboBoxAtom->currentItem() + 1);
+  key.n = static_cast<unsigned int>(options->SpinBoxN->value());
+  key.l = static_cast<unsigned int>(options->SpinBoxL->value());
+  key.m = static_cast<int>(options->SpinBoxM->value());
+  key.resolution = options->SliderResolution->isEnabled() ? static_cast<float>(options->SliderResolution->value()) : 0.0f;
+  key.probability = options->LineEditProbability->isEnabled() ? options->LineEditProbability->text().toFloat() : 0.0f;
+  key.dots = options->SpinBoxDots->isEnabled() ? static_cast<unsigned int>(options->SpinBoxDots->value()) : 0;
+  key.seed = options->SpinBoxSeed->isEnabled() ? static_cast<unsigned int>(options->SpinBoxSeed->value()) : 0;
+  return key;
+}
+
+///// settingsPrefix //////////////////////////////////////////////////////////
+QString OrbitalViewerBase::settingsPrefix() const
+/// Returns the prefix of the entries of the orbital viewer in the settings.
+{
+#ifdef Q_OS_WIN32
+  return "/orbitals/";
+#else
+  return "/" + Version::appName.lower() + "/orbitals/";
+#endif
+}
@@ -31,6 +31,7 @@
 ///// Header files ////////////////////////////////////////////////////////////
 
 // STL header files
+#include <limits>
 #include <map>
 
 // C++ header files
@@ -152,6 +153,7 @@ bool PlotMapBase::loadMapFile(const QString filename, const bool noerrors)
     {
       points.clear();
       coords.clear();
+      atomIndex.invalidate();
       numPoints.setValues(0, 0, 0);
       numAtoms = 0;
       loadInProgress = false;
@@ -188,6 +190,7 @@ bool PlotMapBase::loadMapFile(const QString filename, const bool noerrors)
     atom.setValues(line.left(10).toDouble() * AUTOANG, line.mid(10,10).toDouble() * AUTOANG, line.mid(20,10).toDouble() * AUTOANG);
     coords.push_back(atom);
   }
+  atomIndex.build(coords);
   
   mapFile.close();
   plotLabel->setGrid(numPoints, delta);
@@ -654,17 +657,18 @@ void PlotMapBase::updateCrosses()
   const double showAtomsLimit = options->LineEditAtoms->text().toDouble();
       
   vector<Point3D<double> > showCoords;
-  showCoords.reserve(numAtoms);
   Point3D<double>newCoord;
-  if(options->CheckBoxAtoms->isChecked())
+  if(options->CheckBoxAtoms->isChecked() && atomIndex.isValid())
   {
-    for(unsigned int i = 0; i < numAtoms; i++)
+    ///// only show the atoms in a slab around the plane
+    const double infinity = std::numeric_limits<double>::max();
+    const vector<unsigned int> inPlane = atomIndex.withinBox(Point3D<double>(-infinity, -infinity, -showAtomsLimit), 
+                                                             Point3D<double>(infinity, infinity, showAtomsLimit));
+    showCoords.reserve(inPlane.size());
+    for(vector<unsigned int>::const_iterator it = inPlane.begin(); it != inPlane.end(); it++)
     {
-      if(fabs(coords[i].z()) > showAtomsLimit)
-        continue; // do not show atoms too far out of plane
-
       // substract the origin
-      newCoord.setValues(coords[i].x() - origin.x(), coords[i].y() - origin.y(), 0.0);
+      newCoord.setValues(coords[*it].x() - origin.x(), coords[*it].y() - origin.y(), 0.0);
       showCoords.push_back(newCoord);
     }
   }
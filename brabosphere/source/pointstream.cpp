@@ -0,0 +1,109 @@
+/***************************************************************************
+                       pointstream.cpp  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+///// Comments ////////////////////////////////////////////////////////////////
+
+/*!
+  \class PointStream
+  \brief A lock-free stream of chunks of points from calculating threads to a view.
+
+  The producers (the workers of an OrbitalThread) fill a chunk of points
+  locally and publish it as a whole with a single atomic exchange of the
+  tail of a linked list. The single consumer (the GLOrbitalView painting in
+  the GUI thread) follows the list from the chunk it read last, so neither
+  side ever waits for the other.
+
+  clear() may only be called by the consumer while no producers are active.
+
+*/
+/// \file
+/// Contains the implementation of the class PointStream.
+
+///// Header files ////////////////////////////////////////////////////////////
+
+// Xbrabo header files
+#include "pointstream.h"
+
+///////////////////////////////////////////////////////////////////////////////
+///// Public Member Functions                                             /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// Constructor /////////////////////////////////////////////////////////////
+PointStream::PointStream() :
+  head(new Chunk),
+  tail(head)
+/// The default constructor.
+{
+
+}
+
+///// Destructor //////////////////////////////////////////////////////////////
+PointStream::~PointStream()
+/// The default destructor.
+{
+  while(head != 0)
+  {
+    Chunk* next = head->next;
+    delete head;
+    head = next;
+  }
+}
+
+///// publish /////////////////////////////////////////////////////////////////
+void PointStream::publish(std::vector<Point3D<float> >& points)
+/// Appends the points as a new chunk to the stream. The contents of
+/// points are taken over, so it is empty on return. Can be called from any
+/// number of threads at the same time.
+{
+  Chunk* chunk = new Chunk;
+  chunk->points.swap(points);
+  Chunk* previous = tail.fetchAndStoreOrdered(chunk);
+  previous->next.fetchAndStoreRelease(chunk); // the chunk becomes visible to the consumer
+}
+
+///// read ////////////////////////////////////////////////////////////////////
+unsigned int PointStream::read(std::vector<Point3D<float> >& points)
+/// Appends the points of all chunks published since the last call to
+/// points and returns their number. Only one thread may read.
+{
+  unsigned int numRead = 0;
+  Chunk* next = head->next.fetchAndAddAcquire(0);
+  while(next != 0)
+  {
+    points.insert(points.end(), next->points.begin(), next->points.end());
+    numRead += next->points.size();
+    std::vector<Point3D<float> >().swap(next->points); // the chunk is only kept as the link to the next one
+    delete head; // no producer can reach it anymore
+    head = next;
+    next = head->next.fetchAndAddAcquire(0);
+  }
+  return numRead;
+}
+
+///// clear ///////////////////////////////////////////////////////////////////
+void PointStream::clear()
+/// Removes all chunks from the stream. Only the consumer may call this while
+/// no producers are active.
+{
+  while(head->next != 0)
+  {
+    Chunk* next = head->next;
+    delete head;
+    head = next;
+  }
+  std::vector<Point3D<float> >().swap(head->points);
+  tail = head;
+}
@@ -185,8 +185,10 @@ GLMoleculeParameters PreferencesBase::getGLMoleculeParameters() const
   result.defaultMoleculeStyle = data.styleMolecule;
   result.defaultForcesStyle = data.styleForces;
   result.fastRenderLimit = data.fastRenderLimit;
+  result.impostorSpheres = data.impostorSpheres;
   result.showElements = data.showElements;
   result.showNumbers = data.showNumbers;
+  result.hideOverlappingLabels = data.hideOverlappingLabels;
   result.colorLabels = data.colorLabels;
   result.colorICs = data.colorICs;
   result.colorSelections = data.colorSelections;
@@ -274,8 +276,10 @@ void PreferencesBase::loadSettings()
   data.styleMolecule     = settings.readNumEntry(prefix + "style_molecule", 3); // Ball & Stick
   data.styleForces       = settings.readNumEntry(prefix + "style_forces", 2); // Tubes
   data.fastRenderLimit   = settings.readNumEntry(prefix + "fast_render_limit", 1000);
+  data.impostorSpheres   = settings.readBoolEntry(prefix + "impostor_spheres", false);
   data.showElements      = settings.readBoolEntry(prefix + "show_elements", false);
   data.showNumbers       = settings.readBoolEntry(prefix + "show_numbers", true);
+  data.hideOverlappingLabels = settings.readBoolEntry(prefix + "hide_overlapping_labels", false);
   data.sizeLines         = settings.readNumEntry(prefix + "size_lines", static_cast<int>((minLineWidthGL > 1.0f ? minLineWidthGL : 1.0f)/lineWidthGranularity)); // max(1.0, minLineWidthGL) 
   data.sizeBonds         = settings.readEntry(prefix + "size_bonds", QString::number(AtomSet::vanderWaals(1)/2.0));
   data.sizeForces        = settings.readEntry(prefix + "size_forces", QString::number(AtomSet::vanderWaals(1)/2.0*1.1));
@@ -356,8 +360,10 @@ void PreferencesBase::saveSettings()
   settings.writeEntry(prefix + "style_molecule", static_cast<int>(data.styleMolecule)); 
   settings.writeEntry(prefix + "style_forces", static_cast<int>(data.styleForces)); 
   settings.writeEntry(prefix + "fast_render_limit", data.fastRenderLimit);
+  settings.writeEntry(prefix + "impostor_spheres", data.impostorSpheres);
   settings.writeEntry(prefix + "show_elements", data.showElements);
   settings.writeEntry(prefix + "show_numbers", data.showNumbers);
+  settings.writeEntry(prefix + "hide_overlapping_labels", data.hideOverlappingLabels);
   settings.writeEntry(prefix + "size_lines", data.sizeLines);
   settings.writeEntry(prefix + "size_bonds", data.sizeBonds);
   settings.writeEntry(prefix + "size_forces", data.sizeForces);
@@ -791,8 +797,10 @@ void PreferencesBase::makeConnections()
   connect(ComboBoxMolecule, SIGNAL(activated(int)), this, SLOT(changed()));
   connect(ComboBoxForces, SIGNAL(activated(int)), this, SLOT(changed()));
   connect(SpinBoxFastRender, SIGNAL(valueChanged(int)), this, SLOT(changed()));
+  connect(CheckBoxImpostors, SIGNAL(clicked()), this, SLOT(changed()));
   connect(CheckBoxElement, SIGNAL(clicked()), this, SLOT(changed()));
   connect(CheckBoxNumber, SIGNAL(clicked()), this, SLOT(changed()));
+  connect(CheckBoxLabelOverlap, SIGNAL(clicked()), this, SLOT(changed()));
   connect(SliderBondSizeLines, SIGNAL(valueChanged(int)), this, SLOT(changed()));
   connect(SliderBondSizeTubes, SIGNAL(valueChanged(int)), this, SLOT(changed()));
   connect(LineEditBondSizeTubes, SIGNAL(textChanged(const QString&)), this, SLOT(changed()));
@@ -956,8 +964,10 @@ void PreferencesBase::saveWidgets()
   data.styleMolecule = ComboBoxMolecule->currentItem();
   data.styleForces = ComboBoxForces->currentItem();
   data.fastRenderLimit = SpinBoxFastRender->value();
+  data.impostorSpheres = CheckBoxImpostors->isChecked();
   data.showElements = CheckBoxElement->isChecked();
   data.showNumbers = CheckBoxNumber->isChecked();
+  data.hideOverlappingLabels = CheckBoxLabelOverlap->isChecked();
   data.sizeLines = SliderBondSizeLines->value();
   data.sizeBonds = LineEditBondSizeTubes->text();
   data.sizeForces = LineEditForceSizeTubes->text();
@@ -1033,8 +1043,10 @@ void PreferencesBase::restoreWidgets()
   ComboBoxMolecule->setCurrentItem(data.styleMolecule);
   ComboBoxForces->setCurrentItem(data.styleForces);
   SpinBoxFastRender->setValue(data.fastRenderLimit);
+  CheckBoxImpostors->setChecked(data.impostorSpheres);
   CheckBoxElement->setChecked(data.showElements);
   CheckBoxNumber->setChecked(data.showNumbers);
+  CheckBoxLabelOverlap->setChecked(data.hideOverlappingLabels);
   SliderBondSizeLines->setValue(data.sizeLines);
     updateLineEditBondSizeLines(); // needed?
   LineEditBondSizeTubes->setText(data.sizeBonds);
@@ -917,6 +917,8 @@ void XbraboView::popup()
   popup->insertItem(IconSets::getIconSet(IconSets::MoleculeRead), tr("Read coordinates..."), this, SLOT(moleculeReadCoordinates()));
   popup->insertItem(tr("Add atoms..."), MoleculeView, SLOT(addAtoms()));
   const int ID_MOLECULE_DELETE = popup->insertItem(tr("Delete selected atoms"), MoleculeView, SLOT(deleteSelectedAtoms()));
+  const int ID_MOLECULE_UNDO = popup->insertItem(tr("Undo"), MoleculeView, SLOT(undo()));
+  const int ID_MOLECULE_REDO = popup->insertItem(tr("Redo"), MoleculeView, SLOT(redo()));
   popup->insertSeparator();
   const int ID_ALTER_CARTESIAN = popup->insertItem(tr("Alter cartesian coordinates"), MoleculeView, SLOT(alterCartesian()));
   const int ID_ALTER_INTERNAL = popup->insertItem(tr("Alter internal coordinate"), MoleculeView, SLOT(alterInternal()));    
@@ -987,6 +989,10 @@ void XbraboView::popup()
   }
   if(MoleculeView->selectedAtoms() < 2 || MoleculeView->selectedAtoms() > 4)
     popup->setItemEnabled(ID_ALTER_INTERNAL, false);
+  if(!atoms->canUndo() || isRunning())
+    popup->setItemEnabled(ID_MOLECULE_UNDO, false);
+  if(!atoms->canRedo() || isRunning())
+    popup->setItemEnabled(ID_MOLECULE_REDO, false);
     
   ///// disable items for Setup menu
   if(globalSetup == 0 || globalSetup->calculationType() != GlobalBase::GeometryOptimization)
@@ -24,6 +24,7 @@
 ///// Forward class declarations & header files ///////////////////////////////
 
 // STL header files
+#include <map>
 #include <vector>
 using std::vector;
 
@@ -37,6 +38,9 @@ class QString;
 // Xbrabo forward class declarations
 //#include "point3d.h" // gives extremely strange errors when (and only when) compiling crdfactory.cpp
 template <class T> class Point3D;
+template <class T> class Vector3D;
+template <class T> class Quaternion;
+class SpatialIndex;
 
 ///// class AtomSet ///////////////////////////////////////////////////////////
 class AtomSet
@@ -68,7 +72,18 @@ class AtomSet
     void changeBond(const double amount, const unsigned int movingAtom, const unsigned int secondAtom, const bool includeNeighbours = false);         // changes a bond length
     void changeAngle(const double amount, const unsigned int movingAtom, const unsigned int centralAtom, const unsigned int lastAtom, const bool includeNeighbours = false);        // changes a valence angle
     void changeTorsion(const double amount, const unsigned int movingAtom, const unsigned int secondAtom, const unsigned int thirdAtom, const unsigned int fourthAtom, const bool includeNeighbours = false);     // changes a torsion angle
+    void translateAtoms(const vector<unsigned int>& indices, const double dx, const double dy, const double dz);   // translates a set of atoms
+    void rotateAtoms(const vector<unsigned int>& indices, const Quaternion<double>& rotation, const Point3D<double>& center); // rotates a set of atoms around a point
+    void transformAtoms(const vector<unsigned int>& indices, const double matrix[16]);     // applies a transformation matrix to a set of atoms
     void transferCoordinates(const AtomSet* source);        // copies the coordinates from another AtomSet
+    void setTopologyReuse(const bool state, const double skin = 0.5);  // keeps the bond topology between successive geometries
+
+    ///// public member functions for undoing changes
+    void beginEdit();                   // starts a group of changes that is undone as a whole
+    void endEdit();                     // ends a group of changes
+    bool undo();                        // reverts the last group of changes
+    bool redo();                        // reapplies the last reverted group of changes
+    void clearHistory();                // discards all undo and redo information
     
     ///// public member functions for retrieving data
     unsigned int count() const;         // returns the number of atoms
@@ -78,11 +93,24 @@ class AtomSet
     double z(const unsigned int index) const;     // returns the z-coordinate for atom index
     unsigned int atomicNumber(const unsigned int index) const;  // returns the atomic number for atom index
     QColor color(const unsigned int index) const; // returns the color of the specified atom
+    const double* xData() const;        // returns the x-coordinates of all atoms as a contiguous array
+    const double* yData() const;        // returns the y-coordinates of all atoms as a contiguous array
+    const double* zData() const;        // returns the z-coordinates of all atoms as a contiguous array
+    const unsigned char* elementData() const;     // returns the atomic numbers of all atoms as a contiguous array
+    const unsigned int* colorData() const;        // returns the packed colors of all atoms as a contiguous array
     vector<unsigned int> usedAtomicNumbers() const;   // returns a sorted list of all the used atomic numbers
     void bonds(vector<unsigned int>*& first, vector<unsigned int>*& second);    // returns a list of bonds between the atoms
     unsigned int numberOfBonds(const unsigned int index) const; // returns the number of bonds for an atom
+    vector<unsigned int> atomsWithinRadius(const Point3D<double>& center, const double radius) const;  // returns the atoms within a distance of a point
+    vector<unsigned int> atomsInBox(const Point3D<double>& minimum, const Point3D<double>& maximum) const; // returns the atoms inside a box
+    vector<unsigned int> nearestAtoms(const Point3D<double>& point, const unsigned int number) const;  // returns the atoms closest to a point
+    vector<unsigned int> atomsAlongRay(const Point3D<double>& origin, const Vector3D<double>& direction, const double radius) const; // returns the atoms within a distance of a ray
     bool isLinear() const;              // returns true if the atoms form a linear molecule
     bool isChanged() const;             // returns true if the AtomSet has changed
+    unsigned int revision() const;      // returns a number that changes whenever the geometry, colors or charges change
+    bool topologyReuse() const;         // returns true if the bond topology is reused between geometries
+    bool canUndo() const;               // returns true if a group of changes can be undone
+    bool canRedo() const;               // returns true if a group of changes can be redone
     double dx(const unsigned int index) const;    // returns the x-component of the force on atom index
     double dy(const unsigned int index) const;    // returns the y-component of the force on atom index
     double dz(const unsigned int index) const;    // returns the z-component of the force on atom index
@@ -115,14 +143,41 @@ class AtomSet
     bool addBondList(const unsigned int callingAtom, const unsigned int startAtom, const unsigned int endAtom1, const unsigned int endAtom2, std::vector<unsigned int>* result);     // returns a list of all atoms bonded to startAtom
     void clearProperties();             // clears the properties
     void updateBoxDimensions();         // updates the smallest box surrounding the atoms
-    void addBonds(const vector<unsigned int>* atomList1, const vector<unsigned int>* atomList2);    // calculates all bonds between the atoms in the 2 list
+    void addBonds(const vector<unsigned int>* atomList1, const vector<unsigned int>* atomList2, const double skin = 0.0);    // calculates all bonds between the atoms in the 2 list
+    bool reuseBonds();                  // regenerates the bonds from the neighbour list of a previous geometry
+    void clearTopology();               // discards the neighbour list of the previous geometry
+    const SpatialIndex* spatialIndex() const;     // returns the up to date spatial index
+    bool recording();                   // returns true if a change should be journaled
+    void recordMove(const unsigned int index);    // journals the position of an atom before it is moved
+    void recordRecolor(const unsigned int index, const unsigned int newColor); // journals a change of the color of an atom
+    void recordAddition(const unsigned int index, const Point3D<double>& location, const unsigned int atomicNumber, const unsigned int color); // journals an atom before it is added
+    void recordRemoval(const unsigned int index); // journals an atom before it is removed
+    void finishMoves();                 // journals the new positions of all atoms moved since the last addition or removal
+    void replayStep(const unsigned int step, const bool forward);     // undoes or redoes a group of changes
+
+    ///// private enums & structs
+    enum JournalType{JournalMove, JournalAddition, JournalRemoval, JournalRecolor};///< The kinds of journaled changes
+    struct JournalEntry                 ///  A single atom-level change in the undo journal
+    {
+      unsigned char type;               ///< The kind of change (one of JournalType)
+      unsigned char element;            ///< The atomic number of an added or removed atom
+      unsigned int index;               ///< The index of the changed atom
+      unsigned int oldColor;            ///< The color before the change
+      unsigned int newColor;            ///< The color after the change
+      double oldX, oldY, oldZ;          ///< The position before the change
+      double newX, newY, newZ;          ///< The position after the change
+    };
 
     // private member data
     unsigned int numAtoms;              ///< the number of atoms
     bool changed;                       ///< = true if anything changed
+    unsigned int geometryRevision;      ///< Incremented for each change of the geometry, the colors or the charges
 
-    vector<Point3D<double> > coords;    ///< cartesian coordinates of the atoms with the atomic numbers as the ID's
-    vector<QColor> colors;              ///< colors of the atoms
+    vector<double> xCoords;             ///< x-coordinates of the atoms
+    vector<double> yCoords;             ///< y-coordinates of the atoms
+    vector<double> zCoords;             ///< z-coordinates of the atoms
+    vector<unsigned char> elements;     ///< atomic numbers of the atoms
+    vector<unsigned int> colors;        ///< colors of the atoms packed as QRgb values (0xAARRGGBB)
     vector<Point3D<double> >* forces;   ///< forces on the atoms
     vector<unsigned int> bonds1;        ///< the first part of the bonds array
     vector<unsigned int> bonds2;        ///< the second part of the bonds array
@@ -135,6 +190,26 @@ class AtomSet
     Point3D<double>* boxMax;            ///< The first point of the smallest box surrounding the atoms (have to use pointers because point3d.h cannot be included)
     Point3D<double>* boxMin;            ///< The second point of the smallest box surrounding the atoms
     bool dirtyBox;                      ///< If true the box needs to be recalculated
+    SpatialIndex* grid;                 ///< The grid for spatial queries (rebuilt on demand after geometry changes)
+    bool reuseTopology;                 ///< If true the bonds are revalidated from a Verlet neighbour list instead of being recalculated
+    double topologySkin;                ///< The skin distance added to the bond criterion for the neighbour list
+    vector<double> verletCoords;        ///< The coordinates at the time the neighbour list was built (x, y and z for each atom)
+    vector<unsigned char> verletElements;         ///< The atomic numbers at the time the neighbour list was built
+    vector<double> validatedCoords;     ///< The coordinates at which the bonds of each atom were last checked (x, y and z for each atom)
+    vector<unsigned int> verletPairs1;  ///< The first part of the atom pairs in the neighbour list
+    vector<unsigned int> verletPairs2;  ///< The second part of the atom pairs in the neighbour list
+    vector<bool> verletBonded;          ///< Whether each pair of the neighbour list was bonded when last checked
+    vector<JournalEntry> journal;       ///< The atom-level changes of all undo and redo steps
+    vector<unsigned int> journalSteps;  ///< The position in the journal of the first change of each step
+    unsigned int journalPosition;       ///< The number of steps that are currently applied (the following ones can be redone)
+    unsigned int editLevel;             ///< The nesting level of beginEdit/endEdit calls
+    bool stepOpened;                    ///< = true if the current group of changes has been added to journalSteps
+    bool replaying;                     ///< = true while an undo or redo is in progress
+    std::map<unsigned int, unsigned int> pendingMoves; ///< Maps the atoms moved in the current group to their journal entries
+
+    // private static data
+    static const double topologyTolerance;        // the displacement below which the bonds of an atom are not rechecked
+    static const unsigned int maxUndoSteps;       // the maximum number of steps kept in the journal
 };
 
 #endif
@@ -36,7 +36,7 @@ struct GLMoleculeParameters
   GLfloat sizeForces;                   ///< The size for cylinder-type forces 
   unsigned int defaultMoleculeStyle;    ///< The default molecule display style
   unsigned int defaultForcesStyle;      ///< The default forces display style
-  unsigned int fastRenderLimit;         ///< The number of atoms above which to switch to fast rendering (lines and no labels)
+  unsigned int fastRenderLimit;         ///< The number of atoms above which to switch to fast rendering (lowest detail and no labels)
   bool showElements;                    ///< Whether to show the element labels by default
   bool showNumbers;                     ///< Whether to show the number labels by default
   unsigned int colorLabels;             ///< The color for rendering the textlabels
@@ -46,6 +46,8 @@ struct GLMoleculeParameters
   unsigned int colorForces;             ///< The color for rendering the forces
   bool forcesOneColor;                  ///< Whether to render the forces in one color or in the atom's color
   unsigned int opacityForces;           ///< The opacity of the color of the forces (0-100)
+  bool impostorSpheres;                 ///< Whether to draw atoms as ray-cast sprites instead of tessellated spheres when supported
+  bool hideOverlappingLabels;           ///< Whether to skip labels that overlap a label closer to the viewer
 };
 
 #endif
@@ -24,14 +24,19 @@
 ///// Forward class declarations & header files ///////////////////////////////
 
 // STL includes
+#include <string>
 #include <vector>
 
 // Qt forward class declarations
 class QDomElement;
+class QGLShaderProgram;
 #include <qfont.h>
 
 // Xbrabo forward class declarations
 class AtomSet;
+class SpatialIndex;
+template <class T> class Point3D;
+template <class T> class Vector3D;
 
 // Xbrabo header files
 #include "glmoleculeparameters.h"
@@ -88,6 +93,8 @@ class GLSimpleMoleculeView : public GLView
     virtual float boundingSphereRadius();         // calculates the radius of the bounding sphere
     void clicked(const QPoint& position);         // handles click events
     virtual void updateShapes();        // updates the shapes vector
+    void resizeChunkLists(GLuint& lists, unsigned int& numLists, const unsigned int number); // reallocates a range of display lists
+    void visibleChunks(const std::vector<GLfloat>& bounds, std::vector<unsigned int>& ranges) const; // returns the ranges of chunks inside the view
 
     ///// protected structs
     struct ShapeProperties             
@@ -117,18 +124,31 @@ class GLSimpleMoleculeView : public GLView
   private:
     ///// private enums
     enum Directions{DIRECTION_X, DIRECTION_Y, DIRECTION_Z}; ///< The different directions for translations and rotations
-    enum StartIndices{START_ATOMS = 100, START_BONDS = 1, START_FORCES = 2, START_SELECTEDATOMS = 3, START_SELECTEDBONDS = 4}; ///< Indices for the selection of entities
+    enum StartIndices{START_ATOMS = 100, START_BONDS = 1, START_FORCES = 2}; ///< Indices for the selection of entities
  
     ///// private member functions
     GLuint makeObjects(const int numSlices);      // generates the atom and bond shapes
     void changeObjects(const GLuint startList, const int numSlices);  // changes the atom and bond shapes
+    void changeLODObjects(const int numSlices);   // changes the atom and bond shapes of all levels of detail
+    void updateLODParameters();         // determines the scale of the current matrices for lodLevel
+    unsigned int lodLevel(const GLfloat* bounds, const GLfloat radius) const; // returns the level of detail for shapes of a radius inside a box
     void selectEntity(const QPoint position);     // selects the entity at the position
+    bool rayHitsSegment(const Point3D<double>& origin, const Vector3D<double>& direction, const Point3D<double>& start, const Point3D<double>& end, const double radius, double& distance) const; // returns whether a ray passes within a distance of a segment
     void processSelection(const unsigned int id); // updates the selection according to the change in selection of the ID
     void centerMolecule();              // calculates the translations needed to have the molecule centered
     void drawScene();                   // does the actual repainting of the OpenGL scene
+    void drawShape(const unsigned int index);     // draws the shape shapes[index]
     void drawAtoms();                   // draws the atoms in the OpenGL scene
     void drawBonds();                   // draws the bonds
+    void buildAtomBatch();              // compiles the atoms into display lists per chunk
+    void buildBondBatch();              // compiles the bonds into display lists per chunk
+    GLfloat atomRadius(const unsigned int element, const unsigned int style) const; // returns the radius of an atom in a display style
+    void buildImpostors();              // fills the vertex arrays for drawing the atoms as ray-cast sprites
+    bool useImpostors() const;          // returns whether atoms should be drawn as ray-cast sprites
+    void updateBondCache();             // recalculates the bond transformations if the geometry changed
     void drawLabels();                  // draws the element names&numbers and possibly charges
+    void buildGlyphAtlas();             // renders the characters of the label font into a texture
+    void updateLabelCache();            // regenerates the label texts if the atoms or the label contents changed
     void drawForces();                  // draws the forces
     void drawICValue();                 // draws the value of the currently selected internal coordinate
     void drawSelections();              // draws the selected atoms and internal coordinates
@@ -138,6 +158,43 @@ class GLSimpleMoleculeView : public GLView
     int bondObject;                     ///< The OpenGL bond shape object pointer.
     int forceObjectLines;               ///< The OpenGL force shape object pointer for lines style.
     int forceObjectTubes;               ///< The OpenGL force shape object pointer for tubes style.
+    GLuint atomLODObjects;              ///< The first of the OpenGL atom shapes of decreasing detail.
+    GLuint bondLODObjects;              ///< The first of the OpenGL bond shapes of decreasing detail.
+    std::vector<int> lodSlices;         ///< The number of slices of each level of detail.
+    GLfloat lodModelview[16];           ///< The modelview matrix of the current frame.
+    GLfloat lodPixelScale;              ///< The number of pixels per unit of the current frame (at unit distance for perspective).
+    GLfloat lodModelScale;              ///< The scale factor of the modelview matrix of the current frame.
+    bool lodPerspective;                ///< Is true if the current frame uses a perspective projection.
+    GLuint atomChunkLists;              ///< The first of the OpenGL display lists each holding a chunk of atoms.
+    unsigned int numAtomChunkLists;     ///< The number of display lists starting at atomChunkLists.
+    GLuint bondChunkLists;              ///< The first of the OpenGL display lists each holding a chunk of bonds.
+    unsigned int numBondChunkLists;     ///< The number of display lists starting at bondChunkLists.
+    std::vector<GLfloat> atomChunkBounds;         ///< The bounding box of each chunk of atoms (6 values per chunk).
+    std::vector<GLfloat> bondChunkBounds;         ///< The bounding box of each chunk of bonds (6 values per chunk).
+    std::vector<GLfloat> atomChunkRadii;///< The largest radius of the atoms in each chunk.
+    bool atomBatchValid;                ///< = false if the atom display list has to be recompiled.
+    unsigned int atomBatchRevision;     ///< The AtomSet revision compiled into the atom display list.
+    unsigned int atomBatchStyle;        ///< The display style compiled into the atom display list.
+    bool bondBatchValid;                ///< = false if the bond display list has to be recompiled.
+    unsigned int bondBatchRevision;     ///< The AtomSet revision compiled into the bond display list.
+    std::vector<GLfloat> atomInstances; ///< The position and radius of each atom in the atom display list (4 values per atom).
+    QGLShaderProgram* impostorProgram;  ///< The shader program ray-casting the atom sprites (0 if shaders are not supported).
+    std::vector<GLfloat> impostorVertices;        ///< The center of the atom for each corner of its sprite (3 values per vertex).
+    std::vector<GLfloat> impostorCorners;         ///< The corner offset and radius for each corner of the sprites (3 values per vertex).
+    std::vector<GLubyte> impostorColors;///< The color for each corner of the sprites (3 values per vertex).
+    bool bondCacheValid;                ///< = false if the cached bond data has to be recalculated.
+    unsigned int bondCacheRevision;     ///< The AtomSet revision the cached bond data corresponds to.
+    std::vector<unsigned int> bondAtoms;///< The atoms of each bond that is drawn as a cylinder (2 values per bond).
+    std::vector<GLfloat> bondTransforms;///< The column-major matrix placing the bond cylinder along each bond (16 values per bond).
+    std::vector<unsigned char> bondTwoColors;     ///< Is 1 for each bond that is drawn as 2 halves in the colors of its atoms.
+    std::vector<GLfloat> bondLineVertices;        ///< The vertices of all bonds in the Lines style (3 values per vertex).
+    std::vector<GLubyte> bondLineColors;///< The colors of bondLineVertices (3 values per vertex).
+    std::vector<unsigned int> bondLineChunkStarts;///< The first vertex in bondLineVertices of each chunk of bonds (+ an end marker).
+    SpatialIndex* bondIndex;            ///< The grid holding the midpoint of each bond in bondAtoms (built on demand for picking).
+    double bondIndexReach;              ///< Half the length of the longest bond in bondIndex.
+    bool largestElementValid;           ///< = false if largestElement has to be redetermined.
+    unsigned int largestElementRevision;///< The AtomSet revision largestElement corresponds to.
+    unsigned int largestElement;        ///< The element present with the largest van der Waals radius (bounds the atoms for picking).
     unsigned int moleculeStyle;         ///< The rendering style of the molecule
     unsigned int forcesStyle;           ///< The rendering style of the forces
     bool showElements;                  ///< Is true if elements should be shown.
@@ -148,9 +205,30 @@ class GLSimpleMoleculeView : public GLView
     GLfloat selectionPointSize;         ///< The pointsize for drawing selected atoms.
     float scaleFactor;                  ///< scalefactor for scenes exceeding 50A in radius
     QFont labelFont;                    ///< The font used to render labels and other values
+    GLuint labelTexture;                ///< The texture holding the glyph atlas for the labels (0 if not created yet).
+    QFont atlasFont;                    ///< The font rendered into labelTexture.
+    std::vector<GLfloat> glyphCoords;   ///< The texture coordinates of each printable ASCII character (4 values per character).
+    std::vector<int> glyphAdvances;     ///< The horizontal advance in pixels of each printable ASCII character.
+    int glyphAscent;                    ///< The ascent of the atlas font in pixels.
+    int glyphDescent;                   ///< The descent of the atlas font in pixels.
+    bool labelCacheValid;               ///< = false if the label texts have to be regenerated.
+    unsigned int labelCacheRevision;    ///< The AtomSet revision the label texts correspond to.
+    unsigned int labelCacheContents;    ///< The combination of element, number and charge type the label texts correspond to.
+    std::vector<std::string> labelTexts;///< The label text of each atom.
+    std::vector<int> labelWidths;       ///< The width in pixels of each label.
+    std::vector<GLfloat> labelVertices; ///< The window coordinates of the label glyphs of the last frame (3 values per vertex).
+    std::vector<GLfloat> labelTexCoords;///< The texture coordinates of the label glyphs of the last frame (2 values per vertex).
 
     // private constants (made static for ease) 
     static const float cylinderHeight;  ///< The cylinder height. A too low value shows severe bugs in the Mesa OpenGL implementation.
+    static const float forceScale;      ///< The length in Angstrom of a drawn force per mdyne/A (a force considered refined by Relax, 0.0009 mdyne/A, is 0.1 Angstrom).
+    static const unsigned int chunkSize;///< The number of atoms or bonds in a chunk that is culled as a whole.
+    static const unsigned int numLODLevels;       ///< The number of levels of detail for atoms and bonds (the size of lodSlices).
+    static const int minimumLODSlices;  ///< The number of slices of the least detailed shapes.
+    static const GLfloat lodPixelsPerSlice;       ///< The length in pixels of the circumference covered by a slice.
+    static const GLubyte lodListOffset; ///< The offset from the list base of the shapes called in the chunks.
+    static const char* impostorVertexShader;      ///< The source of the vertex shader for the atom sprites.
+    static const char* impostorFragmentShader;    ///< The source of the fragment shader for the atom sprites.
 
 };
 
@@ -24,7 +24,12 @@
 ///// Forward class declarations & header files ///////////////////////////////
 
 // Qt forward class declarations
+class QElapsedTimer;
+class QGLFramebufferObject;
+class QGLShaderProgram;
+class QImage;
 class QPoint;
+class QTextStream;
 class QTimer;
 
 // Xbrabo forward class declarations
@@ -40,6 +45,9 @@ class GLView : public QGLWidget
   Q_OBJECT
   
   public:
+    ///// public enums
+    enum TimingSection{TIMING_ATOMS, TIMING_BONDS, TIMING_LABELS, TIMING_SURFACES, TIMING_SCENE, TIMING_SWAP, TIMING_NEXT}; ///< The timed parts of a frame. Always keep TIMING_NEXT as the last entry.
+
     ///// constructor/destructor
     GLView(QWidget *parent=0, const char *name=0);// constructor
     virtual ~GLView();                          // destructor
@@ -48,9 +56,15 @@ class GLView : public QGLWidget
     bool isModified() const;            // returns whether the scene needs to be saved
     bool isAnimating() const;           // returns whether the scene is animating
     unsigned int calculateFPS();        // returns the maximum framerate for the current parameters
+    QImage renderImage(const int imageWidth, const int imageHeight);  // renders the scene offscreen into an image of any size
+    void setOrientation(const float xAngle, const float yAngle, const float zAngle);  // sets the orientation from Euler angles
+    void zoom(const float factor);      // zooms relative to the current zoom level
+    double frameTiming(const unsigned int section) const;   // returns the time spent on a part of the last frame
+    void benchmark(QTextStream& stream, const QString& name, const unsigned int numFrames);   // draws a fixed rotation path and writes the timings of each frame
 
     ///// static public member functions
     static void setParameters(GLBaseParameters params);     // sets new OpenGL parameters
+    static QString benchmarkHeader();   // returns the header line of the output of benchmark
 
   signals:
     void modified();                    // is emitted when the status changes from non-modified to modified
@@ -64,12 +78,17 @@ class GLView : public QGLWidget
     void zoomFit(const bool update = true);      // zooms so the scene fits the window
     void resetView(const bool update = true);     // resets translation/orientation/zoom
     void saveImage();           // saves the current view to an image
+    void toggleTimingOverlay();         // turns the display of the frame timings on/off
 
   protected:
+    ///// protected enums
+    enum TransparencyPass{TRANSPARENCY_DEPTH, TRANSPARENCY_ACCUMULATE, TRANSPARENCY_REVEALAGE}; ///< The passes of the order independent transparency.
+
     ///// protected member functions
     void initializeGL();                // called once upon initialization
     void resizeGL(int w, int h);        // called when the widget is resized
     void paintGL();                     // called when the widget has to be repainted
+    void glDraw();                      // draws and swaps a frame
     void mousePressEvent(QMouseEvent* e);         // event which takes place when a mouse button is pressed
     void mouseMoveEvent(QMouseEvent* e);// event which takes place when the mouse is moved while a mousebutton is pressed
     void mouseReleaseEvent(QMouseEvent* e);       // event which takes place when a mouse button was released on the widget
@@ -84,6 +103,13 @@ class GLView : public QGLWidget
     void updateFog(const float radius); // updates the fog parameters
     void updateProjection();            // does the necessary updating when the projection type changes
     void setPerspective();              // sets the perspective
+    void updateFrustum();               // extracts the clipping planes from the current matrices
+    bool boxInFrustum(const GLfloat* bounds) const; // returns whether an axis-aligned box is (partly) inside the clipping planes
+    bool beginTransparency();           // starts drawing into the offscreen buffers for order independent transparency
+    void beginTransparencyPass(const unsigned int pass);    // sets up a pass of the order independent transparency
+    void endTransparency();             // composites the transparent shapes over the scene
+    void startTiming(const unsigned int section); // starts timing a part of the frame
+    void stopTiming(const unsigned int section);  // stops timing a part of the frame
     
     ///// protected member data
     GLfloat xPos;                       ///< Amount of translation on the x-axis.
@@ -99,7 +125,15 @@ class GLView : public QGLWidget
     static GLBaseParameters baseParameters;       ///< Holds the OpenGL base parameters.
     
   private:
-    
+    ///// private typedefs
+    typedef void (APIENTRY* BlendFuncSeparateFunction)(GLenum, GLenum, GLenum, GLenum);  ///< glBlendFuncSeparate (OpenGL 1.4)
+    typedef void (APIENTRY* ActiveTextureFunction)(GLenum);  ///< glActiveTexture (OpenGL 1.3)
+
+    ///// private member functions
+    void setPerspective(const GLfloat aspectRatio);   // sets the perspective for a given aspect ratio
+    void drawOrientedScene();           // draws the scene with the current translation and orientation
+    void drawTimingOverlay();           // shows the timings of the previous frame
+
     ///// private member data
     GLfloat xRot;                       ///< Amount of step-rotation around the x-axis.
     GLfloat yRot;                       ///< Amount of step-rotation around the y-axis.
@@ -111,9 +145,27 @@ class GLView : public QGLWidget
     bool startingClick;                 ///< Keeps track of click vs. move events.
     float maxRadius;                    ///< A copy of the result of boundingSphereRadius for use in translateZ
     bool currentPerspectiveProjection;  ///< Is true if the current projection is perspective
+    GLfloat frustumPlanes[24];          ///< The 6 clipping planes (a, b, c, d) in the coordinates of the last call to updateFrustum
+    bool transparencyChecked;           ///< Is true if the support for order independent transparency has been determined
+    QGLFramebufferObject* transparencyBuffer;     ///< The offscreen buffer for the transparency passes (0 if not created)
+    GLuint accumulationTexture;         ///< The texture holding the result of the accumulation pass
+    QGLShaderProgram* compositeProgram; ///< The shader program compositing the transparent shapes (0 if not supported)
+    BlendFuncSeparateFunction blendFuncSeparate;  ///< The address of glBlendFuncSeparate (0 if not supported)
+    ActiveTextureFunction activeTexture;///< The address of glActiveTexture (0 if not supported)
+    bool offscreenRendering;            ///< Is true while renderImage draws into its own framebuffer
+    QElapsedTimer* timingClock;         ///< The clock for all frame timings
+    qint64 timingStarts[TIMING_NEXT];   ///< The starting times (in ns) of the parts being timed
+    qint64 currentTimings[TIMING_NEXT]; ///< The accumulated times (in ns) of the parts of the current frame
+    double frameTimings[TIMING_NEXT];   ///< The times (in ms) of the parts of the last complete frame
+    bool timingOverlay;                 ///< Is true if the timings are shown on top of the scene
+    bool synchronousTiming;             ///< Is true if the timings wait for OpenGL to finish (used by benchmark)
 
     ///// static private member data
     static int staticUpdateIndex;       ///< holds the index of the latest update of the OpenGL parameters.
+    static const int maxTileSize;       ///< The maximum size of the tiles used by renderImage.
+    static const char* timingNames[TIMING_NEXT];  ///< The names of the timed parts of a frame.
+    static const char* compositeVertexShader;     ///< The source of the vertex shader compositing the transparent shapes.
+    static const char* compositeFragmentShader;   ///< The source of the fragment shader compositing the transparent shapes.
 };
 
 #endif
@@ -80,6 +80,7 @@ template <class T> class Quaternion
     void eulerToQuaternion(const T xAngle, const T yAngle, const T zAngle);     // converts Euler angles to a quaternion
     void axisToQuaternion(const Vector3D<T> v, const T angle);        // converts from axis/angle to quaternion
     void getAxisAngle(Vector3D<T>& v, T& angle);  // returns axis/angle for the quaternion
+    void getMatrix(T matrix[16]) const; // returns the corresponding rotation matrix
 
   private:
     // private member functions
@@ -340,6 +341,34 @@ template <class T> void Quaternion<T>::getAxisAngle(Vector3D<T>& v, T& angle)
 }
 
 
+///// getMatrix ///////////////////////////////////////////////////////////////
+template <class T> void Quaternion<T>::getMatrix(T matrix[16]) const
+/// Returns the 4x4 rotation matrix of the quaternion in column-major order
+/// (as used by OpenGL). It rotates points in the same way as Vector3D::rotate
+/// does with the axis/angle representation of the quaternion.
+{
+  const T xx = xQuat*xQuat, yy = yQuat*yQuat, zz = zQuat*zQuat;
+  const T xy = xQuat*yQuat, xz = xQuat*zQuat, yz = yQuat*zQuat;
+  const T wx = wQuat*xQuat, wy = wQuat*yQuat, wz = wQuat*zQuat;
+
+  matrix[0] = 1.0 - 2.0*(yy + zz);
+  matrix[1] = 2.0*(xy - wz);
+  matrix[2] = 2.0*(xz + wy);
+  matrix[3] = 0.0;
+  matrix[4] = 2.0*(xy + wz);
+  matrix[5] = 1.0 - 2.0*(xx + zz);
+  matrix[6] = 2.0*(yz - wx);
+  matrix[7] = 0.0;
+  matrix[8] = 2.0*(xz - wy);
+  matrix[9] = 2.0*(yz + wx);
+  matrix[10] = 1.0 - 2.0*(xx + yy);
+  matrix[11] = 0.0;
+  matrix[12] = 0.0;
+  matrix[13] = 0.0;
+  matrix[14] = 0.0;
+  matrix[15] = 1.0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Private Member Functions                                            /////
 ///////////////////////////////////////////////////////////////////////////////
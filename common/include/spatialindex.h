@@ -0,0 +1,80 @@
+/***************************************************************************
+                        spatialindex.h  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+/// \file
+/// Contains the declaration of the class SpatialIndex
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+///// Forward class declarations & header files ///////////////////////////////
+
+// STL header files
+#include <vector>
+using std::vector;
+
+// Xbrabo forward class declarations
+template <class T> class Point3D;
+template <class T> class Vector3D;
+
+///// class SpatialIndex //////////////////////////////////////////////////////
+class SpatialIndex
+{
+  public:
+    SpatialIndex();                     // constructor
+    ~SpatialIndex();                    // destructor
+
+    ///// public member functions for changing data
+    void build(const unsigned int numPoints, const double* x, const double* y, const double* z); // builds the grid for a set of points
+    void build(const vector<Point3D<double> >& points);     // builds the grid for a set of points
+    void invalidate();                  // marks the grid as outdated
+
+    ///// public member functions for retrieving data
+    bool isValid() const;               // returns true if the grid is up to date
+    unsigned int count() const;         // returns the number of indexed points
+    vector<unsigned int> withinRadius(const Point3D<double>& center, const double radius) const;        // returns the points within a distance of a point
+    vector<unsigned int> withinBox(const Point3D<double>& minimum, const Point3D<double>& maximum) const; // returns the points inside a box
+    vector<unsigned int> nearest(const Point3D<double>& point, const unsigned int number) const;        // returns the points closest to a point
+    vector<unsigned int> alongRay(const Point3D<double>& origin, const Vector3D<double>& direction, const double radius) const; // returns the points within a distance of a ray
+
+  private:
+    // private member functions
+    int cellX(const double x) const;    // returns the (clamped) cell index along X
+    int cellY(const double y) const;    // returns the (clamped) cell index along Y
+    int cellZ(const double z) const;    // returns the (clamped) cell index along Z
+    void addCells(const int minX, const int minY, const int minZ, const int maxX, const int maxY, const int maxZ, vector<unsigned int>& cells) const; // adds a block of cells to a list
+
+    // private member data
+    bool valid;                         ///< = true if the grid corresponds to the points
+    double originX;                     ///< The X-coordinate of the lower corner of the grid
+    double originY;                     ///< The Y-coordinate of the lower corner of the grid
+    double originZ;                     ///< The Z-coordinate of the lower corner of the grid
+    double cellSize;                    ///< The length of the edges of each (cubic) cell
+    int numCellsX;                      ///< The number of cells along X
+    int numCellsY;                      ///< The number of cells along Y
+    int numCellsZ;                      ///< The number of cells along Z
+    vector<unsigned int> cellStart;     ///< The position in the sorted arrays of the first point of each cell (+ an end marker)
+    vector<unsigned int> sortedIndices; ///< The original indices of the points sorted by cell
+    vector<double> sortedX;             ///< The X-coordinates of the points sorted by cell
+    vector<double> sortedY;             ///< The Y-coordinates of the points sorted by cell
+    vector<double> sortedZ;             ///< The Z-coordinates of the points sorted by cell
+
+    // private static data
+    static const double minimumCellSize;// the smallest edge length of a cell
+};
+
+#endif
+
@@ -60,6 +60,8 @@
 // Xbrabo header files
 #include "atomset.h"
 #include "domutils.h"
+#include "spatialindex.h"
+#include "quaternion.h"
 #include "vector3d.h" // includes the Point3D header file
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -69,12 +71,20 @@
 ///// Constructor /////////////////////////////////////////////////////////////
 AtomSet::AtomSet() :
   numAtoms(0),
+  geometryRevision(0),
   forces(0),
   chargesMulliken(0),
   chargesStockholder(0),
   boxMax(new Point3D<double>()),
   boxMin(new Point3D<double>()),
-  dirtyBox(true)
+  dirtyBox(true),
+  grid(new SpatialIndex()),
+  reuseTopology(false),
+  topologySkin(0.5),
+  journalPosition(0),
+  editLevel(0),
+  stepOpened(false),
+  replaying(false)
 /// The default constructor.
 {
 
@@ -87,18 +97,26 @@ AtomSet::~AtomSet()
   clearProperties(); // releases all allocated memory
   delete boxMax;
   delete boxMin;
+  delete grid;
 }
 
 ///// clear ///////////////////////////////////////////////////////////////////
 void AtomSet::clear()
 /// Removes all atoms.
 { 
-  coords.clear();
+  xCoords.clear();
+  yCoords.clear();
+  zCoords.clear();
+  elements.clear();
   colors.clear();
   clearProperties();
   bonds1.clear();
   bonds2.clear();
+  grid->invalidate();
   numAtoms = 0;
+  geometryRevision++;
+  if(!replaying)
+    clearHistory(); // the journal doesn't apply to the next set of atoms
   setChanged(false);
 }
 
@@ -106,10 +124,13 @@ void AtomSet::clear()
 void AtomSet::reserve(const unsigned int size)
 /// Resizes all the vectors to accomodate the requested number of atoms.
 { 
-  if(size <= coords.size())
+  if(size <= xCoords.size())
     return;
 
-  coords.reserve(size);
+  xCoords.reserve(size);
+  yCoords.reserve(size);
+  zCoords.reserve(size);
+  elements.reserve(size);
   colors.reserve(size);
   if(forces != 0)
     forces->reserve(size);
@@ -127,7 +148,7 @@ void AtomSet::addAtom(const Point3D<double>& location, const unsigned int atomic
 /// \warning Implies resetting all properties (forces, charges, etc.)
 {
   ///// return if the limit is reached (unlikely)
-  if(numAtoms == coords.max_size())
+  if(numAtoms == xCoords.max_size())
   {
     qDebug("AtomSet::addAtom: the maximum number of atoms has been reached.");
     return;
@@ -137,29 +158,26 @@ void AtomSet::addAtom(const Point3D<double>& location, const unsigned int atomic
   unsigned int atomNum = atomicNumber;
   if(atomNum > maxElements)
     atomNum = 0; // the unknown element
-  ///// make a local copy with the atomic number added
-  Point3D<double> newAtom(location);
-  newAtom.setID(atomNum);
 
   ///// add the atom 
-  if(index < 0 || static_cast<unsigned int>(index) > numAtoms)
+  recordAddition(index < 0 || static_cast<unsigned int>(index) >= numAtoms ? numAtoms : index, location, atomNum, color.rgb());
+  if(index < 0 || static_cast<unsigned int>(index) >= numAtoms)
   {
     ///// add the atom at the end
-    coords.push_back(newAtom);
-    colors.push_back(color);
+    xCoords.push_back(location.x());
+    yCoords.push_back(location.y());
+    zCoords.push_back(location.z());
+    elements.push_back(static_cast<unsigned char>(atomNum));
+    colors.push_back(color.rgb());
   }
   else
   {
-    if(static_cast<unsigned int>(index) < numAtoms - 1)
-    {
-      ///// add the atom at position index
-      vector<Point3D<double> >::iterator it = coords.begin();
-      it += index;
-      coords.insert(it, newAtom);
-      vector<QColor>::iterator it2 = colors.begin();
-      it2 += index;
-      colors.insert(it2, color);
-    }
+    ///// add the atom at position index
+    xCoords.insert(xCoords.begin() + index, location.x());
+    yCoords.insert(yCoords.begin() + index, location.y());
+    zCoords.insert(zCoords.begin() + index, location.z());
+    elements.insert(elements.begin() + index, static_cast<unsigned char>(atomNum));
+    colors.insert(colors.begin() + index, color.rgb());
   }
   numAtoms++;
 
@@ -194,20 +212,12 @@ void AtomSet::removeAtom(const unsigned int index)
 {
   if((numAtoms > 0) && (index < numAtoms))
   {
-    if(index == numAtoms - 1)
-    {
-      coords.pop_back();
-      colors.pop_back();
-    }
-    else
-    {
-      vector<Point3D<double> >::iterator it = coords.begin();
-      it += index;
-      coords.erase(it);
-      vector<QColor>::iterator it2 = colors.begin();
-      it2 += index;
-      colors.erase(it2);
-    }
+    recordRemoval(index);
+    xCoords.erase(xCoords.begin() + index);
+    yCoords.erase(yCoords.begin() + index);
+    zCoords.erase(zCoords.begin() + index);
+    elements.erase(elements.begin() + index);
+    colors.erase(colors.begin() + index);
     numAtoms--;
     setGeometryChanged();
   }
@@ -221,7 +231,8 @@ void AtomSet::setX(const unsigned int index, const double x)
   if(index >= numAtoms)
     return;
   
-  coords[index].setValues(x, coords[index].y(), coords[index].z());
+  recordMove(index);
+  xCoords[index] = x;
   setGeometryChanged();
 }
 
@@ -233,7 +244,8 @@ void AtomSet::setY(const unsigned int index, const double y)
   if(index >= numAtoms)
     return;
   
-  coords[index].setValues(coords[index].x(), y, coords[index].z());
+  recordMove(index);
+  yCoords[index] = y;
   setGeometryChanged();  
 }
 
@@ -245,7 +257,8 @@ void AtomSet::setZ(const unsigned int index, const double z)
   if(index >= numAtoms)
     return;
   
-  coords[index].setValues(coords[index].x(), coords[index].y(), z);
+  recordMove(index);
+  zCoords[index] = z;
   setGeometryChanged();
 }
 
@@ -256,7 +269,9 @@ void AtomSet::setColor(const unsigned int index, const QColor color)
   if(index >= numAtoms)
     return;
   
-  colors[index] = color;
+  recordRecolor(index, color.rgb());
+  colors[index] = color.rgb();
+  geometryRevision++;
   setChanged();
 }
 
@@ -296,6 +311,7 @@ void AtomSet::setCharges(const vector<double>& charges, const ChargeType type, c
     chargesStockholderSCF = scf;
     chargesStockholderDensity = density;
   }
+  geometryRevision++;
   setChanged();
 }
 
@@ -319,6 +335,7 @@ void AtomSet::clearCharges(const ChargeType type)
     delete chargesStockholder;
     chargesStockholder = 0;
   }
+  geometryRevision++;
   setChanged();
 }
 
@@ -364,7 +381,7 @@ void AtomSet::changeBond(const double amount, const unsigned int movingAtom, con
   moveableAtoms.push_back(movingAtom);
   
   ///// determine the amount of displacement
-  const Vector3D<double> oldPosition(coords[secondAtom], coords[movingAtom]);
+  const Vector3D<double> oldPosition(coordinates(secondAtom), coordinates(movingAtom));
   Vector3D<double> newPosition = oldPosition;
   if((oldPosition.length() + amount) < 0.1)
     newPosition.setLength(0.1); // the bond would get too small or even flip over
@@ -375,9 +392,13 @@ void AtomSet::changeBond(const double amount, const unsigned int movingAtom, con
   const double dz = newPosition.z() - oldPosition.z();
 
   ///// move all atoms
-  vector<unsigned int>::iterator it = moveableAtoms.begin();
-  while(it != moveableAtoms.end())
-    coords[*it++].add(Point3D<double>(dx, dy, dz));
+  for(vector<unsigned int>::iterator it = moveableAtoms.begin(); it != moveableAtoms.end(); it++)
+  {
+    recordMove(*it);
+    xCoords[*it] += dx;
+    yCoords[*it] += dy;
+    zCoords[*it] += dz;
+  }
 
   setGeometryChanged();
 }
@@ -412,20 +433,22 @@ void AtomSet::changeAngle(const double amount, const unsigned int movingAtom, co
   moveableAtoms.push_back(movingAtom);
 
   ///// determine the vector to rotate around => cross product of vectors along bonds
-  Vector3D<double> bond1(coords[centralAtom], coords[movingAtom]);
-  Vector3D<double> bond2(coords[centralAtom], coords[lastAtom]);
+  const Point3D<double> center = coordinates(centralAtom);
+  Vector3D<double> bond1(center, coordinates(movingAtom));
+  Vector3D<double> bond2(center, coordinates(lastAtom));
   Vector3D<double> axis = bond1.cross(bond2);
 
   ///// rotate all atoms
   std::vector<unsigned int>::iterator it = moveableAtoms.begin();
   while(it != moveableAtoms.end())
   {
-    Vector3D<double> rotatebond(coords[centralAtom], coords[*it]);
+    Vector3D<double> rotatebond(center, coordinates(*it));
     axis = rotatebond.cross(bond2);
     rotatebond.rotate(axis, amount);
-    coords[*it].setValues(coords[centralAtom].x() + rotatebond.x(),
-                          coords[centralAtom].y() + rotatebond.y(),
-                          coords[centralAtom].z() + rotatebond.z());
+    recordMove(*it);
+    xCoords[*it] = center.x() + rotatebond.x();
+    yCoords[*it] = center.y() + rotatebond.y();
+    zCoords[*it] = center.z() + rotatebond.z();
     it++;
   }
   setGeometryChanged();
@@ -473,22 +496,100 @@ void AtomSet::changeTorsion(const double amount, const unsigned int movingAtom,
     moveableAtoms.push_back(movingAtom);
 
   ///// determine the vector to rotate around => central bond
-  Vector3D<double> centralbond(coords[secondAtom], coords[thirdAtom]);
+  const Point3D<double> center = coordinates(secondAtom);
+  Vector3D<double> centralbond(center, coordinates(thirdAtom));
 
   ///// rotate all atoms
   std::vector<unsigned int>::iterator it = moveableAtoms.begin();
   while(it != moveableAtoms.end())
   {
-    Vector3D<double> rotatebond(coords[secondAtom], coords[*it]);
+    Vector3D<double> rotatebond(center, coordinates(*it));
     rotatebond.rotate(centralbond, -amount);
-    coords[*it].setValues(coords[secondAtom].x() + rotatebond.x(),
-                          coords[secondAtom].y() + rotatebond.y(),
-                          coords[secondAtom].z() + rotatebond.z());
+    recordMove(*it);
+    xCoords[*it] = center.x() + rotatebond.x();
+    yCoords[*it] = center.y() + rotatebond.y();
+    zCoords[*it] = center.z() + rotatebond.z();
     it++;
   }
   setGeometryChanged();
 }
 
+///// translateAtoms //////////////////////////////////////////////////////////
+void AtomSet::translateAtoms(const vector<unsigned int>& indices, const double dx, const double dy, const double dz)
+/// Translates the atoms in \a indices by (\a dx, \a dy, \a dz).
+/// \warning Implies resetting all properties (forces, charges, etc.)
+{
+  double matrix[16] = {1.0, 0.0, 0.0, 0.0,
+                       0.0, 1.0, 0.0, 0.0,
+                       0.0, 0.0, 1.0, 0.0,
+                       dx,  dy,  dz,  1.0};
+  transformAtoms(indices, matrix);
+}
+
+///// rotateAtoms /////////////////////////////////////////////////////////////
+void AtomSet::rotateAtoms(const vector<unsigned int>& indices, const Quaternion<double>& rotation, const Point3D<double>& center)
+/// Rotates the atoms in \a indices around \a center. The sense of the
+/// rotation is the same as for Vector3D::rotate.
+/// \warning Implies resetting all properties (forces, charges, etc.)
+{
+  double matrix[16];
+  rotation.getMatrix(matrix);
+  ///// x' = R(x - center) + center
+  matrix[12] = center.x() - (matrix[0]*center.x() + matrix[4]*center.y() + matrix[8]*center.z());
+  matrix[13] = center.y() - (matrix[1]*center.x() + matrix[5]*center.y() + matrix[9]*center.z());
+  matrix[14] = center.z() - (matrix[2]*center.x() + matrix[6]*center.y() + matrix[10]*center.z());
+  transformAtoms(indices, matrix);
+}
+
+///// transformAtoms //////////////////////////////////////////////////////////
+void AtomSet::transformAtoms(const vector<unsigned int>& indices, const double matrix[16])
+/// Applies the affine 4x4 transformation \a matrix (column-major as used by
+/// OpenGL) to the atoms in \a indices. Runs of consecutive indices are
+/// transformed in a single pass over the coordinate arrays and the geometry
+/// is only invalidated once.
+/// \warning Implies resetting all properties (forces, charges, etc.)
+{
+  if(indices.empty() || numAtoms == 0)
+    return;
+
+  double* x = &xCoords[0];
+  double* y = &yCoords[0];
+  double* z = &zCoords[0];
+  unsigned int i = 0;
+  while(i < indices.size())
+  {
+    ///// find the run of consecutive indices starting at i
+    const unsigned int first = indices[i++];
+    unsigned int last = first + 1;
+    while(i < indices.size() && indices[i] == last)
+    {
+      last++;
+      i++;
+    }
+    if(first >= numAtoms)
+      continue;
+    if(last > numAtoms)
+      last = numAtoms;
+
+    ///// transform the run
+    if(recording())
+    {
+      for(unsigned int j = first; j < last; j++)
+        recordMove(j);
+    }
+    for(unsigned int j = first; j < last; j++)
+    {
+      const double oldX = x[j];
+      const double oldY = y[j];
+      const double oldZ = z[j];
+      x[j] = matrix[0]*oldX + matrix[4]*oldY + matrix[8]*oldZ + matrix[12];
+      y[j] = matrix[1]*oldX + matrix[5]*oldY + matrix[9]*oldZ + matrix[13];
+      z[j] = matrix[2]*oldX + matrix[6]*oldY + matrix[10]*oldZ + matrix[14];
+    }
+  }
+  setGeometryChanged();
+}
+
 ///// transfer ////////////////////////////////////////////////////////////////
 void AtomSet::transferCoordinates(const AtomSet* source)
 /// Copies the coordinates from another AtomSet and resets the properties by default.
@@ -501,11 +602,110 @@ void AtomSet::transferCoordinates(const AtomSet* source)
     return;
 
   ///// copy the coordsX, Y and Z vectors
-  coords.assign(source->coords.begin(), source->coords.end());
+  clearHistory(); // the atom types might change which isn't journaled
+  xCoords = source->xCoords;
+  yCoords = source->yCoords;
+  zCoords = source->zCoords;
+  elements = source->elements;
 
   setGeometryChanged();
 }
 
+///// setTopologyReuse ////////////////////////////////////////////////////////
+void AtomSet::setTopologyReuse(const bool state, const double skin)
+/// Sets whether the bonds of a new geometry should be derived from those of the
+/// previous one. The bond search then also stores all pairs within bonding distance
+/// +  skin, and as long as no atom moves more than half the skin the bonds are
+/// regenerated from these pairs. This list survives a clear(), so reloading a
+/// structure with the same atoms (like an optimization cycle) reuses it.
+{
+  const double newSkin = skin > 0.0 ? skin : 0.0;
+  if(state == reuseTopology && newSkin == topologySkin)
+    return;
+
+  reuseTopology = state;
+  topologySkin = newSkin;
+  clearTopology();
+  ///// the next bond search has to build the neighbour list
+  bonds1.clear();
+  bonds2.clear();
+}
+
+///// beginEdit ///////////////////////////////////////////////////////////////
+void AtomSet::beginEdit()
+/// Starts a group of changes that will be undone and redone as a whole. All
+/// changes to the atoms until the matching endEdit() are journaled. Calls can
+/// be nested, in which case only the outermost pair delimits the group.
+/// Changes made outside of such a group can't be undone and discard the journal
+/// as its indices and positions wouldn't apply anymore.
+{
+  editLevel++;
+}
+
+///// endEdit /////////////////////////////////////////////////////////////////
+void AtomSet::endEdit()
+/// Ends a group of changes started by beginEdit().
+{
+  if(editLevel == 0)
+    return;
+  if(--editLevel > 0 || !stepOpened)
+    return;
+
+  finishMoves();
+  stepOpened = false;
+  journalPosition = journalSteps.size();
+
+  ///// forget the oldest step if the journal is full
+  if(journalSteps.size() > maxUndoSteps)
+  {
+    const unsigned int removed = journalSteps[1];
+    journal.erase(journal.begin(), journal.begin() + removed);
+    journalSteps.erase(journalSteps.begin());
+    for(vector<unsigned int>::iterator it = journalSteps.begin(); it != journalSteps.end(); it++)
+      *it -= removed;
+    journalPosition--;
+  }
+}
+
+///// undo ////////////////////////////////////////////////////////////////////
+bool AtomSet::undo()
+/// Reverts the last group of changes. Only the journaled atoms are touched, so
+/// the cost is proportional to the size of the change. Returns false if there
+/// was nothing to undo.
+/// \warning Implies resetting all properties (forces, charges, etc.)
+{
+  if(!canUndo())
+    return false;
+
+  replayStep(--journalPosition, false);
+  return true;
+}
+
+///// redo ////////////////////////////////////////////////////////////////////
+bool AtomSet::redo()
+/// Reapplies the last group of changes reverted by undo(). Returns false if
+/// there was nothing to redo.
+/// \warning Implies resetting all properties (forces, charges, etc.)
+{
+  if(!canRedo())
+    return false;
+
+  replayStep(journalPosition++, true);
+  return true;
+}
+
+///// clearHistory ////////////////////////////////////////////////////////////
+void AtomSet::clearHistory()
+/// Discards all undo and redo information, including that of a group of
+/// changes in progress.
+{
+  journal.clear();
+  journalSteps.clear();
+  pendingMoves.clear();
+  journalPosition = 0;
+  stepOpened = false;
+}
+
 ///// count ///////////////////////////////////////////////////////////////////
 unsigned int AtomSet::count() const
 /// Returns the number of atoms.
@@ -518,7 +718,7 @@ Point3D<double> AtomSet::coordinates(const unsigned int index) const
 /// Returns the coordinates of the atom at position \c index.
 {
   if(index < numAtoms)
-    return coords[index];
+    return Point3D<double>(xCoords[index], yCoords[index], zCoords[index]);
   else
     return Point3D<double>();
 }
@@ -528,7 +728,7 @@ double AtomSet::x(const unsigned int index) const
 /// Returns the x-coordinate of the atom at position \c index.
 {
   if(index < numAtoms)
-    return coords[index].x();
+    return xCoords[index];
   else
     return 0.0;
 }
@@ -538,7 +738,7 @@ double AtomSet::y(const unsigned int index) const
 /// Returns the y-coordinate of the atom at position \c index.
 {
   if(index < numAtoms)
-    return coords[index].y();
+    return yCoords[index];
   else
     return 0.0;
 }
@@ -548,7 +748,7 @@ double AtomSet::z(const unsigned int index) const
 /// Returns the z-coordinate of the atom at position \c index
 {
   if(index < numAtoms)
-    return coords[index].z();
+    return zCoords[index];
   else
     return 0.0;
 }
@@ -558,7 +758,7 @@ unsigned int AtomSet::atomicNumber(const unsigned int index) const
 /// Returns the atomic number of the atom at position \c index.
 {
   if(index < numAtoms)
-    return coords[index].id();
+    return elements[index];
   else
     return 0;
 }
@@ -568,11 +768,47 @@ QColor AtomSet::color(const unsigned int index) const
 /// Returns the color of the atom at position \c index.
 {
   if(index < numAtoms)
-    return colors[index];
+    return QColor(colors[index]);
   else
     return QColor(0,0,0);
 }
 
+///// xData ///////////////////////////////////////////////////////////////////
+const double* AtomSet::xData() const
+/// Returns the x-coordinates of all atoms as an array of count() elements.
+/// The pointer is invalidated by adding or removing atoms.
+{
+  return xCoords.empty() ? 0 : &xCoords[0];
+}
+
+///// yData ///////////////////////////////////////////////////////////////////
+const double* AtomSet::yData() const
+/// Returns the y-coordinates of all atoms as an array of count() elements.
+{
+  return yCoords.empty() ? 0 : &yCoords[0];
+}
+
+///// zData ///////////////////////////////////////////////////////////////////
+const double* AtomSet::zData() const
+/// Returns the z-coordinates of all atoms as an array of count() elements.
+{
+  return zCoords.empty() ? 0 : &zCoords[0];
+}
+
+///// elementData /////////////////////////////////////////////////////////////
+const unsigned char* AtomSet::elementData() const
+/// Returns the atomic numbers of all atoms as an array of count() elements.
+{
+  return elements.empty() ? 0 : &elements[0];
+}
+
+///// colorData ///////////////////////////////////////////////////////////////
+const unsigned int* AtomSet::colorData() const
+/// Returns the colors of all atoms as an array of count() QRgb values.
+{
+  return colors.empty() ? 0 : &colors[0];
+}
+
 ///// usedAtomicNumbers ///////////////////////////////////////////////////////
 vector<unsigned int> AtomSet::usedAtomicNumbers() const
 /// Returns a vector containing a sorted list of
@@ -586,7 +822,7 @@ vector<unsigned int> AtomSet::usedAtomicNumbers() const
     //  result.push_back(i); // found an occurence
     for(unsigned int j = 0; j < numAtoms; j++)
     {
-      if(coords[j].id() == i)
+      if(elements[j] == i)
       {
         result.push_back(i);
         break;
@@ -604,16 +840,22 @@ void AtomSet::bonds(vector<unsigned int>*& first, vector<unsigned int>*& second)
 {
   QTime timer;
   timer.start();
-  if(bonds1.empty() && numAtoms != 0) // only recalculate when necessary
+  if(bonds1.empty() && numAtoms != 0 && reuseTopology && reuseBonds())
+    qDebug("bonds regeneration took %f seconds", timer.restart()/1000.0f);
+  else if(bonds1.empty() && numAtoms != 0) // only recalculate when necessary
   {
     // reserve some space (guesstimate of the number of bonds to be generated, normally between 0.67x and 1x the number of atoms)
     bonds1.reserve(numAtoms);
     bonds2.reserve(numAtoms);
+    // when reusing the topology, all pairs within the skin are kept as a neighbour list
+    const double skin = reuseTopology ? topologySkin : 0.0;
+    clearTopology();
     // update the dimensions of the box
     updateBoxDimensions();
     // divide it into cells of 4x4x4 Angstrom 
     // (4.0A because largest VdW radius = 3.0A => largest distance = 1.25*(3.0 + 3.0) = 7.5A < 2 * 4.0A)
-    const double cellSize = 4.0;
+    // the cells are enlarged by the skin distance if needed
+    const double cellSize = 4.0 + skin;
     Point3D<unsigned int> numCells(static_cast<unsigned int>((boxMax->x() - boxMin->x())/cellSize) + 1,
                                    static_cast<unsigned int>((boxMax->y() - boxMin->y())/cellSize) + 1,
                                    static_cast<unsigned int>((boxMax->z() - boxMin->z())/cellSize) + 1);
@@ -624,11 +866,11 @@ void AtomSet::bonds(vector<unsigned int>*& first, vector<unsigned int>*& second)
     vector< vector<unsigned int> > atomCell(totalCells); // each cell contains a vector of all assigned atom indices
     for(unsigned int i = 0; i < numAtoms; i++)
     {
-      if(coords[i].id() != 0) // check for point charges, because they never have bonds
+      if(elements[i] != 0) // check for point charges, because they never have bonds
       {
-        unsigned int planeX = static_cast<unsigned int>((coords[i].x() - boxMin->x())/cellSize);
-        unsigned int planeY = static_cast<unsigned int>((coords[i].y() - boxMin->y())/cellSize);
-        unsigned int planeZ = static_cast<unsigned int>((coords[i].z() - boxMin->z())/cellSize);
+        unsigned int planeX = static_cast<unsigned int>((xCoords[i] - boxMin->x())/cellSize);
+        unsigned int planeY = static_cast<unsigned int>((yCoords[i] - boxMin->y())/cellSize);
+        unsigned int planeZ = static_cast<unsigned int>((zCoords[i] - boxMin->z())/cellSize);
         // the atom belongs to the cell at the crossing of planeX, planeY and planeZ
         atomCell[planeX + numCells.x()*planeY + cellsXY*planeZ].push_back(i);
       }
@@ -660,49 +902,61 @@ void AtomSet::bonds(vector<unsigned int>*& first, vector<unsigned int>*& second)
           ///// other neighbouring cells (remaining of 13 total of 26) will already have been combined with this cell before 
           ///// (no double counting)
           // X/Y/Z -> intra-cell bonds
-          addBonds(atomList, atomList);
+          addBonds(atomList, atomList, skin);
           // X+1/Y/Z
           if(cellX != (numCells.x() - 1))
-            addBonds(atomList, &atomCell[cellX+1 + numCells.x()*cellY + cellsXY*cellZ]);
+            addBonds(atomList, &atomCell[cellX+1 + numCells.x()*cellY + cellsXY*cellZ], skin);
           // X/Y+1/Z
           if(cellY != (numCells.y() - 1))
-           addBonds(atomList, &atomCell[cellX + numCells.x()*(cellY+1) + cellsXY*cellZ]);
+           addBonds(atomList, &atomCell[cellX + numCells.x()*(cellY+1) + cellsXY*cellZ], skin);
           // X/Y/Z+1
           if(cellZ != (numCells.z() - 1))
-            addBonds(atomList, &atomCell[cellX + numCells.x()*cellY + cellsXY*(cellZ+1)]);
+            addBonds(atomList, &atomCell[cellX + numCells.x()*cellY + cellsXY*(cellZ+1)], skin);
           // X+1/Y+1/Z
           if(cellX != (numCells.x() - 1) && cellY != (numCells.y() - 1))
-            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*(cellY+1) + cellsXY*cellZ]);
+            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*(cellY+1) + cellsXY*cellZ], skin);
           // X+1/Y/Z+1
           if(cellX != (numCells.x() - 1) && cellZ != (numCells.z() - 1))
-            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*cellY + cellsXY*(cellZ+1)]);
+            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*cellY + cellsXY*(cellZ+1)], skin);
           // X/Y+1/Z+1
           if(cellY != (numCells.y() - 1) && cellZ != (numCells.z() - 1))
-            addBonds(atomList, &atomCell[cellX + numCells.x()*(cellY+1) + cellsXY*(cellZ+1)]);
+            addBonds(atomList, &atomCell[cellX + numCells.x()*(cellY+1) + cellsXY*(cellZ+1)], skin);
           // X+1/Y+1/Z+1
           if(cellX != (numCells.x() - 1) && cellY != (numCells.y() - 1) && cellZ != (numCells.z() - 1))
-            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*(cellY+1) + cellsXY*(cellZ+1)]);
+            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*(cellY+1) + cellsXY*(cellZ+1)], skin);
           // X-1/Y/Z+1
           if(cellX != 0 && cellZ != (numCells.z() - 1))
-            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*cellY + cellsXY*(cellZ+1)]);
+            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*cellY + cellsXY*(cellZ+1)], skin);
           // X+1/Y+1/Z-1
           if(cellX != (numCells.x() - 1) && cellY != (numCells.y() - 1) && cellZ != 0)
-            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*(cellY+1) + cellsXY*(cellZ-1)]);
+            addBonds(atomList, &atomCell[(cellX+1) + numCells.x()*(cellY+1) + cellsXY*(cellZ-1)], skin);
           // X/Y+1/Z-1
           if(cellY != (numCells.y() - 1) && cellZ != 0)
-            addBonds(atomList, &atomCell[cellX + numCells.x()*(cellY+1) + cellsXY*(cellZ-1)]);
+            addBonds(atomList, &atomCell[cellX + numCells.x()*(cellY+1) + cellsXY*(cellZ-1)], skin);
           // X-1/Y+1/Z-1
           if(cellX != 0 && cellY != (numCells.y() - 1) && cellZ != 0)
-            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*(cellY+1) + cellsXY*(cellZ-1)]);
+            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*(cellY+1) + cellsXY*(cellZ-1)], skin);
           // X-1/Y+1/Z
           if(cellX != 0 && cellY != (numCells.y() - 1))
-            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*(cellY+1) + cellsXY*cellZ]);
+            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*(cellY+1) + cellsXY*cellZ], skin);
           // X-1/Y+1/Z+1
           if(cellX != 0 && cellY != (numCells.y() - 1) && cellZ != (numCells.z() - 1))
-            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*(cellY+1) + cellsXY*(cellZ+1)]);
+            addBonds(atomList, &atomCell[(cellX-1) + numCells.x()*(cellY+1) + cellsXY*(cellZ+1)], skin);
         }
       }
     }
+    if(reuseTopology)
+    {
+      verletElements = elements;
+      verletCoords.resize(3*numAtoms);
+      for(unsigned int i = 0; i < numAtoms; i++)
+      {
+        verletCoords[3*i] = xCoords[i];
+        verletCoords[3*i + 1] = yCoords[i];
+        verletCoords[3*i + 2] = zCoords[i];
+      }
+      validatedCoords = verletCoords;
+    }
     qDebug("bonds generation took %f seconds", timer.restart()/1000.0f);
   }
   // old unoptimized code (44 times slower for 8870 atoms of acetone cluster, 25 times slower for GFP)
@@ -760,18 +1014,25 @@ unsigned int AtomSet::numberOfBonds(unsigned int index) const
   if(index >= numAtoms || atomicNumber(index) == 0)
     return 0;
 
+  ///// only check the atoms within the largest possible bond length
+  float largestRadius = 0.0f;
+  for(unsigned int i = 1; i <= maxElements; i++)
+    largestRadius = std::max(largestRadius, vanderWaals(i));
+  const vector<unsigned int> neighbours = atomsWithinRadius(coordinates(index), 1.25f*(vanderWaals(atomicNumber(index)) + largestRadius));
+
   unsigned int result = 0;
   float distance2, refdistance, dx, dy, dz;
 
   ///// similar to bonds-code
-  for(unsigned int i = 0; i < numAtoms; i++)
+  for(vector<unsigned int>::const_iterator it = neighbours.begin(); it != neighbours.end(); it++)
   {
+    const unsigned int i = *it;
     if(i == index || atomicNumber(i) == 0)
       continue;
 
-    dx = static_cast<float>(coords[i].x() - coords[index].x());
-    dy = static_cast<float>(coords[i].y() - coords[index].y());
-    dz = static_cast<float>(coords[i].z() - coords[index].z());
+    dx = static_cast<float>(xCoords[i] - xCoords[index]);
+    dy = static_cast<float>(yCoords[i] - yCoords[index]);
+    dz = static_cast<float>(zCoords[i] - zCoords[index]);
 
     distance2 = dx*dx + dy*dy + dz*dz;
     refdistance = 1.25f*(vanderWaals(atomicNumber(i)) + vanderWaals(atomicNumber(index)));
@@ -782,6 +1043,37 @@ unsigned int AtomSet::numberOfBonds(unsigned int index) const
   return result;
 }
 
+///// atomsWithinRadius ///////////////////////////////////////////////////////
+vector<unsigned int> AtomSet::atomsWithinRadius(const Point3D<double>& center, const double radius) const
+/// Returns the sorted indices of all atoms within a distance \a radius of \a center.
+{
+  return spatialIndex()->withinRadius(center, radius);
+}
+
+///// atomsInBox //////////////////////////////////////////////////////////////
+vector<unsigned int> AtomSet::atomsInBox(const Point3D<double>& minimum, const Point3D<double>& maximum) const
+/// Returns the sorted indices of all atoms inside the box with corners
+/// \a minimum and \a maximum.
+{
+  return spatialIndex()->withinBox(minimum, maximum);
+}
+
+///// nearestAtoms ////////////////////////////////////////////////////////////
+vector<unsigned int> AtomSet::nearestAtoms(const Point3D<double>& point, const unsigned int number) const
+/// Returns the indices of the \a number atoms closest to \a point, sorted by
+/// increasing distance.
+{
+  return spatialIndex()->nearest(point, number);
+}
+
+///// atomsAlongRay ///////////////////////////////////////////////////////////
+vector<unsigned int> AtomSet::atomsAlongRay(const Point3D<double>& origin, const Vector3D<double>& direction, const double radius) const
+/// Returns the indices of all atoms within a distance \a radius of the ray
+/// from \a origin along \a direction, sorted by their distance along the ray.
+{
+  return spatialIndex()->alongRay(origin, direction, radius);
+}
+
 ///// isLinear ////////////////////////////////////////////////////////////////
 bool AtomSet::isLinear() const
 /// Returns true if the atoms form a linear molecule.
@@ -792,9 +1084,9 @@ bool AtomSet::isLinear() const
   ///// check whether each point (3-numAtoms) is collinear with the points 1 and 2
   ///// => (x2-x1)/(x3-x1) = (y2-y1)/(y3-y1) = (z2-z1)/(z3-z1) (from mathforum.org FAQ)
   ///// => (x2-x1)(y3-y1) == (y2-y1)(x3-x1) && (y2-y1)(z3-z1) == (z2-z1)(y3-y1)
-  double dx10 = coords[1].x() - coords[0].x();
-  double dy10 = coords[1].y() - coords[0].y();
-  double dz10 = coords[1].z() - coords[0].z();
+  double dx10 = xCoords[1] - xCoords[0];
+  double dy10 = yCoords[1] - yCoords[0];
+  double dz10 = zCoords[1] - zCoords[0];
 
   for(unsigned int i = 2; i < numAtoms; i++)
   {
@@ -802,10 +1094,10 @@ bool AtomSet::isLinear() const
     //double test2 = (y(1) - y(0)) * (x(i) - x(0));
     //double test3 = (y(1) - y(0)) * (z(i) - z(0));
     //double test4 = (z(1) - z(0)) * (y(i) - y(0));
-    double test1 = dx10 * (coords[i].y() - coords[0].y());
-    double test2 = dy10 * (coords[i].x() - coords[0].x());
-    double test3 = dy10 * (coords[i].z() - coords[0].z());
-    double test4 = dz10 * (coords[i].y() - coords[0].y());
+    double test1 = dx10 * (yCoords[i] - yCoords[0]);
+    double test2 = dy10 * (xCoords[i] - xCoords[0]);
+    double test3 = dy10 * (zCoords[i] - zCoords[0]);
+    double test4 = dz10 * (yCoords[i] - yCoords[0]);
     if((fabs(test1 - test2) > Point3D<double>::TOLERANCE) || (fabs(test3 - test4) > Point3D<double>::TOLERANCE))
       return false;
   }
@@ -820,6 +1112,36 @@ bool AtomSet::isChanged() const
   return changed;
 }
 
+///// revision ////////////////////////////////////////////////////////////////
+unsigned int AtomSet::revision() const
+/// Returns a number that changes whenever the geometry, the colors or the
+/// charges of the atoms change. Views can compare it with a stored value to find out whether
+/// derived data has to be regenerated.
+{
+  return geometryRevision;
+}
+
+///// topologyReuse ///////////////////////////////////////////////////////////
+bool AtomSet::topologyReuse() const
+/// Returns true if the bond topology is reused between successive geometries.
+{
+  return reuseTopology;
+}
+
+///// canUndo /////////////////////////////////////////////////////////////////
+bool AtomSet::canUndo() const
+/// Returns true if a group of changes can be undone.
+{
+  return editLevel == 0 && journalPosition > 0;
+}
+
+///// canRedo /////////////////////////////////////////////////////////////////
+bool AtomSet::canRedo() const
+/// Returns true if a group of changes can be redone.
+{
+  return editLevel == 0 && journalPosition < journalSteps.size();
+}
+
 ///// dx //////////////////////////////////////////////////////////////////////
 double AtomSet::dx(const unsigned int index) const
 /// Returns the x-component of the force on the atom
@@ -857,7 +1179,7 @@ double AtomSet::dz(const unsigned int index) const
 double AtomSet::bond(const unsigned int atom1, const unsigned int atom2) const
 /// Returns the distance between the two atoms.
 {
-  Vector3D<double> bondSize(coords[atom1], coords[atom2]);
+  Vector3D<double> bondSize(coordinates(atom1), coordinates(atom2));
   return bondSize.length();
 }
 
@@ -865,8 +1187,8 @@ double AtomSet::bond(const unsigned int atom1, const unsigned int atom2) const
 double AtomSet::angle(const unsigned int atom1, const unsigned int atom2, const unsigned int atom3) const
 /// Returns the value of the valence angle 1-2-3.
 {
-  Vector3D<double> bond1(coords[atom2], coords[atom1]);
-  Vector3D<double> bond2(coords[atom2], coords[atom3]);
+  Vector3D<double> bond1(coordinates(atom2), coordinates(atom1));
+  Vector3D<double> bond2(coordinates(atom2), coordinates(atom3));
   return bond1.angle(bond2);
 }
 
@@ -874,9 +1196,9 @@ double AtomSet::angle(const unsigned int atom1, const unsigned int atom2, const
 double AtomSet::torsion(const unsigned int atom1, const unsigned int atom2, const unsigned int atom3, const unsigned int atom4) const
 /// Returns the value of the torsion angle 1-2-3-4.
 {
-  Vector3D<double> bond1(coords[atom2], coords[atom1]);
-  Vector3D<double> centralbond(coords[atom2], coords[atom3]);
-  Vector3D<double> bond2(coords[atom3], coords[atom4]);
+  Vector3D<double> bond1(coordinates(atom2), coordinates(atom1));
+  Vector3D<double> centralbond(coordinates(atom2), coordinates(atom3));
+  Vector3D<double> bond2(coordinates(atom3), coordinates(atom4));
   return bond1.torsion(bond2, centralbond);
 }
 
@@ -1071,9 +1393,9 @@ void AtomSet::saveCML(QDomElement* root)
     childNode = root->ownerDocument().createElement("atom");
     childNode.setAttribute("id", QString(numToAtom(atomicNumber(i)).trimmed() + QString::number(i + 1)));
     childNode.setAttribute("elementType", numToAtom(atomicNumber(i)).trimmed());
-    childNode.setAttribute("x3", QString::number(coords[i].x(), 'f', 12));
-    childNode.setAttribute("y3", QString::number(coords[i].y(), 'f', 12));
-    childNode.setAttribute("z3", QString::number(coords[i].z(), 'f', 12));
+    childNode.setAttribute("x3", QString::number(xCoords[i], 'f', 12));
+    childNode.setAttribute("y3", QString::number(yCoords[i], 'f', 12));
+    childNode.setAttribute("z3", QString::number(zCoords[i], 'f', 12));
     atomArray.appendChild(childNode);
     ///// color
     grandChildNode = root->ownerDocument().createElement("scalar");
@@ -1414,6 +1736,8 @@ void AtomSet::setGeometryChanged()
   bonds1.clear();
   bonds2.clear();
   dirtyBox = true;
+  grid->invalidate();
+  geometryRevision++;
 }
 
 ///// addBondList /////////////////////////////////////////////////////
@@ -1537,26 +1861,26 @@ void AtomSet::updateBoxDimensions()
   }
   else
   {
-    double maxx = coords[0].x();
-    double maxy = coords[0].y();
-    double maxz = coords[0].z();
+    double maxx = xCoords[0];
+    double maxy = yCoords[0];
+    double maxz = zCoords[0];
     double minx = maxx;
     double miny = maxy;
     double minz = maxz;
     for(unsigned int i = 1; i < numAtoms; i++)
     {
-      if(coords[i].x() > maxx)
-        maxx = coords[i].x();
-      else if(coords[i].x() < minx)
-        minx = coords[i].x();
-      if(coords[i].y() > maxy)
-        maxy = coords[i].y();
-      else if(coords[i].y() < miny)
-        miny = coords[i].y();
-      if(coords[i].z() > maxz)
-        maxz = coords[i].z();
-      else if(coords[i].z() < minz)
-        minz = coords[i].z();
+      if(xCoords[i] > maxx)
+        maxx = xCoords[i];
+      else if(xCoords[i] < minx)
+        minx = xCoords[i];
+      if(yCoords[i] > maxy)
+        maxy = yCoords[i];
+      else if(yCoords[i] < miny)
+        miny = yCoords[i];
+      if(zCoords[i] > maxz)
+        maxz = zCoords[i];
+      else if(zCoords[i] < minz)
+        minz = zCoords[i];
     }
     boxMax->setValues(maxx, maxy, maxz);
     boxMin->setValues(minx, miny, minz);
@@ -1564,9 +1888,10 @@ void AtomSet::updateBoxDimensions()
 }
 
 ///// addBonds ////////////////////////////////////////////////////////////////
-void AtomSet::addBonds(const vector<unsigned int>* atomList1, const vector<unsigned int>* atomList2)
+void AtomSet::addBonds(const vector<unsigned int>* atomList1, const vector<unsigned int>* atomList2, const double skin)
 /// Calculates all bonds between the atoms in the 2 provided lists and adds them
-/// to the bonds1 and bonds2 vectors
+/// to the bonds1 and bonds2 vectors. If \a skin is nonzero, all pairs within
+/// bonding distance + skin are also added to the neighbour list.
 {
   // check whether the second list contains any atoms (the first list is already checked in the
   // bonds function
@@ -1584,24 +1909,277 @@ void AtomSet::addBonds(const vector<unsigned int>* atomList1, const vector<unsig
   for(unsigned int i = 0; i < atomList1->size(); i++)
   {
     atomIndex1 = atomList1->operator[](i);
-    atomNum1 = coords[atomIndex1].id(); // can never be zero as that has been checked in bonds
+    atomNum1 = elements[atomIndex1]; // can never be zero as that has been checked in bonds
     if(atomList1 == atomList2)
       limit = i; // prevents bonds between same atoms or double counting of bonds between identical atom lists
     for(unsigned int j = 0; j < limit; j++)
     {
       atomIndex2 = atomList2->operator[](j);
-      dx = static_cast<float>(coords[atomIndex1].x() - coords[atomIndex2].x());
-      dy = static_cast<float>(coords[atomIndex1].y() - coords[atomIndex2].y());
-      dz = static_cast<float>(coords[atomIndex1].z() - coords[atomIndex2].z());
+      dx = static_cast<float>(xCoords[atomIndex1] - xCoords[atomIndex2]);
+      dy = static_cast<float>(yCoords[atomIndex1] - yCoords[atomIndex2]);
+      dz = static_cast<float>(zCoords[atomIndex1] - zCoords[atomIndex2]);
       distance2 = dx*dx + dy*dy +dz*dz;
-      refdistance = 1.25f*(vanderWaals(atomNum1) + vanderWaals(coords[atomIndex2].id()));
+      refdistance = 1.25f*(vanderWaals(atomNum1) + vanderWaals(elements[atomIndex2]));
       if(distance2 <= refdistance*refdistance)
       {
         bonds1.push_back(atomIndex1);
         bonds2.push_back(atomIndex2);
       }
+      if(skin != 0.0 && distance2 <= (refdistance + skin)*(refdistance + skin))
+      {
+        verletPairs1.push_back(atomIndex1);
+        verletPairs2.push_back(atomIndex2);
+        verletBonded.push_back(distance2 <= refdistance*refdistance);
+      }
+    }
+  }
+}
+
+///// reuseBonds //////////////////////////////////////////////////////////////
+bool AtomSet::reuseBonds()
+/// Regenerates the bonds from the neighbour list built for a previous geometry.
+/// Only pairs containing an atom that moved more than topologyTolerance since
+/// it was last checked are recalculated. Returns false if the list is unusable
+/// because the atoms differ or one of them moved more than half the skin.
+{
+  if(verletElements.size() != numAtoms)
+    return false;
+
+  ///// check the displacements since the neighbour list was built
+  const double maxDisplacement2 = topologySkin*topologySkin/4.0;
+  const double tolerance2 = topologyTolerance*topologyTolerance;
+  vector<bool> moved(numAtoms, false);
+  double dx, dy, dz;
+  for(unsigned int i = 0; i < numAtoms; i++)
+  {
+    if(elements[i] != verletElements[i])
+      return false;
+    dx = xCoords[i] - verletCoords[3*i];
+    dy = yCoords[i] - verletCoords[3*i + 1];
+    dz = zCoords[i] - verletCoords[3*i + 2];
+    if(dx*dx + dy*dy + dz*dz > maxDisplacement2)
+      return false;
+    dx = xCoords[i] - validatedCoords[3*i];
+    dy = yCoords[i] - validatedCoords[3*i + 1];
+    dz = zCoords[i] - validatedCoords[3*i + 2];
+    moved[i] = dx*dx + dy*dy + dz*dz > tolerance2;
+  }
+
+  ///// revalidate the pairs of the neighbour list
+  float distance2, refdistance, fx, fy, fz;
+  unsigned int atomIndex1, atomIndex2;
+  for(unsigned int i = 0; i < verletBonded.size(); i++)
+  {
+    atomIndex1 = verletPairs1[i];
+    atomIndex2 = verletPairs2[i];
+    if(moved[atomIndex1] || moved[atomIndex2])
+    {
+      fx = static_cast<float>(xCoords[atomIndex1] - xCoords[atomIndex2]);
+      fy = static_cast<float>(yCoords[atomIndex1] - yCoords[atomIndex2]);
+      fz = static_cast<float>(zCoords[atomIndex1] - zCoords[atomIndex2]);
+      distance2 = fx*fx + fy*fy + fz*fz;
+      refdistance = 1.25f*(vanderWaals(elements[atomIndex1]) + vanderWaals(elements[atomIndex2]));
+      verletBonded[i] = distance2 <= refdistance*refdistance;
+    }
+    if(verletBonded[i])
+    {
+      bonds1.push_back(atomIndex1);
+      bonds2.push_back(atomIndex2);
+    }
+  }
+  for(unsigned int i = 0; i < numAtoms; i++)
+  {
+    if(moved[i])
+    {
+      validatedCoords[3*i] = xCoords[i];
+      validatedCoords[3*i + 1] = yCoords[i];
+      validatedCoords[3*i + 2] = zCoords[i];
+    }
+  }
+  return true;
+}
+
+///// spatialIndex ////////////////////////////////////////////////////////////
+const SpatialIndex* AtomSet::spatialIndex() const
+/// Returns the spatial index of the atoms, rebuilding it first if the geometry
+/// changed since the last query.
+{
+  if(!grid->isValid())
+    grid->build(numAtoms, xData(), yData(), zData());
+  return grid;
+}
+
+///// clearTopology ///////////////////////////////////////////////////////////
+void AtomSet::clearTopology()
+/// Discards the neighbour list of the previous geometry.
+{
+  verletCoords.clear();
+  verletElements.clear();
+  validatedCoords.clear();
+  verletPairs1.clear();
+  verletPairs2.clear();
+  verletBonded.clear();
+}
+
+///// recording ///////////////////////////////////////////////////////////////
+bool AtomSet::recording()
+/// Returns true if a change should be journaled, i.e. inside a group of changes
+/// (beginEdit/endEdit) and not during an undo or redo. A change outside of a
+/// group discards the journal. The first journaled change of a group starts
+/// a new step, which replaces the steps that could still be redone.
+{
+  if(replaying)
+    return false;
+
+  if(editLevel == 0)
+  {
+    if(!journalSteps.empty())
+      clearHistory();
+    return false;
+  }
+
+  if(!stepOpened)
+  {
+    const unsigned int end = journalPosition < journalSteps.size() ? journalSteps[journalPosition] : journal.size();
+    journal.erase(journal.begin() + end, journal.end());
+    journalSteps.resize(journalPosition);
+    journalSteps.push_back(journal.size());
+    stepOpened = true;
+  }
+  return true;
+}
+
+///// recordMove //////////////////////////////////////////////////////////////
+void AtomSet::recordMove(const unsigned int index)
+/// Journals the position of the atom \a index before it is moved. Only the
+/// first move of an atom within a group is recorded, its final position
+/// is filled in by finishMoves().
+{
+  if(!recording())
+    return;
+  if(!pendingMoves.insert(std::make_pair(index, journal.size())).second)
+    return; // already journaled
+
+  JournalEntry entry;
+  entry.type = JournalMove;
+  entry.element = elements[index];
+  entry.index = index;
+  entry.oldColor = entry.newColor = colors[index];
+  entry.oldX = entry.newX = xCoords[index];
+  entry.oldY = entry.newY = yCoords[index];
+  entry.oldZ = entry.newZ = zCoords[index];
+  journal.push_back(entry);
+}
+
+///// recordRecolor ///////////////////////////////////////////////////////////
+void AtomSet::recordRecolor(const unsigned int index, const unsigned int newColor)
+/// Journals the change of the color of atom \a index to \a newColor.
+{
+  if(!recording())
+    return;
+
+  JournalEntry entry;
+  entry.type = JournalRecolor;
+  entry.element = elements[index];
+  entry.index = index;
+  entry.oldColor = colors[index];
+  entry.newColor = newColor;
+  entry.oldX = entry.newX = xCoords[index];
+  entry.oldY = entry.newY = yCoords[index];
+  entry.oldZ = entry.newZ = zCoords[index];
+  journal.push_back(entry);
+}
+
+///// recordAddition //////////////////////////////////////////////////////////
+void AtomSet::recordAddition(const unsigned int index, const Point3D<double>& location, const unsigned int atomicNumber, const unsigned int color)
+/// Journals an atom that is about to be added at position \a index.
+{
+  if(!recording())
+    return;
+  finishMoves(); // the indices of the pending moves are about to shift
+
+  JournalEntry entry;
+  entry.type = JournalAddition;
+  entry.element = static_cast<unsigned char>(atomicNumber);
+  entry.index = index;
+  entry.oldColor = entry.newColor = color;
+  entry.oldX = entry.newX = location.x();
+  entry.oldY = entry.newY = location.y();
+  entry.oldZ = entry.newZ = location.z();
+  journal.push_back(entry);
+}
+
+///// recordRemoval ///////////////////////////////////////////////////////////
+void AtomSet::recordRemoval(const unsigned int index)
+/// Journals the atom \a index before it is removed.
+{
+  if(!recording())
+    return;
+  finishMoves(); // the indices of the pending moves are about to shift
+
+  JournalEntry entry;
+  entry.type = JournalRemoval;
+  entry.element = elements[index];
+  entry.index = index;
+  entry.oldColor = entry.newColor = colors[index];
+  entry.oldX = entry.newX = xCoords[index];
+  entry.oldY = entry.newY = yCoords[index];
+  entry.oldZ = entry.newZ = zCoords[index];
+  journal.push_back(entry);
+}
+
+///// finishMoves /////////////////////////////////////////////////////////////
+void AtomSet::finishMoves()
+/// Stores the current positions of the atoms with pending moves as their new
+/// positions.
+{
+  for(std::map<unsigned int, unsigned int>::iterator it = pendingMoves.begin(); it != pendingMoves.end(); it++)
+  {
+    JournalEntry& entry = journal[it->second];
+    entry.newX = xCoords[it->first];
+    entry.newY = yCoords[it->first];
+    entry.newZ = zCoords[it->first];
+  }
+  pendingMoves.clear();
+}
+
+///// replayStep //////////////////////////////////////////////////////////////
+void AtomSet::replayStep(const unsigned int step, const bool forward)
+/// Redoes (\a forward = true) or undoes the changes of step \a step of the
+/// journal. Undoing processes the changes in reverse order.
+{
+  const unsigned int first = journalSteps[step];
+  const unsigned int last = step + 1 < journalSteps.size() ? journalSteps[step + 1] : journal.size();
+
+  replaying = true;
+  for(unsigned int i = 0; i < last - first; i++)
+  {
+    const JournalEntry& entry = journal[forward ? first + i : last - 1 - i];
+    switch(entry.type)
+    {
+      case JournalMove:     xCoords[entry.index] = forward ? entry.newX : entry.oldX;
+                            yCoords[entry.index] = forward ? entry.newY : entry.oldY;
+                            zCoords[entry.index] = forward ? entry.newZ : entry.oldZ;
+                            break;
+
+      case JournalAddition: if(forward)
+                              addAtom(entry.newX, entry.newY, entry.newZ, entry.element, QColor(entry.newColor), entry.index);
+                            else
+                              removeAtom(entry.index);
+                            break;
+
+      case JournalRemoval:  if(forward)
+                              removeAtom(entry.index);
+                            else
+                              addAtom(entry.oldX, entry.oldY, entry.oldZ, entry.element, QColor(entry.oldColor), entry.index);
+                            break;
+
+      case JournalRecolor:  colors[entry.index] = forward ? entry.newColor : entry.oldColor;
+                            break;
     }
   }
+  replaying = false;
+  setGeometryChanged();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1609,4 +2187,6 @@ void AtomSet::addBonds(const vector<unsigned int>* atomList1, const vector<unsig
 ///////////////////////////////////////////////////////////////////////////////
 
 const unsigned int AtomSet::maxElements = 54;
+const double AtomSet::topologyTolerance = 0.01;
+const unsigned int AtomSet::maxUndoSteps = 100;
 
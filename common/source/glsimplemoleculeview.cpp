@@ -38,12 +38,17 @@
 
 // Qt header files
 #include <qapplication.h>
+#include <qcolor.h>
 #include <QtXml/qdom.h>
 #include <QFileDialog>
 #include <qmessagebox.h>
 #include <qpoint.h>
 #include <QStringList>
 #include <QKeyEvent>
+#include <QGLShaderProgram>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
 
 #include <GL/glu.h>
 
@@ -53,6 +58,8 @@
 #include "glsimplemoleculeview.h"
 #include "point3d.h"
 #include "vector3d.h"
+#include "quaternion.h"
+#include "spatialindex.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 ///// Public Member Functions                                             /////
@@ -60,9 +67,22 @@
 
 ///// constructor /////////////////////////////////////////////////////////////
 GLSimpleMoleculeView::GLSimpleMoleculeView(AtomSet* atomset, QWidget* parent, const char* name ) : GLView(parent, name),
+  atomChunkLists(0),
+  numAtomChunkLists(0),
+  bondChunkLists(0),
+  numBondChunkLists(0),
+  atomBatchValid(false),
+  bondBatchValid(false),
+  impostorProgram(0),
+  bondCacheValid(false),
+  bondIndex(new SpatialIndex()),
+  bondIndexReach(0.0),
+  largestElementValid(false),
   chargeType(AtomSet::None),
   atoms(atomset),
-  scaleFactor(1.0f)
+  scaleFactor(1.0f),
+  labelTexture(0),
+  labelCacheValid(false)
 /// The default constructor.
 {
   moleculeStyle = moleculeParameters.defaultMoleculeStyle;
@@ -89,6 +109,13 @@ GLSimpleMoleculeView::~GLSimpleMoleculeView()
 {
   makeCurrent();
   glDeleteLists(atomObject, 4);
+  glDeleteLists(atomLODObjects, 2*numLODLevels);
+  resizeChunkLists(atomChunkLists, numAtomChunkLists, 0);
+  resizeChunkLists(bondChunkLists, numBondChunkLists, 0);
+  if(labelTexture != 0)
+    glDeleteTextures(1, &labelTexture);
+  delete impostorProgram;
+  delete bondIndex;
 }
 
 ///// displayStyle ////////////////////////////////////////////////////////////
@@ -385,6 +412,29 @@ void GLSimpleMoleculeView::initializeGL()
   bondObject = atomObject + 1;
   forceObjectLines = atomObject + 2;
   forceObjectTubes = atomObject + 3;
+  atomLODObjects = glGenLists(2*numLODLevels);
+  bondLODObjects = atomLODObjects + numLODLevels;
+  numAtomChunkLists = 0; // belong to a previous context if any
+  numBondChunkLists = 0;
+  atomBatchValid = false;
+  bondBatchValid = false;
+  labelTexture = 0; // belongs to a previous context if any
+
+  ///// the shaders for drawing atoms as sprites are optional
+  delete impostorProgram;
+  impostorProgram = 0;
+  if(QGLShaderProgram::hasOpenGLShaderPrograms(context()))
+  {
+    impostorProgram = new QGLShaderProgram(context());
+    if(!impostorProgram->addShaderFromSourceCode(QGLShader::Vertex, impostorVertexShader) ||
+       !impostorProgram->addShaderFromSourceCode(QGLShader::Fragment, impostorFragmentShader) ||
+       !impostorProgram->link())
+    {
+      qDebug("GLSimpleMoleculeView::initializeGL: atom sprites disabled: %s", impostorProgram->log().toLatin1().data());
+      delete impostorProgram;
+      impostorProgram = 0;
+    }
+  }
   updateGLSettings();
 
   GLView::initializeGL();
@@ -396,13 +446,17 @@ float GLSimpleMoleculeView::boundingSphereRadius()
 {
   float radius = 0.0;
   float x, y, z, tempradius;
+  const double* xCoords = atoms->xData();
+  const double* yCoords = atoms->yData();
+  const double* zCoords = atoms->zData();
+  const unsigned char* elements = atoms->elementData();
   for(unsigned int i = 0; i < atoms->count(); i++)
   {
-    x = static_cast<float>(atoms->x(i) - centerX);
-    y = static_cast<float>(atoms->y(i) - centerY);
-    z = static_cast<float>(atoms->z(i) - centerZ);
+    x = static_cast<float>(xCoords[i] - centerX);
+    y = static_cast<float>(yCoords[i] - centerY);
+    z = static_cast<float>(zCoords[i] - centerZ);
     ///// the following might have to be changed when scaling of atomsizes is permitted
-    tempradius = sqrt(x*x + y*y + z*z) + static_cast<float>(AtomSet::vanderWaals(atoms->atomicNumber(i)))/2.0f;
+    tempradius = sqrt(x*x + y*y + z*z) + static_cast<float>(AtomSet::vanderWaals(elements[i]))/2.0f;
     if(tempradius > radius)
       radius = tempradius;
   }
@@ -446,6 +500,11 @@ void GLSimpleMoleculeView::updateGLSettings()
   ///// atom and bond quality
   //int numSlices = static_cast<int>(pow(2.0,static_cast<double>(moleculeParameters.quality)));
   changeObjects(atomObject, moleculeParameters.quality);
+  changeLODObjects(moleculeParameters.quality);
+  ///// the sizes of the atoms and bonds might have changed
+  atomBatchValid = false;
+  bondBatchValid = false;
+  bondCacheValid = false; // the bounds of the bonds depend on their size
 
   ///// linewidths and pointsizes for selections in None or Lines mode
   ///// get the maximum linewidth and pointsize
@@ -513,6 +572,40 @@ void GLSimpleMoleculeView::updateShapes()
   shapes.push_back(prop);
 }
 
+///// resizeChunkLists ////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::resizeChunkLists(GLuint& lists, unsigned int& numLists, const unsigned int number)
+/// Makes sure the range of display lists starting at \a lists holds \a number
+/// lists. A new range is only allocated when the number of lists changes.
+{
+  if(numLists == number)
+    return;
+  if(numLists != 0)
+    glDeleteLists(lists, numLists);
+  lists = number != 0 ? glGenLists(number) : 0;
+  numLists = lists != 0 ? number : 0;
+}
+
+///// visibleChunks ///////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::visibleChunks(const std::vector<GLfloat>& bounds, std::vector<unsigned int>& ranges) const
+/// Returns the chunks of which the bounding box is inside the view as pairs of
+/// (first chunk, last chunk + 1). Consecutive visible chunks are merged into
+/// one range so they can be drawn with a single call.
+{
+  ranges.clear();
+  for(unsigned int chunk = 0; chunk < bounds.size()/6; chunk++)
+  {
+    if(!boxInFrustum(&bounds[6*chunk]))
+      continue;
+    if(!ranges.empty() && ranges.back() == chunk)
+      ranges.back()++;
+    else
+    {
+      ranges.push_back(chunk);
+      ranges.push_back(chunk + 1);
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Private Member Functions                                            /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -585,64 +678,271 @@ void GLSimpleMoleculeView::changeObjects(const GLuint startList, const int numSl
   gluDeleteQuadric(qobj);
 }
 
+///// changeLODObjects ////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::changeLODObjects(const int numSlices)
+/// Changes the atom and bond shapes used by the chunks of atoms and bonds.
+/// Each level of detail has half the number of slices of the previous one,
+/// starting at numSlices and ending at minimumLODSlices.
+{
+  GLUquadricObj* qobj;
+  qobj = gluNewQuadric();
+  gluQuadricNormals(qobj, GLU_SMOOTH);
+  gluQuadricOrientation(qobj, GLU_OUTSIDE);
+
+  lodSlices.resize(numLODLevels);
+  for(unsigned int level = 0; level < numLODLevels; level++)
+  {
+    lodSlices[level] = std::max(numSlices >> level, std::min(numSlices, minimumLODSlices));
+    glNewList(atomLODObjects + level, GL_COMPILE);
+      gluSphere(qobj, 1.0f, lodSlices[level], lodSlices[level]);
+    glEndList();
+    glNewList(bondLODObjects + level, GL_COMPILE);
+      gluCylinder(qobj, 1.0f, 1.0f, cylinderHeight, lodSlices[level], 1);
+    glEndList();
+  }
+
+  gluDeleteQuadric(qobj);
+}
+
+///// updateLODParameters /////////////////////////////////////////////////////
+void GLSimpleMoleculeView::updateLODParameters()
+/// Determines the scale of the current modelview and projection matrices,
+/// which is used by lodLevel to calculate the size of shapes on the screen.
+{
+  GLfloat projection[16];
+  GLint viewport[4];
+  glGetFloatv(GL_MODELVIEW_MATRIX, lodModelview);
+  glGetFloatv(GL_PROJECTION_MATRIX, projection);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  lodPerspective = projection[11] != 0.0f;
+  lodModelScale = sqrt(lodModelview[0]*lodModelview[0] + lodModelview[1]*lodModelview[1] + lodModelview[2]*lodModelview[2]);
+  lodPixelScale = projection[5]*static_cast<GLfloat>(viewport[3])/2.0f*lodModelScale;
+}
+
+///// lodLevel ////////////////////////////////////////////////////////////////
+unsigned int GLSimpleMoleculeView::lodLevel(const GLfloat* bounds, const GLfloat radius) const
+/// Returns the level of detail for drawing shapes of the given radius inside
+/// the bounding box. This is the lowest detail for which a slice still covers
+/// at most lodPixelsPerSlice of the circumference of the largest shape on the
+/// screen. With a perspective projection the point of the box closest to the
+/// camera is taken. Molecules with more atoms than the fast rendering limit
+/// are always drawn at the lowest level of detail.
+{
+  if(atoms->count() > moleculeParameters.fastRenderLimit)
+    return numLODLevels - 1;
+
+  GLfloat pixelRadius = radius*lodPixelScale;
+  if(lodPerspective)
+  {
+    const GLfloat x = (bounds[0] + bounds[3])/2.0f;
+    const GLfloat y = (bounds[1] + bounds[4])/2.0f;
+    const GLfloat z = (bounds[2] + bounds[5])/2.0f;
+    const GLfloat halfDiagonal = sqrt((bounds[3] - bounds[0])*(bounds[3] - bounds[0]) + (bounds[4] - bounds[1])*(bounds[4] - bounds[1])
+                                      + (bounds[5] - bounds[2])*(bounds[5] - bounds[2]))/2.0f;
+    GLfloat distance = -(lodModelview[2]*x + lodModelview[6]*y + lodModelview[10]*z + lodModelview[14]) - halfDiagonal*lodModelScale;
+    if(distance < 0.1f)
+      distance = 0.1f; // the near clipping plane
+    pixelRadius /= distance;
+  }
+
+  const GLfloat neededSlices = 2.0f*Point3D<GLfloat>::PI*pixelRadius/lodPixelsPerSlice;
+  unsigned int level = 0;
+  while(level + 1 < numLODLevels && static_cast<GLfloat>(lodSlices[level + 1]) >= neededSlices)
+    level++;
+  return level;
+}
+
 ///// selectEntity ////////////////////////////////////////////////////////////
 void GLSimpleMoleculeView::selectEntity(const QPoint position)
 /// Selects the entity (atom, bond, etc.) pointed to by the mouse position.
+/// The mouse position is converted to a ray in molecule coordinates which is
+/// intersected with the atoms (found through the spatial index of the AtomSet),
+/// the bonds (found through bondIndex) and the forces. Nothing needs to be
+/// redrawn to find the selected entity.
 {
   makeCurrent();
-  ///// needed storage
-  const unsigned int BUFFER_SIZE = 64;
-  GLuint selectionBuffer[BUFFER_SIZE]; // selection buffer
-  GLuint* pBuffer = selectionBuffer;
-  GLint viewport[4]; // viewport
-
-  ///// get the selections
-  glSelectBuffer(BUFFER_SIZE, pBuffer); // set up the selection buffer
-  glGetIntegerv(GL_VIEWPORT, viewport); // get the viewport
-  glMatrixMode(GL_PROJECTION); // set projection mode
-  glPushMatrix(); // save the matrix
-  glRenderMode(GL_SELECT); // set selection mode
-  glLoadIdentity();
-  GLint xPosition = position.x();
-  GLint yPosition = viewport[3] - position.y();
-  gluPickMatrix(xPosition, yPosition, 2, 2, viewport); // set up a viewport of 2 pixels wide around the mouse position
-  setPerspective(); // calls gluPerspective or glOrtho depending on the prespective setting
-  glMatrixMode(GL_MODELVIEW);
+  GLdouble modelview[16];
+  GLdouble projection[16];
+  GLint viewport[4];
 
-  if(moleculeStyle == None || moleculeStyle == Lines)
+  ///// set up the modelview matrix to be the same as in drawScene
+  Vector3D<float> axis;
+  float angle;
+  orientationQuaternion->getAxisAngle(axis, angle);
+  glPushMatrix();
+  glTranslatef(xPos, yPos, 0.0f);
+  glRotatef(angle, axis.x(), axis.y(), axis.z());
+  if(scaleFactor < 1.0f)
+    glScalef(scaleFactor, scaleFactor, scaleFactor);
+  glTranslatef(-centerX, -centerY, -centerZ);
+  glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+  glPopMatrix();
+  glGetDoublev(GL_PROJECTION_MATRIX, projection);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  ///// map the mouse position to the near and far clipping planes
+  const GLdouble xWindow = static_cast<GLdouble>(position.x());
+  const GLdouble yWindow = static_cast<GLdouble>(viewport[3] - position.y());
+  GLdouble xNear, yNear, zNear, xFar, yFar, zFar;
+  if(gluUnProject(xWindow, yWindow, 0.0, modelview, projection, viewport, &xNear, &yNear, &zNear) == GL_FALSE ||
+     gluUnProject(xWindow, yWindow, 1.0, modelview, projection, viewport, &xFar, &yFar, &zFar) == GL_FALSE)
+    return;
+  const Point3D<double> origin(xNear, yNear, zNear);
+  Vector3D<double> direction(xFar - xNear, yFar - yNear, zFar - zNear);
+  if(direction.length() < Point3D<double>::TOLERANCE)
+    return;
+  direction.normalize();
+
+  ///// None and Lines are picked as Tubes
+  unsigned int style = moleculeStyle;
+  if(style == None || style == Lines)
+    style = Tubes;
+
+  ///// find the closest atom hit by the ray
+  unsigned int id = 0;
+  double closest = 0.0;
+  const double* xCoords = atoms->xData();
+  const double* yCoords = atoms->yData();
+  const double* zCoords = atoms->zData();
+  const unsigned char* elements = atoms->elementData();
+  if(!largestElementValid || largestElementRevision != atoms->revision())
   {
-    ///// temporarily change to a tubes representation to be able to get the selections
-    unsigned int oldStyle = moleculeStyle;
-    moleculeStyle = Tubes;
-    updateGL();
-    moleculeStyle = oldStyle;
+    ///// the radius of an atom increases with its van der Waals radius in all styles
+    largestElement = 0;
+    for(unsigned int i = 0; i < atoms->count(); i++)
+    {
+      if(i == 0 || AtomSet::vanderWaals(elements[i]) > AtomSet::vanderWaals(largestElement))
+        largestElement = elements[i];
+    }
+    largestElementValid = true;
+    largestElementRevision = atoms->revision();
+  }
+  const vector<unsigned int> candidates = atoms->atomsAlongRay(origin, direction, atomRadius(largestElement, style));
+  for(vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+  {
+    ///// solve |origin + t*direction - center|^2 = radius^2 for the nearest t
+    const double dx = xCoords[*it] - origin.x();
+    const double dy = yCoords[*it] - origin.y();
+    const double dz = zCoords[*it] - origin.z();
+    const double radius = atomRadius(elements[*it], style);
+    const double b = dx*direction.x() + dy*direction.y() + dz*direction.z();
+    const double discriminant = b*b - (dx*dx + dy*dy + dz*dz) + radius*radius;
+    if(discriminant < 0.0 || b + sqrt(discriminant) < 0.0) // missed or behind the near plane
+      continue;
+    const double t = b - sqrt(discriminant);
+    if(id == 0 || t < closest)
+    {
+      id = START_ATOMS + *it;
+      closest = t;
+    }
   }
-  else
-    updateGL(); // just draw the scene
 
-  ///// generate the selection
-  GLint hits = glRenderMode(GL_RENDER);
+  ///// check whether a bond is hit in front of the closest atom
+  if(style != VanDerWaals)
+  {
+    updateBondCache();
+    if(!bondIndex->isValid())
+    {
+      ///// index the midpoints of the bonds
+      vector<Point3D<double> > midpoints;
+      midpoints.reserve(bondAtoms.size()/2);
+      bondIndexReach = 0.0;
+      for(unsigned int i = 0; i < bondAtoms.size(); i += 2)
+      {
+        const unsigned int atom1 = bondAtoms[i];
+        const unsigned int atom2 = bondAtoms[i + 1];
+        midpoints.push_back(Point3D<double>((xCoords[atom1] + xCoords[atom2])/2.0, (yCoords[atom1] + yCoords[atom2])/2.0, (zCoords[atom1] + zCoords[atom2])/2.0));
+        const double halfLength = sqrt((xCoords[atom2] - xCoords[atom1])*(xCoords[atom2] - xCoords[atom1]) + (yCoords[atom2] - yCoords[atom1])*(yCoords[atom2] - yCoords[atom1])
+                                       + (zCoords[atom2] - zCoords[atom1])*(zCoords[atom2] - zCoords[atom1]))/2.0;
+        if(halfLength > bondIndexReach)
+          bondIndexReach = halfLength;
+      }
+      bondIndex->build(midpoints);
+    }
 
-  ///// restore the original view
-  glMatrixMode(GL_PROJECTION);
-  glPopMatrix();
-  glMatrixMode(GL_MODELVIEW);
+    ///// a bond within bondRadius of the ray has its midpoint within bondRadius + bondIndexReach
+    const double bondRadius = moleculeParameters.sizeBonds;
+    const vector<unsigned int> bondCandidates = bondIndex->alongRay(origin, direction, bondRadius + bondIndexReach);
+    for(vector<unsigned int>::const_iterator it = bondCandidates.begin(); it != bondCandidates.end(); it++)
+    {
+      const unsigned int atom1 = bondAtoms[2*(*it)];
+      const unsigned int atom2 = bondAtoms[2*(*it) + 1];
+      double t;
+      if(rayHitsSegment(origin, direction, Point3D<double>(xCoords[atom1], yCoords[atom1], zCoords[atom1]),
+                        Point3D<double>(xCoords[atom2], yCoords[atom2], zCoords[atom2]), bondRadius, t) && (id == 0 || t < closest))
+      {
+        id = START_BONDS;
+        closest = t;
+      }
+    }
+  }
+
+  ///// check whether a force is hit in front of the closest atom or bond. The
+  ///// forces can be of any length and are only drawn below the fast rendering
+  ///// limit, so all of them are checked. Lines are picked as Tubes.
+  if(forcesStyle != None && atoms->hasForces() && atoms->count() <= moleculeParameters.fastRenderLimit)
+  {
+    const double forceRadius = 1.2*moleculeParameters.sizeForces; // the head of the arrow
+    for(unsigned int i = 0; i < atoms->count(); i++)
+    {
+      const double dx = atoms->dx(i);
+      const double dy = atoms->dy(i);
+      const double dz = atoms->dz(i);
+      if(sqrt(dx*dx + dy*dy + dz*dz) < 0.1/forceScale)
+        continue; // not drawn
+      double t;
+      if(rayHitsSegment(origin, direction, Point3D<double>(xCoords[i], yCoords[i], zCoords[i]),
+                        Point3D<double>(xCoords[i] + dx*forceScale/2.0, yCoords[i] + dy*forceScale/2.0, zCoords[i] + dz*forceScale/2.0), forceRadius, t)
+         && (id == 0 || t < closest))
+      {
+        id = START_FORCES;
+        closest = t;
+      }
+    }
+  }
 
   ///// process the selection
-  if(hits != 0)
+  if(id != 0)
   {
-    pBuffer++; // GLuint count = *pBuffer++; // the number of names in the buffer
-    pBuffer++; // GLuint minz = *pBuffer++; // minimum z-value of selection
-    pBuffer++; // GLuint maxz = *pBuffer++; // maximum z-value of selection
-    GLuint id = *pBuffer; // the id of the first selection
-    //qDebug("Number of selections: %d", count);
-    //qDebug("ID of first selection: %d", id);
     processSelection(id);
     updateGL();
   }
   emit changed();
 }
 
+///// rayHitsSegment //////////////////////////////////////////////////////////
+bool GLSimpleMoleculeView::rayHitsSegment(const Point3D<double>& origin, const Vector3D<double>& direction, const Point3D<double>& start, const Point3D<double>& end, const double radius, double& distance) const
+/// Returns whether the ray starting at origin along the normalized direction
+/// passes within radius of the segment from start to end in front of the
+/// origin. If so, distance is set to the distance along the ray of the point
+/// closest to the segment.
+{
+  const double ux = end.x() - start.x();
+  const double uy = end.y() - start.y();
+  const double uz = end.z() - start.z();
+  const double wx = start.x() - origin.x();
+  const double wy = start.y() - origin.y();
+  const double wz = start.z() - origin.z();
+  const double uu = ux*ux + uy*uy + uz*uz;
+  const double ud = ux*direction.x() + uy*direction.y() + uz*direction.z();
+  const double uw = ux*wx + uy*wy + uz*wz;
+  const double dw = direction.x()*wx + direction.y()*wy + direction.z()*wz;
+  const double denominator = uu - ud*ud;
+  double s = denominator > Point3D<double>::TOLERANCE ? (ud*dw - uw)/denominator : 0.0;
+  if(s < 0.0)
+    s = 0.0;
+  else if(s > 1.0)
+    s = 1.0;
+  const double t = dw + s*ud;
+  const double px = wx + s*ux - t*direction.x();
+  const double py = wy + s*uy - t*direction.y();
+  const double pz = wz + s*uz - t*direction.z();
+  if(t < 0.0 || px*px + py*py + pz*pz > radius*radius)
+    return false;
+  distance = t;
+  return true;
+}
+
 ///// processSelection ////////////////////////////////////////////////////////
 void GLSimpleMoleculeView::processSelection(const unsigned int id)
 /// Changes the selection according to the change in
@@ -705,26 +1005,29 @@ void GLSimpleMoleculeView::centerMolecule()
     return;
 
   ///// determine maxima & minima
-  double maxx = atoms->x(0);
-  double maxy = atoms->y(0);
-  double maxz = atoms->z(0);
+  const double* xCoords = atoms->xData();
+  const double* yCoords = atoms->yData();
+  const double* zCoords = atoms->zData();
+  double maxx = xCoords[0];
+  double maxy = yCoords[0];
+  double maxz = zCoords[0];
   double minx = maxx;
   double miny = maxy;
   double minz = maxz;
   for(unsigned int i = 1; i < atoms->count(); i++)
   {
-    if(atoms->x(i) > maxx)
-      maxx = atoms->x(i);
-    else if(atoms->x(i) < minx)
-      minx = atoms->x(i);
-    if(atoms->y(i) > maxy)
-      maxy = atoms->y(i);
-    else if(atoms->y(i) < miny)
-      miny = atoms->y(i);
-    if(atoms->z(i) > maxz)
-      maxz = atoms->z(i);
-    else if(atoms->z(i) < minz)
-      minz = atoms->z(i);
+    if(xCoords[i] > maxx)
+      maxx = xCoords[i];
+    else if(xCoords[i] < minx)
+      minx = xCoords[i];
+    if(yCoords[i] > maxy)
+      maxy = yCoords[i];
+    else if(yCoords[i] < miny)
+      miny = yCoords[i];
+    if(zCoords[i] > maxz)
+      maxz = zCoords[i];
+    else if(zCoords[i] < minz)
+      minz = zCoords[i];
   }
   ///// calculate the new centers
   centerX = static_cast<GLfloat>((maxx + minx)/2.0);
@@ -745,67 +1048,62 @@ void GLSimpleMoleculeView::drawScene()
     glScalef(scaleFactor, scaleFactor, scaleFactor);
 
   glTranslatef(-centerX, -centerY, -centerZ); // center the molecule
+  updateFrustum(); // for culling in molecule coordinates
+  updateLODParameters();
 
-  glInitNames();
-  glPushName(0);
-
-  ///// switch to fast rendering if the number of atoms is too large
-  unsigned int oldMoleculeStyle = moleculeStyle;
+  ///// switch to fast rendering if the number of atoms is too large. The atoms
+  ///// and bonds keep their style and are drawn at the lowest level of detail
+  ///// (see lodLevel), only the forces and labels are left out.
   unsigned int oldForcesStyle = forcesStyle;
   bool oldShowElements = showElements;
   bool oldShowNumbers = showNumbers;
   unsigned int oldChargeType = chargeType;
   if(atoms->count() > moleculeParameters.fastRenderLimit)
   {
-    moleculeStyle = Lines;
     forcesStyle = None;
     showElements = false;
     showNumbers = false;
     chargeType = AtomSet::None;
   }
 
-  bool usedBlending = false;
-  ///// draw all shapes in order of decreasing opacity
-  for(unsigned int i = 0; i < shapes.size(); i++)
+  ///// draw the opaque shapes (the shapes are ordered by decreasing opacity)
+  unsigned int firstTransparent = 0;
+  while(firstTransparent < shapes.size() && shapes[firstTransparent].opacity >= 100)
+    drawShape(firstTransparent++);
+
+  ///// draw the transparent shapes
+  if(firstTransparent < shapes.size())
   {
-    ///// switch to blending for the first opacity < 100
-    if(!usedBlending && shapes[i].opacity < 100)
+    if(beginTransparency())
     {
-      usedBlending = true;
-      glEnable(GL_BLEND);
+      ///// order independent: the opaque shapes are needed for the depth
+      beginTransparencyPass(TRANSPARENCY_DEPTH);
+      for(unsigned int i = 0; i < firstTransparent; i++)
+      {
+        if(shapes[i].type != SHAPE_LABELS && shapes[i].type != SHAPE_IC)
+          drawShape(i);
+      }
+      beginTransparencyPass(TRANSPARENCY_ACCUMULATE);
+      for(unsigned int i = firstTransparent; i < shapes.size(); i++)
+        drawShape(i);
+      beginTransparencyPass(TRANSPARENCY_REVEALAGE);
+      for(unsigned int i = firstTransparent; i < shapes.size(); i++)
+        drawShape(i);
+      endTransparency();
     }
-    switch(shapes[i].type)
+    else
     {
-      case SHAPE_ATOMS:
-        drawAtoms();
-        break;
-      case SHAPE_BONDS:
-        drawBonds();
-        break;
-      case SHAPE_FORCES:
-        drawForces();
-        break;
-      case SHAPE_LABELS:
-        drawLabels();
-        break;
-      case SHAPE_IC:
-        drawICValue();
-        break;
-      case SHAPE_SELECTION:
-        drawSelections();
-        break;
-      default:
-        //qDebug("about to call drawItem(%d)",i);
-        drawItem(i);
+      ///// blending in order of decreasing opacity
+      glEnable(GL_BLEND);
+      for(unsigned int i = firstTransparent; i < shapes.size(); i++)
+        drawShape(i);
+      glDisable(GL_BLEND);
     }
   }
-  if(usedBlending)
-    glDisable(GL_BLEND);
 
   ///// restore the old settings in case of fast rendering
   if(atoms->count() > moleculeParameters.fastRenderLimit)
   {
-    moleculeStyle = oldMoleculeStyle;
     forcesStyle = oldForcesStyle;
     showElements = oldShowElements;
     showNumbers = oldShowNumbers;
@@ -813,6 +1111,44 @@ void GLSimpleMoleculeView::drawScene()
   }
 }
 
+///// drawShape ///////////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::drawShape(const unsigned int index)
+/// Draws the shape shapes[index].
+{
+  switch(shapes[index].type)
+  {
+    case SHAPE_ATOMS:
+      startTiming(TIMING_ATOMS);
+      drawAtoms();
+      stopTiming(TIMING_ATOMS);
+      break;
+    case SHAPE_BONDS:
+      startTiming(TIMING_BONDS);
+      drawBonds();
+      stopTiming(TIMING_BONDS);
+      break;
+    case SHAPE_FORCES:
+      drawForces();
+      break;
+    case SHAPE_LABELS:
+      startTiming(TIMING_LABELS);
+      drawLabels();
+      stopTiming(TIMING_LABELS);
+      break;
+    case SHAPE_IC:
+      drawICValue();
+      break;
+    case SHAPE_SELECTION:
+      drawSelections();
+      break;
+    default:
+      //qDebug("about to call drawItem(%d)",index);
+      startTiming(TIMING_SURFACES); // the only items at the moment
+      drawItem(index);
+      stopTiming(TIMING_SURFACES);
+  }
+}
+
 ///// drawAtoms ///////////////////////////////////////////////////////////////
 void GLSimpleMoleculeView::drawAtoms()
 /// Draws the atoms in the OpenGL scene.
@@ -821,34 +1157,48 @@ void GLSimpleMoleculeView::drawAtoms()
   if(moleculeStyle == None || moleculeStyle == Lines)
     return;
 
-  for(unsigned int i = 0; i < atoms->count(); i++)
+  ///// the atoms are drawn from display lists per chunk that are only
+  ///// recompiled when the atoms or their representation change
+  if(!atomBatchValid || atomBatchRevision != atoms->revision() || atomBatchStyle != moleculeStyle)
+    buildAtomBatch();
+
+  ///// only the chunks inside the view are drawn
+  vector<unsigned int> ranges;
+  visibleChunks(atomChunkBounds, ranges);
+
+  if(!impostorVertices.empty())
   {
-    glPushMatrix(); // save the current matrix
-    qglColor(atoms->color(i)); // set the color (works cos of glColorMaterial)
-    glTranslatef(atoms->x(i), atoms->y(i), atoms->z(i)); // set the position
-    if(moleculeStyle == Tubes)
-    {
-      glScalef(moleculeParameters.sizeBonds,
-               moleculeParameters.sizeBonds,
-               moleculeParameters.sizeBonds);
-    }
-    else if(moleculeStyle == BallAndStick)
+    const unsigned int numAtoms = impostorVertices.size()/12;
+    impostorProgram->bind();
+    impostorProgram->setUniformValue("depthCue", baseParameters.depthCue);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &impostorVertices[0]);
+    glTexCoordPointer(3, GL_FLOAT, 0, &impostorCorners[0]);
+    glColorPointer(3, GL_UNSIGNED_BYTE, 0, &impostorColors[0]);
+    for(unsigned int i = 0; i < ranges.size(); i += 2)
     {
-      glScalef(AtomSet::vanderWaals(atoms->atomicNumber(i))/2.0f,
-               AtomSet::vanderWaals(atoms->atomicNumber(i))/2.0f,
-               AtomSet::vanderWaals(atoms->atomicNumber(i))/2.0f);
+      const unsigned int first = ranges[i]*chunkSize;
+      const unsigned int last = std::min(ranges[i + 1]*chunkSize, numAtoms);
+      glDrawArrays(GL_QUADS, 4*first, 4*(last - first));
     }
-    else if(moleculeStyle == VanDerWaals)
-    {
-      glScalef(AtomSet::vanderWaals(atoms->atomicNumber(i))*1.5f,
-               AtomSet::vanderWaals(atoms->atomicNumber(i))*1.5f,
-               AtomSet::vanderWaals(atoms->atomicNumber(i))*1.5f);
-    }
-    glLoadName(START_ATOMS+i);
-    glCallList(atomObject); // make the atom
-    glPopMatrix(); // restore the matrix
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    impostorProgram->release();
+  }
+  else
+  {
+    ///// the chunks call their sphere relative to the list base
+    for(unsigned int i = 0; i < ranges.size(); i += 2)
+      for(unsigned int chunk = ranges[i]; chunk < ranges[i + 1]; chunk++)
+      {
+        glListBase(atomLODObjects + lodLevel(&atomChunkBounds[6*chunk], atomChunkRadii[chunk]));
+        glCallList(atomChunkLists + chunk);
+      }
+    glListBase(0);
   }
-  glLoadName(START_BONDS); // just to make sure the following items do not get the same name as the last atom
 }
 
 ///// drawBonds ///////////////////////////////////////////////////////////////
@@ -861,139 +1211,582 @@ void GLSimpleMoleculeView::drawBonds()
   if(moleculeStyle == None || moleculeStyle == VanDerWaals)
     return;
 
-  float distance, distanceXY, x1, x2, y1, y2, z1, z2, phi, theta;
-  vector<unsigned int>* firstAtom;
-  vector<unsigned int>* secondAtom;
-  atoms->bonds(firstAtom, secondAtom); // assigns both pointers
-
   if(moleculeStyle == Lines)
   {
+    ///// draw the visible chunks of lines from the cached vertex arrays
+    updateBondCache();
     glLineWidth(moleculeParameters.sizeLines);
     glDisable(GL_LIGHTING);
-    glBegin(GL_LINES);
-      for(unsigned int i = 0; i < firstAtom->size(); i++)
-      {
-        const unsigned int atom1 = firstAtom->operator[](i);
-        const unsigned int atom2 = secondAtom->operator[](i);
-        if(atoms->color(atom1) == atoms->color(atom2))
-        {
-          ///// the bond has one color
-          qglColor(atoms->color(atom1));
-          glVertex3d(atoms->x(atom1), atoms->y(atom1), atoms->z(atom1));
-          glVertex3d(atoms->x(atom2), atoms->y(atom2), atoms->z(atom2));
-        }
-        else
-        {
-          ///// 2 half-bonds
-          const double midX = (atoms->x(atom1) + atoms->x(atom2))/2.0;
-          const double midY = (atoms->y(atom1) + atoms->y(atom2))/2.0;
-          const double midZ = (atoms->z(atom1) + atoms->z(atom2))/2.0;
-          qglColor(atoms->color(atom1));
-          glVertex3d(atoms->x(atom1), atoms->y(atom1), atoms->z(atom1));
-          glVertex3d(midX, midY, midZ);
-
-          qglColor(atoms->color(atom2));
-          glVertex3d(midX, midY, midZ);
-          glVertex3d(atoms->x(atom2), atoms->y(atom2), atoms->z(atom2));
-        }
-      }
-    glEnd();
+    if(!bondLineVertices.empty())
+    {
+      vector<unsigned int> ranges;
+      visibleChunks(bondChunkBounds, ranges);
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glEnableClientState(GL_COLOR_ARRAY);
+      glVertexPointer(3, GL_FLOAT, 0, &bondLineVertices[0]);
+      glColorPointer(3, GL_UNSIGNED_BYTE, 0, &bondLineColors[0]);
+      for(unsigned int i = 0; i < ranges.size(); i += 2)
+        glDrawArrays(GL_LINES, bondLineChunkStarts[ranges[i]], bondLineChunkStarts[ranges[i + 1]] - bondLineChunkStarts[ranges[i]]);
+      glDisableClientState(GL_COLOR_ARRAY);
+      glDisableClientState(GL_VERTEX_ARRAY);
+    }
     glEnable(GL_LIGHTING);
     return;
   }
 
   ///// here moleculeStyle is either DisplayStyle::Tubes or DisplayStyle::BallAndStick
-  ///// which are rendered in the same way
-  for(unsigned int i = 0; i < firstAtom->size(); i++)
+  ///// which are rendered in the same way from display lists per chunk
+  if(!bondBatchValid || bondBatchRevision != atoms->revision())
+    buildBondBatch();
+  vector<unsigned int> ranges;
+  visibleChunks(bondChunkBounds, ranges);
+  for(unsigned int i = 0; i < ranges.size(); i += 2)
+    for(unsigned int chunk = ranges[i]; chunk < ranges[i + 1]; chunk++)
+    {
+      glListBase(bondLODObjects + lodLevel(&bondChunkBounds[6*chunk], moleculeParameters.sizeBonds));
+      glCallList(bondChunkLists + chunk);
+    }
+  glListBase(0);
+}
+
+///// buildAtomBatch //////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::buildAtomBatch()
+/// Compiles the atoms into display lists of chunkSize consecutive atoms. The
+/// position and radius of each atom are determined once and stored in
+/// atomInstances, so the per-frame cost of drawing the atoms is a glCallList
+/// per visible chunk. The bounding box of each chunk is kept in
+/// atomChunkBounds. The sphere itself is called relative to the list base,
+/// so drawAtoms can choose its level of detail per chunk and a change in
+/// quality doesn't need a recompile.
+{
+  const unsigned int numAtoms = atoms->count();
+  const double* xCoords = atoms->xData();
+  const double* yCoords = atoms->yData();
+  const double* zCoords = atoms->zData();
+  const unsigned char* elements = atoms->elementData();
+  const unsigned int* colors = atoms->colorData();
+
+  ///// pack the instance data
+  atomInstances.resize(4*numAtoms);
+  for(unsigned int i = 0; i < numAtoms; i++)
   {
-    ///// add the bond between atoms firstAtom[i] and secondAtom[i]
-    const unsigned int atom1 = firstAtom->operator[](i);
-    const unsigned int atom2 = secondAtom->operator[](i);
+    atomInstances[4*i]     = static_cast<GLfloat>(xCoords[i]);
+    atomInstances[4*i + 1] = static_cast<GLfloat>(yCoords[i]);
+    atomInstances[4*i + 2] = static_cast<GLfloat>(zCoords[i]);
+    atomInstances[4*i + 3] = atomRadius(elements[i], moleculeStyle);
+  }
 
-    x1 = static_cast<float>(atoms->x(atom1));
-    x2 = static_cast<float>(atoms->x(atom2));
-    y1 = static_cast<float>(atoms->y(atom1));
-    y2 = static_cast<float>(atoms->y(atom2));
-    z1 = static_cast<float>(atoms->z(atom1));
-    z2 = static_cast<float>(atoms->z(atom2));
-    distanceXY = sqrt((x1 - x2)*(x1 - x2) + (y1 - y2)*(y1 - y2));
-    distance = sqrt((x1 - x2)*(x1 - x2) + (y1 - y2)*(y1 - y2) + (z1 - z2)*(z1 - z2));
-    if(distance < 0.01f)
-      continue; //no need to draw those small bonds
+  ///// compile the display lists and determine the bounds of the chunks
+  const unsigned int numChunks = (numAtoms + chunkSize - 1)/chunkSize;
+  resizeChunkLists(atomChunkLists, numAtomChunkLists, numChunks);
+  atomChunkBounds.resize(6*numChunks);
+  atomChunkRadii.assign(numChunks, 0.0f);
+  for(unsigned int chunk = 0; chunk < numChunks; chunk++)
+  {
+    GLfloat* bounds = &atomChunkBounds[6*chunk];
+    glNewList(atomChunkLists + chunk, GL_COMPILE);
+    for(unsigned int i = chunk*chunkSize; i < std::min((chunk + 1)*chunkSize, numAtoms); i++)
+    {
+      const GLfloat* instance = &atomInstances[4*i];
+      glPushMatrix(); // save the current matrix
+      glColor3ub(qRed(colors[i]), qGreen(colors[i]), qBlue(colors[i])); // set the color (works cos of glColorMaterial)
+      glTranslatef(instance[0], instance[1], instance[2]); // set the position
+      glScalef(instance[3], instance[3], instance[3]);
+      glCallLists(1, GL_UNSIGNED_BYTE, &lodListOffset); // make the atom
+      glPopMatrix(); // restore the matrix
+      atomChunkRadii[chunk] = std::max(atomChunkRadii[chunk], instance[3]);
+
+      for(unsigned int j = 0; j < 3; j++)
+      {
+        if(i == chunk*chunkSize || instance[j] - instance[3] < bounds[j])
+          bounds[j] = instance[j] - instance[3];
+        if(i == chunk*chunkSize || instance[j] + instance[3] > bounds[j + 3])
+          bounds[j + 3] = instance[j] + instance[3];
+      }
+    }
+    glEndList();
+  }
 
-    glPushMatrix();
+  buildImpostors();
 
-    ///// TRANSLATE
-    glTranslatef(x1, y1, z1);
+  atomBatchValid = true;
+  atomBatchRevision = atoms->revision();
+  atomBatchStyle = moleculeStyle;
+}
 
-    ///// ROTATE
-    ///// determine PHI rotation angle (around y-axis)
-    phi = acos((z2 - z1)/distance);
-    ///// determine THETA rotation angle (around z-axis)
-    if(distanceXY <= 0.0f)
-      theta = 0.0f;
-    else
+///// atomRadius //////////////////////////////////////////////////////////////
+GLfloat GLSimpleMoleculeView::atomRadius(const unsigned int element, const unsigned int style) const
+/// Returns the radius with which an atom of the given element is drawn in
+/// the given style.
+{
+  if(style == Tubes)
+    return moleculeParameters.sizeBonds;
+  else if(style == BallAndStick)
+    return AtomSet::vanderWaals(element)/2.0f;
+  else
+    return AtomSet::vanderWaals(element)*1.5f;
+}
+
+///// buildImpostors //////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::buildImpostors()
+/// Fills the vertex arrays for drawing the atoms as ray-cast sprites from
+/// atomInstances. Each atom becomes a single quad of which the corners all
+/// hold the center of the atom. The vertex shader moves the corners outwards
+/// in screen space and the fragment shader calculates the depth and normal of
+/// the sphere per pixel. The arrays are left empty if the sprites are not used.
+{
+  impostorVertices.clear();
+  impostorCorners.clear();
+  impostorColors.clear();
+  if(!useImpostors())
+    return;
+
+  const unsigned int numAtoms = atomInstances.size()/4;
+  const unsigned int* colors = atoms->colorData();
+  const GLfloat cornerX[] = {-1.0f, 1.0f, 1.0f, -1.0f};
+  const GLfloat cornerY[] = {-1.0f, -1.0f, 1.0f, 1.0f};
+  impostorVertices.reserve(12*numAtoms);
+  impostorCorners.reserve(12*numAtoms);
+  impostorColors.reserve(12*numAtoms);
+  for(unsigned int i = 0; i < numAtoms; i++)
+  {
+    const GLfloat* instance = &atomInstances[4*i];
+    for(unsigned int corner = 0; corner < 4; corner++)
     {
-      theta = acos((x2 - x1)/distanceXY);
-      if(y2 < y1)
-        theta = 2.0f*Point3D<float>::PI - theta;
+      impostorVertices.push_back(instance[0]);
+      impostorVertices.push_back(instance[1]);
+      impostorVertices.push_back(instance[2]);
+      impostorCorners.push_back(cornerX[corner]);
+      impostorCorners.push_back(cornerY[corner]);
+      impostorCorners.push_back(instance[3]);
+      impostorColors.push_back(static_cast<GLubyte>(qRed(colors[i])));
+      impostorColors.push_back(static_cast<GLubyte>(qGreen(colors[i])));
+      impostorColors.push_back(static_cast<GLubyte>(qBlue(colors[i])));
     }
-    ///// convert them to degrees
-    phi *= Point3D<float>::RADTODEG;
-    theta *= Point3D<float>::RADTODEG;
-    glRotatef(theta, 0.0f, 0.0f, 1.0f);
-    glRotatef(phi, 0.0f, 1.0f, 0.0f);
+  }
+}
+
+///// useImpostors ////////////////////////////////////////////////////////////
+bool GLSimpleMoleculeView::useImpostors() const
+/// Returns whether the atoms should be drawn as ray-cast sprites. This needs
+/// the preference to be set and working shaders.
+{
+  return moleculeParameters.impostorSpheres && impostorProgram != 0;
+}
 
-    /////SCALE
-    float scaleFactor = 1.0f;
-    if(atoms->color(atom1) != atoms->color(atom2))
-      scaleFactor = 2.0f;
-    glScalef(moleculeParameters.sizeBonds, moleculeParameters.sizeBonds, distance/(scaleFactor*cylinderHeight));
+///// buildBondBatch //////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::buildBondBatch()
+/// Compiles the bonds into display lists of chunkSize consecutive bonds for the
+/// Tubes and BallAndStick styles using the cached bond transformations. Like
+/// the atoms, the cylinders are called relative to the list base.
+{
+  updateBondCache();
+  const unsigned int* colors = atoms->colorData();
+  const unsigned int numBonds = bondTwoColors.size();
+  const unsigned int numChunks = bondChunkBounds.size()/6;
 
-    if(atoms->color(atom1) == atoms->color(atom2))
+  resizeChunkLists(bondChunkLists, numBondChunkLists, numChunks);
+  for(unsigned int i = 0; i < numBonds; i++)
+  {
+    if(i % chunkSize == 0)
     {
-      ///// the bond has one color
-      qglColor(atoms->color(atom1));
-      glCallList(bondObject);
+      if(i != 0)
+        glEndList();
+      glNewList(bondChunkLists + i/chunkSize, GL_COMPILE);
     }
-    else
+
+    const unsigned int color1 = colors[bondAtoms[2*i]];
+    glPushMatrix();
+    glMultMatrixf(&bondTransforms[16*i]);
+    glScalef(moleculeParameters.sizeBonds, moleculeParameters.sizeBonds, bondTwoColors[i] ? 0.5f : 1.0f);
+    glColor3ub(qRed(color1), qGreen(color1), qBlue(color1));
+    glCallLists(1, GL_UNSIGNED_BYTE, &lodListOffset);
+    if(bondTwoColors[i])
     {
-      ///// the bond has two colors
-      //// make firstAtom's part of bond
-      qglColor(atoms->color(atom1));
-      glCallList(bondObject);
       ///// make secondAtom's part of bond
-      qglColor(atoms->color(atom2));
+      const unsigned int color2 = colors[bondAtoms[2*i + 1]];
+      glColor3ub(qRed(color2), qGreen(color2), qBlue(color2));
       glTranslatef(0.0f, 0.0f, cylinderHeight);
-      glCallList(bondObject);
+      glCallLists(1, GL_UNSIGNED_BYTE, &lodListOffset);
     }
     glPopMatrix();
   }
+  if(numBonds != 0)
+    glEndList();
+
+  bondBatchValid = true;
+  bondBatchRevision = atoms->revision();
+}
+
+///// updateBondCache /////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::updateBondCache()
+/// Recalculates the per-bond data when the atoms changed since the last call:
+/// the transformation of the bond cylinder, whether the bond has 2 colors and
+/// the vertices for the Lines style. Redrawing the same geometry (e.g. when
+/// rotating the view) thus doesn't do any per-bond math.
+{
+  if(bondCacheValid && bondCacheRevision == atoms->revision())
+    return;
+
+  vector<unsigned int>* firstAtom;
+  vector<unsigned int>* secondAtom;
+  atoms->bonds(firstAtom, secondAtom); // assigns both pointers
+  const double* xCoords = atoms->xData();
+  const double* yCoords = atoms->yData();
+  const double* zCoords = atoms->zData();
+  const unsigned int* colors = atoms->colorData();
+  const unsigned int numBonds = firstAtom->size();
+
+  bondAtoms.clear();
+  bondTransforms.clear();
+  bondTwoColors.clear();
+  bondLineVertices.clear();
+  bondLineColors.clear();
+  bondAtoms.reserve(2*numBonds);
+  bondTransforms.reserve(16*numBonds);
+  bondTwoColors.reserve(numBonds);
+  bondLineVertices.reserve(12*numBonds);
+  bondLineColors.reserve(12*numBonds);
+  bondLineChunkStarts.clear();
+  bondChunkBounds.clear();
+  const GLfloat radius = moleculeParameters.sizeBonds;
+
+  for(unsigned int i = 0; i < numBonds; i++)
+  {
+    const unsigned int atom1 = firstAtom->operator[](i);
+    const unsigned int atom2 = secondAtom->operator[](i);
+    const GLfloat x1 = static_cast<GLfloat>(xCoords[atom1]);
+    const GLfloat y1 = static_cast<GLfloat>(yCoords[atom1]);
+    const GLfloat z1 = static_cast<GLfloat>(zCoords[atom1]);
+    const GLfloat x2 = static_cast<GLfloat>(xCoords[atom2]);
+    const GLfloat y2 = static_cast<GLfloat>(yCoords[atom2]);
+    const GLfloat z2 = static_cast<GLfloat>(zCoords[atom2]);
+    const bool twoColors = colors[atom1] != colors[atom2];
+    const GLfloat dx = x2 - x1;
+    const GLfloat dy = y2 - y1;
+    const GLfloat dz = z2 - z1;
+    const GLfloat distanceXY = sqrt(dx*dx + dy*dy);
+    const GLfloat distance = sqrt(dx*dx + dy*dy + dz*dz);
+    if(distance < 0.01f)
+      continue; //no need to draw those small bonds
+
+    ///// start a new chunk or extend the bounds of the current one
+    const GLfloat minimum[3] = {std::min(x1, x2) - radius, std::min(y1, y2) - radius, std::min(z1, z2) - radius};
+    const GLfloat maximum[3] = {std::max(x1, x2) + radius, std::max(y1, y2) + radius, std::max(z1, z2) + radius};
+    if(bondTwoColors.size() % chunkSize == 0)
+    {
+      bondLineChunkStarts.push_back(bondLineVertices.size()/3);
+      bondChunkBounds.insert(bondChunkBounds.end(), minimum, minimum + 3);
+      bondChunkBounds.insert(bondChunkBounds.end(), maximum, maximum + 3);
+    }
+    else
+    {
+      GLfloat* bounds = &bondChunkBounds[bondChunkBounds.size() - 6];
+      for(unsigned int j = 0; j < 3; j++)
+      {
+        bounds[j] = std::min(bounds[j], minimum[j]);
+        bounds[j + 3] = std::max(bounds[j + 3], maximum[j]);
+      }
+    }
+
+    ///// Lines style: 1 segment or 2 half-bonds
+    const GLfloat midX = (x1 + x2)/2.0f;
+    const GLfloat midY = (y1 + y2)/2.0f;
+    const GLfloat midZ = (z1 + z2)/2.0f;
+    const GLfloat lineVertices[12] = {x1, y1, z1, midX, midY, midZ, midX, midY, midZ, x2, y2, z2};
+    const GLubyte red1 = static_cast<GLubyte>(qRed(colors[atom1]));
+    const GLubyte green1 = static_cast<GLubyte>(qGreen(colors[atom1]));
+    const GLubyte blue1 = static_cast<GLubyte>(qBlue(colors[atom1]));
+    const GLubyte red2 = static_cast<GLubyte>(qRed(colors[atom2]));
+    const GLubyte green2 = static_cast<GLubyte>(qGreen(colors[atom2]));
+    const GLubyte blue2 = static_cast<GLubyte>(qBlue(colors[atom2]));
+    const GLubyte lineColors[12] = {red1, green1, blue1, red1, green1, blue1,
+                                    red2, green2, blue2, red2, green2, blue2};
+    if(twoColors)
+    {
+      bondLineVertices.insert(bondLineVertices.end(), lineVertices, lineVertices + 12);
+      bondLineColors.insert(bondLineColors.end(), lineColors, lineColors + 12);
+    }
+    else
+    {
+      bondLineVertices.insert(bondLineVertices.end(), lineVertices, lineVertices + 3);
+      bondLineVertices.insert(bondLineVertices.end(), lineVertices + 9, lineVertices + 12);
+      bondLineColors.insert(bondLineColors.end(), lineColors, lineColors + 6);
+    }
+
+    ///// Tubes and BallAndStick styles: rotate the z-axis onto the bond.
+    ///// This is the same as rotating by theta around z after phi around y,
+    ///// but the sines and cosines follow directly from the bond vector.
+    GLfloat cosTheta = 1.0f;
+    GLfloat sinTheta = 0.0f;
+    if(distanceXY > 0.0f)
+    {
+      cosTheta = dx/distanceXY;
+      sinTheta = dy/distanceXY;
+    }
+    const GLfloat cosPhi = dz/distance;
+    const GLfloat sinPhi = distanceXY/distance;
+    const GLfloat length = distance/cylinderHeight;
+    const GLfloat transform[16] = {cosTheta*cosPhi,        sinTheta*cosPhi,        -sinPhi,        0.0f,
+                                   -sinTheta,              cosTheta,               0.0f,           0.0f,
+                                   cosTheta*sinPhi*length, sinTheta*sinPhi*length, cosPhi*length,  0.0f,
+                                   x1,                     y1,                     z1,             1.0f};
+    bondTransforms.insert(bondTransforms.end(), transform, transform + 16);
+    bondAtoms.push_back(atom1);
+    bondAtoms.push_back(atom2);
+    bondTwoColors.push_back(twoColors ? 1 : 0);
+  }
+  bondLineChunkStarts.push_back(bondLineVertices.size()/3);
+  bondIndex->invalidate(); // rebuilt by selectEntity when needed
+
+  bondCacheValid = true;
+  bondCacheRevision = atoms->revision();
 }
 
 ///// drawLabels //////////////////////////////////////////////////////////////
 void GLSimpleMoleculeView::drawLabels()
-/// Draws the element types and numbers.
+/// Draws the element types and numbers. The label texts are cached and drawn
+/// as textured quads from a glyph atlas in one call. The labels are positioned
+/// in window coordinates in front of the atoms like renderText would and are
+/// depth tested against the scene. Optionally labels overlapping a label closer
+/// to the viewer are skipped.
 {
   //qDebug("calling drawLabels");
   if(!(showElements || showNumbers || chargeType != AtomSet::None))
     return;
 
-  // determine the amount of backrotation
-  Vector3D<float> axis;
-  float angle;
-  orientationQuaternion->getAxisAngle(axis, angle);
+  if(labelTexture == 0 || atlasFont != labelFont)
+    buildGlyphAtlas();
+  updateLabelCache();
+
+  ///// get the transformations
+  GLdouble modelview[16];
+  GLdouble projection[16];
+  GLint viewport[4];
+  glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+  glGetDoublev(GL_PROJECTION_MATRIX, projection);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  const double scale = sqrt(modelview[0]*modelview[0] + modelview[1]*modelview[1] + modelview[2]*modelview[2]);
+
+  ///// project the anchor of each label to window coordinates
+  const double* xCoords = atoms->xData();
+  const double* yCoords = atoms->yData();
+  const double* zCoords = atoms->zData();
+  const unsigned char* elements = atoms->elementData();
+  const int labelHeight = glyphAscent + glyphDescent + 1;
+  vector<GLfloat> anchors; // x, y and depth of each visible label
+  vector<unsigned int> visible;
+  anchors.reserve(3*atoms->count());
+  visible.reserve(atoms->count());
+  for(unsigned int i = 0; i < atoms->count(); i++)
+  {
+    ///// the label is moved towards the viewer to the front of the atom
+    const double eyeX = modelview[0]*xCoords[i] + modelview[4]*yCoords[i] + modelview[8]*zCoords[i] + modelview[12];
+    const double eyeY = modelview[1]*xCoords[i] + modelview[5]*yCoords[i] + modelview[9]*zCoords[i] + modelview[13];
+    const double eyeZ = modelview[2]*xCoords[i] + modelview[6]*yCoords[i] + modelview[10]*zCoords[i] + modelview[14]
+                        + scale*(AtomSet::vanderWaals(elements[i])/2.0 + 0.05);
+    const double clipX = projection[0]*eyeX + projection[4]*eyeY + projection[8]*eyeZ + projection[12];
+    const double clipY = projection[1]*eyeX + projection[5]*eyeY + projection[9]*eyeZ + projection[13];
+    const double clipZ = projection[2]*eyeX + projection[6]*eyeY + projection[10]*eyeZ + projection[14];
+    const double clipW = projection[3]*eyeX + projection[7]*eyeY + projection[11]*eyeZ + projection[15];
+    if(clipW <= 0.0)
+      continue;
+    const double depth = (clipZ/clipW + 1.0)/2.0;
+    const GLfloat x = floor(viewport[0] + (clipX/clipW + 1.0)*viewport[2]/2.0 + 0.5);
+    const GLfloat y = floor(viewport[1] + (clipY/clipW + 1.0)*viewport[3]/2.0 + 0.5);
+    if(depth < 0.0 || depth > 1.0 || x + labelWidths[i] < viewport[0] || x > viewport[0] + viewport[2]
+       || y + glyphAscent < viewport[1] || y - glyphDescent - 1 > viewport[1] + viewport[3])
+      continue;
+    anchors.push_back(x);
+    anchors.push_back(y);
+    anchors.push_back(static_cast<GLfloat>(depth));
+    visible.push_back(i);
+  }
+
+  ///// only keep the labels that don't overlap a label closer to the viewer
+  vector<unsigned int> order(visible.size());
+  for(unsigned int i = 0; i < order.size(); i++)
+    order[i] = i;
+  if(moleculeParameters.hideOverlappingLabels && !order.empty())
+  {
+    ///// sort by depth and keep the accepted rectangles in a coarse grid of
+    ///// cells as high as a label
+    std::vector<std::pair<GLfloat, unsigned int> > depths(order.size());
+    for(unsigned int i = 0; i < order.size(); i++)
+      depths[i] = std::make_pair(anchors[3*i + 2], i);
+    std::sort(depths.begin(), depths.end());
+    const int cellWidth = 4*labelHeight;
+    const int numColumns = viewport[2]/cellWidth + 1;
+    const int numRows = viewport[3]/labelHeight + 1;
+    vector<vector<unsigned int> > cells(numColumns*numRows);
+    order.clear();
+    for(unsigned int i = 0; i < depths.size(); i++)
+    {
+      const unsigned int label = depths[i].second;
+      const int left = static_cast<int>(anchors[3*label]) - viewport[0];
+      const int right = left + labelWidths[visible[label]];
+      const int bottom = static_cast<int>(anchors[3*label + 1]) - viewport[1] - glyphDescent - 1;
+      const int top = bottom + labelHeight;
+      const int minColumn = std::max(0, left/cellWidth);
+      const int maxColumn = std::min(numColumns - 1, right/cellWidth);
+      const int minRow = std::max(0, bottom/labelHeight);
+      const int maxRow = std::min(numRows - 1, top/labelHeight);
+      bool overlaps = false;
+      for(int row = minRow; row <= maxRow && !overlaps; row++)
+      {
+        for(int column = minColumn; column <= maxColumn && !overlaps; column++)
+        {
+          const vector<unsigned int>& cell = cells[row*numColumns + column];
+          for(vector<unsigned int>::const_iterator it = cell.begin(); it != cell.end(); it++)
+          {
+            const int otherLeft = static_cast<int>(anchors[3*(*it)]) - viewport[0];
+            const int otherBottom = static_cast<int>(anchors[3*(*it) + 1]) - viewport[1] - glyphDescent - 1;
+            if(left < otherLeft + labelWidths[visible[*it]] && otherLeft < right
+               && bottom < otherBottom + labelHeight && otherBottom < top)
+            {
+              overlaps = true;
+              break;
+            }
+          }
+        }
+      }
+      if(overlaps)
+        continue;
+      for(int row = minRow; row <= maxRow; row++)
+        for(int column = minColumn; column <= maxColumn; column++)
+          cells[row*numColumns + column].push_back(label);
+      order.push_back(label);
+    }
+  }
 
-  // set up the visuals
+  ///// generate the quads for all glyphs
+  labelVertices.clear();
+  labelTexCoords.clear();
+  for(unsigned int i = 0; i < order.size(); i++)
+  {
+    const unsigned int label = order[i];
+    const std::string& text = labelTexts[visible[label]];
+    GLfloat x = anchors[3*label];
+    const GLfloat bottom = anchors[3*label + 1] - glyphDescent - 1;
+    const GLfloat top = anchors[3*label + 1] + glyphAscent;
+    const GLfloat depth = anchors[3*label + 2];
+    for(std::string::const_iterator it = text.begin(); it != text.end(); it++)
+    {
+      const unsigned int glyph = static_cast<unsigned char>(*it) - 32;
+      if(glyph >= glyphAdvances.size())
+        continue;
+      const GLfloat* coords = &glyphCoords[4*glyph];
+      const GLfloat right = x + glyphAdvances[glyph];
+      const GLfloat vertices[12] = {x, bottom, depth, right, bottom, depth, right, top, depth, x, top, depth};
+      const GLfloat texCoords[8] = {coords[0], coords[1], coords[2], coords[1], coords[2], coords[3], coords[0], coords[3]};
+      labelVertices.insert(labelVertices.end(), vertices, vertices + 12);
+      labelTexCoords.insert(labelTexCoords.end(), texCoords, texCoords + 8);
+      x = right;
+    }
+  }
+  if(labelVertices.empty())
+    return;
+
+  ///// draw them in window coordinates with the depth in [0, 1]
+  glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  glOrtho(viewport[0], viewport[0] + viewport[2], viewport[1], viewport[1] + viewport[3], 0.0, -1.0);
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
   glDisable(GL_LIGHTING);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_FOG);
+  glEnable(GL_BLEND);
+  glEnable(GL_TEXTURE_2D);
+  glDepthMask(GL_FALSE);
+  glBindTexture(GL_TEXTURE_2D, labelTexture);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
   qglColor(moleculeParameters.colorLabels);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, &labelVertices[0]);
+  glTexCoordPointer(2, GL_FLOAT, 0, &labelTexCoords[0]);
+  glDrawArrays(GL_QUADS, 0, labelVertices.size()/3);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glPopMatrix();
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+}
+
+///// buildGlyphAtlas /////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::buildGlyphAtlas()
+/// Renders the printable ASCII characters of labelFont into a texture of
+/// 16 x 6 cells. The characters are white on a transparent background so
+/// the color of the labels can be set with glColor.
+{
+  const QFontMetrics metrics(labelFont);
+  glyphAscent = metrics.ascent();
+  glyphDescent = metrics.descent();
+  const int cellWidth = metrics.maxWidth() + 1;
+  const int cellHeight = glyphAscent + glyphDescent + 1;
+  int width = 1;
+  while(width < 16*cellWidth)
+    width *= 2;
+  int height = 1;
+  while(height < 6*cellHeight)
+    height *= 2;
+
+  ///// draw the characters
+  QImage image(width, height, QImage::Format_ARGB32);
+  image.fill(0);
+  QPainter painter(&image);
+  painter.setFont(labelFont);
+  painter.setPen(Qt::white);
+  glyphCoords.resize(4*95);
+  glyphAdvances.resize(95);
+  for(int i = 0; i < 95; i++)
+  {
+    const QChar character(i + 32);
+    const int x = (i % 16)*cellWidth;
+    const int y = (i / 16)*cellHeight;
+    painter.drawText(x, y + glyphAscent, QString(character));
+    glyphAdvances[i] = std::min(metrics.width(character), cellWidth);
+    ///// the image is flipped vertically by convertToGLFormat
+    glyphCoords[4*i]     = static_cast<GLfloat>(x)/width;
+    glyphCoords[4*i + 1] = 1.0f - static_cast<GLfloat>(y + cellHeight)/height;
+    glyphCoords[4*i + 2] = static_cast<GLfloat>(x + glyphAdvances[i])/width;
+    glyphCoords[4*i + 3] = 1.0f - static_cast<GLfloat>(y)/height;
+  }
+  painter.end();
+
+  ///// upload it
+  const QImage texture = QGLWidget::convertToGLFormat(image);
+  if(labelTexture == 0)
+    glGenTextures(1, &labelTexture);
+  glBindTexture(GL_TEXTURE_2D, labelTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.bits());
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  atlasFont = labelFont;
+  labelCacheValid = false; // the widths of the labels changed
+}
+
+///// updateLabelCache ////////////////////////////////////////////////////////
+void GLSimpleMoleculeView::updateLabelCache()
+/// Regenerates the label texts and their widths when the atoms or the
+/// contents of the labels changed since the last call.
+{
+  const unsigned int contents = (showElements ? 1 : 0) | (showNumbers ? 2 : 0) | (chargeType << 2);
+  if(labelCacheValid && labelCacheRevision == atoms->revision() && labelCacheContents == contents)
+    return;
 
-  // loop over the atoms
+  labelTexts.resize(atoms->count());
+  labelWidths.resize(atoms->count());
   for(unsigned int i = 0; i < atoms->count(); i++)
   {
-    glPushMatrix();
-    glTranslated(atoms->x(i), atoms->y(i), atoms->z(i));
-    glRotatef(-angle, axis.x(), axis.y(), axis.z()); // backrotation
     QString label;
     if(showElements)
       label = AtomSet::numToAtom(atoms->atomicNumber(i)).trimmed();
@@ -1012,12 +1805,19 @@ void GLSimpleMoleculeView::drawLabels()
       if(showElements || showNumbers)
         label += ")";
     }
-    renderText(0.0, 0.0, AtomSet::vanderWaals(atoms->atomicNumber(i))/2.0 + 0.05, label, labelFont); // the +0.05 is needed for certain crappy Windows OpenGL drivers
-    glPopMatrix();
+    labelTexts[i] = label.toLatin1().data();
+    labelWidths[i] = 0;
+    for(std::string::const_iterator it = labelTexts[i].begin(); it != labelTexts[i].end(); it++)
+    {
+      const unsigned int glyph = static_cast<unsigned char>(*it) - 32;
+      if(glyph < glyphAdvances.size())
+        labelWidths[i] += glyphAdvances[glyph];
+    }
   }
 
-  // restore the lighting
-  glEnable(GL_LIGHTING);
+  labelCacheValid = true;
+  labelCacheRevision = atoms->revision();
+  labelCacheContents = contents;
 }
 
 ///// drawForces //////////////////////////////////////////////////////////////
@@ -1030,10 +1830,6 @@ void GLSimpleMoleculeView::drawForces()
   if(forcesStyle == None || !atoms->hasForces())
     return;
 
-  // forces are scaled. A force which is considered refined by relax (< 0.0009 mdyne/A) is equal
-  // to 0.1 Angstrom.
-  const float scaleFactor = 0.1f/0.0009f;
-
   const GLfloat opacity = moleculeParameters.opacityForces/100.0f;
   if(moleculeParameters.forcesOneColor)
   {
@@ -1055,7 +1851,7 @@ void GLSimpleMoleculeView::drawForces()
     z2 = static_cast<float>(atoms->dz(i));
     distanceXY = sqrt(x2*x2 + y2*y2);
     distance = sqrt(x2*x2 + y2*y2 + z2*z2);
-    if(distance < 0.1f/scaleFactor)
+    if(distance < 0.1f/forceScale)
       continue; //no need to draw those small (refined) forces
 
     glPushMatrix(); // save the current matrix
@@ -1081,9 +1877,9 @@ void GLSimpleMoleculeView::drawForces()
     glRotatef(phi, 0.0f, 1.0f, 0.0f);
     //// SCALE
     if(forcesStyle == Lines)
-      glScalef(1.0f, 1.0f, scaleFactor*distance/(2.0f*cylinderHeight));
+      glScalef(1.0f, 1.0f, forceScale*distance/(2.0f*cylinderHeight));
     else
-      glScalef(moleculeParameters.sizeForces, moleculeParameters.sizeForces, scaleFactor*distance/(2.0f*cylinderHeight));
+      glScalef(moleculeParameters.sizeForces, moleculeParameters.sizeForces, forceScale*distance/(2.0f*cylinderHeight));
 
     if(!moleculeParameters.forcesOneColor)
     {
@@ -1093,7 +1889,6 @@ void GLSimpleMoleculeView::drawForces()
       glColor4f(red, green, blue, opacity);
     }
 
-    //glLoadName(START_FORCES);
     if(forcesStyle == Lines)
       glCallList(forceObjectLines);
     else
@@ -1316,7 +2111,6 @@ void GLSimpleMoleculeView::drawSelections()
                AtomSet::vanderWaals(atoms->atomicNumber(*it))/2.0f * 1.1f);
     }
 
-    glLoadName(START_SELECTEDATOMS);
     glCallList(atomObject); // make the atom
     glPopMatrix();
     it++;
@@ -1362,7 +2156,6 @@ void GLSimpleMoleculeView::drawSelections()
       glRotatef(phi, 0.0f, 1.0f, 0.0f);
       ///// SCALE
       glScalef(moleculeParameters.sizeBonds * 1.1f, moleculeParameters.sizeBonds * 1.1f, distance/cylinderHeight);
-      glLoadName(START_SELECTEDBONDS);
       glCallList(bondObject);
 
       glPopMatrix();
@@ -1377,6 +2170,76 @@ void GLSimpleMoleculeView::drawSelections()
 ///////////////////////////////////////////////////////////////////////////////
 
 const float GLSimpleMoleculeView::cylinderHeight = 10.0f;
+const float GLSimpleMoleculeView::forceScale = 0.1f/0.0009f;
+const unsigned int GLSimpleMoleculeView::chunkSize = 256;
+const unsigned int GLSimpleMoleculeView::numLODLevels = 4;
+const int GLSimpleMoleculeView::minimumLODSlices = 6;
+const GLfloat GLSimpleMoleculeView::lodPixelsPerSlice = 6.0f;
+const GLubyte GLSimpleMoleculeView::lodListOffset = 0;
+
+const char* GLSimpleMoleculeView::impostorVertexShader =
+  "varying vec3 sphereCenter;\n"
+  "varying float sphereRadius;\n"
+  "varying vec3 quadPosition;\n"
+  "void main()\n"
+  "{\n"
+  "  vec4 center = gl_ModelViewMatrix * gl_Vertex;\n"
+  "  sphereCenter = center.xyz/center.w;\n"
+  // the modelview matrix may contain a uniform scaling
+  "  sphereRadius = gl_MultiTexCoord0.z * length(gl_ModelViewMatrix[0].xyz);\n"
+  // in perspective the sphere covers more than its radius in the plane of its center
+  "  float expand = 1.0;\n"
+  "  if(gl_ProjectionMatrix[3][3] == 0.0)\n"
+  "  {\n"
+  "    float distance2 = dot(sphereCenter, sphereCenter);\n"
+  "    expand = 1.25*sqrt(distance2/max(distance2 - sphereRadius*sphereRadius, 1.0e-4));\n"
+  "  }\n"
+  "  quadPosition = sphereCenter + vec3(gl_MultiTexCoord0.xy*sphereRadius*expand, 0.0);\n"
+  "  gl_Position = gl_ProjectionMatrix * vec4(quadPosition, 1.0);\n"
+  "  gl_FrontColor = gl_Color;\n"
+  "}\n";
+
+const char* GLSimpleMoleculeView::impostorFragmentShader =
+  "uniform bool depthCue;\n"
+  "varying vec3 sphereCenter;\n"
+  "varying float sphereRadius;\n"
+  "varying vec3 quadPosition;\n"
+  "void main()\n"
+  "{\n"
+  // intersect the viewing ray through this pixel with the sphere
+  "  vec3 hit;\n"
+  "  if(gl_ProjectionMatrix[3][3] == 0.0)\n"
+  "  {\n"
+  "    vec3 direction = normalize(quadPosition);\n"
+  "    float b = dot(direction, sphereCenter);\n"
+  "    float discriminant = b*b - dot(sphereCenter, sphereCenter) + sphereRadius*sphereRadius;\n"
+  "    if(discriminant < 0.0)\n"
+  "      discard;\n"
+  "    hit = direction*(b - sqrt(discriminant));\n"
+  "  }\n"
+  "  else\n"
+  "  {\n"
+  "    vec2 offset = quadPosition.xy - sphereCenter.xy;\n"
+  "    float height2 = sphereRadius*sphereRadius - dot(offset, offset);\n"
+  "    if(height2 < 0.0)\n"
+  "      discard;\n"
+  "    hit = vec3(quadPosition.xy, sphereCenter.z + sqrt(height2));\n"
+  "  }\n"
+  "  vec3 normal = (hit - sphereCenter)/sphereRadius;\n"
+  // the depth of the sphere surface instead of the quad
+  "  vec4 clip = gl_ProjectionMatrix * vec4(hit, 1.0);\n"
+  "  gl_FragDepth = 0.5*(gl_DepthRange.diff*clip.z/clip.w + gl_DepthRange.near + gl_DepthRange.far);\n"
+  // the same lighting as the fixed pipeline with a directional light and glColorMaterial
+  "  vec3 light = normalize(gl_LightSource[0].position.xyz);\n"
+  "  float diffuse = max(dot(normal, light), 0.0);\n"
+  "  vec3 color = gl_Color.rgb*(gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + diffuse*gl_LightSource[0].diffuse.rgb);\n"
+  "  if(diffuse > 0.0)\n"
+  "    color += pow(max(dot(normal, normalize(light + vec3(0.0, 0.0, 1.0))), 0.0), gl_FrontMaterial.shininess)\n"
+  "             *gl_FrontMaterial.specular.rgb*gl_LightSource[0].specular.rgb;\n"
+  "  if(depthCue)\n"
+  "    color = mix(gl_Fog.color.rgb, color, clamp((gl_Fog.end + hit.z)*gl_Fog.scale, 0.0, 1.0));\n"
+  "  gl_FragColor = vec4(color, gl_Color.a);\n"
+  "}\n";
 GLMoleculeParameters GLSimpleMoleculeView::moleculeParameters = {5, 1.0f, 0.2f, 0.2f, BallAndStick, Tubes, 1000, false, true,
-0x00FF00, 0x00FFFF, 0xFFFF00, 50, 0xFFFF0, false, 100};
+0x00FF00, 0x00FFFF, 0xFFFF00, 50, 0xFFFF0, false, 100, false, false};
 
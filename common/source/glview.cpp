@@ -37,19 +37,40 @@
 
 // Qt header files
 #include <qdatetime.h>
+#include <QElapsedTimer>
 #include <qfiledialog.h>
+#include <QFont>
+#include <QFontMetrics>
 #include <QImage>
 #include <QImageWriter>
 #include <qmessagebox.h>
 #include <qpoint.h>
 #include <qstringlist.h>
+#include <QTextStream>
 #include <qtimer.h>
 #include <QMouseEvent>
+#include <QGLFramebufferObject>
+#include <QGLShaderProgram>
 
 #include <GL/glu.h>
 
+// STL header files
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// OpenGL constants that are missing from old headers
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#define GL_TEXTURE1 0x84C1
+#endif
+#ifndef GL_RGBA16F_ARB
+#define GL_RGBA16F_ARB 0x881A
+#endif
+
 // Xbrabo header files
 #include "glview.h"
+#include "point3d.h"
 #include "quaternion.h"
 #include "vector3d.h"
 
@@ -69,7 +90,16 @@ GLView::GLView(QWidget* parent, const char* name) : QGLWidget(parent),
   zRot(0.0f),
   animation(false),
   maxRadius(1.0f),
-  currentPerspectiveProjection(baseParameters.perspectiveProjection)
+  currentPerspectiveProjection(baseParameters.perspectiveProjection),
+  transparencyChecked(false),
+  transparencyBuffer(0),
+  accumulationTexture(0),
+  compositeProgram(0),
+  blendFuncSeparate(0),
+  activeTexture(0),
+  offscreenRendering(false),
+  timingOverlay(false),
+  synchronousTiming(false)
 {
   setFocusPolicy(Qt::StrongFocus); // needed to receive all keystrokes
   orientationQuaternion = new Quaternion<float>(0.0f, 0.0f, 0.0f);
@@ -80,6 +110,14 @@ GLView::GLView(QWidget* parent, const char* name) : QGLWidget(parent),
                       // which is not defined yet for the dervived class which calls this constructor
                       // in its constructor
   updateIndex = staticUpdateIndex - 1; // an update is needed
+  timingClock = new QElapsedTimer();
+  timingClock->start();
+  for(unsigned int i = 0; i < TIMING_NEXT; i++)
+  {
+    timingStarts[i] = 0;
+    currentTimings[i] = 0;
+    frameTimings[i] = 0.0;
+  }
 }
 
 ///// destructor //////////////////////////////////////////////////////////////
@@ -87,6 +125,12 @@ GLView::~GLView()
 /// The destructor.
 {
   delete orientationQuaternion;
+  delete timingClock;
+  makeCurrent();
+  delete transparencyBuffer;
+  delete compositeProgram;
+  if(accumulationTexture != 0)
+    glDeleteTextures(1, &accumulationTexture);
 }
 
 ///// isModified //////////////////////////////////////////////////////////////
@@ -137,6 +181,150 @@ unsigned int GLView::calculateFPS()
   return numFPS*1000/nummSec;
 }
 
+///// renderImage /////////////////////////////////////////////////////////////
+QImage GLView::renderImage(const int imageWidth, const int imageHeight)
+/// Renders the scene into an image of the given size, independent of the size
+/// of the widget. The scene is drawn into a framebuffer object in tiles, each
+/// with the part of the projection it covers, so the size of the image is
+/// only limited by the available memory and the widget doesn't have to be
+/// visible. Returns a null image if framebuffer objects are not supported.
+{
+  if(imageWidth <= 0 || imageHeight <= 0)
+    return QImage();
+
+  updateGL(); // makes sure the view is initialized and up to date
+  makeCurrent();
+  if(!QGLFramebufferObject::hasOpenGLFramebufferObjects())
+    return QImage();
+
+  ///// determine the size of the tiles
+  GLint maxViewport[2];
+  glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+  const int tileSize = std::min(maxTileSize, static_cast<int>(std::min(maxViewport[0], maxViewport[1])));
+  QGLFramebufferObject buffer(tileSize, tileSize, QGLFramebufferObject::Depth);
+  if(!buffer.isValid())
+    return QImage();
+
+  QImage image(imageWidth, imageHeight, QImage::Format_RGB32);
+  std::vector<GLubyte> pixels(4*tileSize*tileSize);
+  const GLfloat aspectRatio = static_cast<GLfloat>(imageWidth) / static_cast<GLfloat>(imageHeight);
+  offscreenRendering = true;
+  buffer.bind();
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  for(int tileY = 0; tileY < imageHeight; tileY += tileSize)
+  {
+    const int tileHeight = std::min(tileSize, imageHeight - tileY);
+    for(int tileX = 0; tileX < imageWidth; tileX += tileSize)
+    {
+      const int tileWidth = std::min(tileSize, imageWidth - tileX);
+
+      ///// map the part of the full projection covered by this tile onto the viewport
+      glViewport(0, 0, tileWidth, tileHeight);
+      glMatrixMode(GL_PROJECTION);
+      glLoadIdentity();
+      glTranslatef(static_cast<GLfloat>(imageWidth - 2*tileX - tileWidth) / static_cast<GLfloat>(tileWidth),
+                   static_cast<GLfloat>(imageHeight - 2*tileY - tileHeight) / static_cast<GLfloat>(tileHeight), 0.0f);
+      glScalef(static_cast<GLfloat>(imageWidth) / static_cast<GLfloat>(tileWidth),
+               static_cast<GLfloat>(imageHeight) / static_cast<GLfloat>(tileHeight), 1.0f);
+      setPerspective(aspectRatio);
+      glMatrixMode(GL_MODELVIEW);
+
+      ///// draw the tile
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      glLoadIdentity();
+      if(baseParameters.perspectiveProjection)
+        gluLookAt(0.0f, 0.0f, zPos, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+      drawOrientedScene();
+
+      ///// copy it into the image (OpenGL has its origin at the bottom left)
+      glReadPixels(0, 0, tileWidth, tileHeight, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+      for(int row = 0; row < tileHeight; row++)
+      {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(imageHeight - 1 - tileY - row)) + tileX;
+        const GLubyte* source = &pixels[4*row*tileWidth];
+        for(int column = 0; column < tileWidth; column++, source += 4)
+          line[column] = qRgb(source[0], source[1], source[2]);
+      }
+    }
+  }
+  buffer.release();
+  offscreenRendering = false;
+
+  ///// restore the viewport and projection of the widget
+  resizeGL(width(), height());
+  return image;
+}
+
+///// setOrientation //////////////////////////////////////////////////////////
+void GLView::setOrientation(const float xAngle, const float yAngle, const float zAngle)
+/// Sets the orientation of the scene from Euler angles (in degrees).
+/// Does not redraw the scene.
+{
+  *orientationQuaternion = Quaternion<float>(xAngle, yAngle, zAngle);
+  setModified();
+}
+
+///// zoom ////////////////////////////////////////////////////////////////////
+void GLView::zoom(const float factor)
+/// Zooms in (factor > 1) or out (factor < 1) relative to the current zoom
+/// level. Does not redraw the scene.
+{
+  if(factor <= 0.0f)
+    return;
+
+  zPos /= factor;
+  if(baseParameters.perspectiveProjection && zPos < 0.1f)
+    zPos = 0.1f;
+  updateFog(maxRadius);
+  setModified();
+}
+
+///// frameTiming /////////////////////////////////////////////////////////////
+double GLView::frameTiming(const unsigned int section) const
+/// Returns the time in milliseconds spent on a part of the last frame.
+{
+  if(section >= TIMING_NEXT)
+    return 0.0;
+  return frameTimings[section];
+}
+
+///// benchmark ///////////////////////////////////////////////////////////////
+void GLView::benchmark(QTextStream& stream, const QString& name, const unsigned int numFrames)
+/// Draws numFrames frames along a fixed path (a full turn around the Y-axis
+/// while tilting up and down around the X-axis) and writes a line with the
+/// timings of each frame to stream in CSV format (see benchmarkHeader). The
+/// timings wait for OpenGL to finish, so they include the work done by the
+/// driver. The orientation is restored afterwards.
+{
+  const Quaternion<float> oldOrientation = *orientationQuaternion;
+  const bool oldAnimation = animation;
+  animation = false;
+  timer->stop();
+  synchronousTiming = true;
+
+  for(unsigned int frame = 0; frame < numFrames; frame++)
+  {
+    const float fraction = static_cast<float>(frame) / static_cast<float>(numFrames);
+    *orientationQuaternion = Quaternion<float>(30.0f*sin(360.0f*fraction*Point3D<float>::DEGTORAD), 360.0f*fraction, 0.0f);
+    updateGL();
+
+    double total = 0.0;
+    stream << name << "," << frame;
+    for(unsigned int i = 0; i < TIMING_NEXT; i++)
+    {
+      stream << "," << QString::number(frameTimings[i], 'f', 3);
+      if(i == TIMING_SCENE || i == TIMING_SWAP)
+        total += frameTimings[i];
+    }
+    stream << "," << QString::number(total, 'f', 3) << "\n";
+  }
+
+  synchronousTiming = false;
+  *orientationQuaternion = oldOrientation;
+  animation = oldAnimation;
+  updateGL();
+}
+
 ///// setParameters ///////////////////////////////////////////////////////////
 void GLView::setParameters(GLBaseParameters params)
 /// Updates the OpenGL parameters and
@@ -146,6 +334,18 @@ void GLView::setParameters(GLBaseParameters params)
   staticUpdateIndex++;
 }
 
+///// benchmarkHeader /////////////////////////////////////////////////////////
+QString GLView::benchmarkHeader()
+/// Returns the header line of the CSV output of benchmark. All timings are
+/// in milliseconds. The scene contains the named parts and the swap
+/// contains everything outside paintGL.
+{
+  QString result = "structure,frame";
+  for(unsigned int i = 0; i < TIMING_NEXT; i++)
+    result += QString(",") + timingNames[i];
+  return result + ",total\n";
+}
+
  //////////////////////////////////////////////////////////////////////////////
 ///// Public Slots                                                        /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -308,6 +508,14 @@ void GLView::saveImage()
     QMessageBox::warning(this, tr("Save image"), tr("An error occured. Image is not saved"));
 }
 
+///// toggleTimingOverlay /////////////////////////////////////////////////////
+void GLView::toggleTimingOverlay()
+/// Toggles the display of the timings of the previous frame on/off.
+{
+  timingOverlay = !timingOverlay;
+  updateGL();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Protected Member Functions                                          /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -385,6 +593,7 @@ void GLView::resizeGL(int w, int h)
 void GLView::paintGL()
 /// Overridden from QGlWidget::paintGL(). Does the drawing of the OpenGL scene.
 {
+  startTiming(TIMING_SCENE);
   if(staticUpdateIndex != updateIndex)
     updateGLSettings();
 
@@ -393,11 +602,6 @@ void GLView::paintGL()
   ///// multiply it with the current quaternion
   Quaternion<float> tempQuaternion = *orientationQuaternion;
   *orientationQuaternion = tempQuaternion*changeQuaternion;  // no *= operator implemented yet => calling default constructor?
-  ///// generate an axis-angle representation for OpenGL
-  Vector3D<float> axis;
-  float angle;
-  orientationQuaternion->getAxisAngle(axis, angle);
-
   if(!animation)
   {
     ///// reset the changes
@@ -423,18 +627,34 @@ void GLView::paintGL()
     gluLookAt(0.0f, 0.0f, zPos, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
   else
     resizeGL(width(), height());
-  glPushMatrix();
-  glTranslatef(xPos, yPos, 0.0f);
-  glRotatef(angle, axis.x(), axis.y(), axis.z());
-
-  drawScene(); // pure virtual
-
-  glPopMatrix();
+  drawOrientedScene();
+  if(timingOverlay)
+    drawTimingOverlay();
   glFlush(); // drawing is complete => send for execution
+  stopTiming(TIMING_SCENE);
   if(animation)
     timer->start(redrawWait);
 }
 
+///// glDraw //////////////////////////////////////////////////////////////////
+void GLView::glDraw()
+/// Overridden from QGLWidget::glDraw(). Draws and swaps a frame while keeping
+/// track of the time spent in each part. Everything outside paintGL is
+/// counted as swapping.
+{
+  for(unsigned int i = 0; i < TIMING_NEXT; i++)
+    currentTimings[i] = 0;
+  const qint64 start = timingClock->nsecsElapsed();
+
+  QGLWidget::glDraw();
+  if(synchronousTiming)
+    glFinish();
+
+  currentTimings[TIMING_SWAP] = timingClock->nsecsElapsed() - start - currentTimings[TIMING_SCENE];
+  for(unsigned int i = 0; i < TIMING_NEXT; i++)
+    frameTimings[i] = static_cast<double>(currentTimings[i]) / 1.0e6;
+}
+
 ///// mousePressEvent /////////////////////////////////////////////////////////
 void GLView::mousePressEvent(QMouseEvent* e)
 /// Overridden from QGlWidget::mousePressEvent. Handles left mouse button presses.
@@ -526,6 +746,7 @@ void GLView::keyPressEvent(QKeyEvent* e)
 /// \arg <ctrl>+<down>  : translate down
 /// \arg <ctrl>+<shift>+<left>: change internal coordinate of selection (smaller). Implementation in GLMoleculeView.
 /// \arg <ctrl>+<shift>+<right>: change internal coordinate of selection (larger). Implementation in GLMoleculeView.
+/// \arg <F12>         : show/hide the frame timings
 {
   switch(e->key())
   {
@@ -561,6 +782,9 @@ void GLView::keyPressEvent(QKeyEvent* e)
                             xRot = 5.0f; // rotate down
                           break;
 
+    case Qt::Key_F12    : toggleTimingOverlay();
+                          return;
+
     default:              e->ignore();
                           return;
   }
@@ -707,7 +931,226 @@ void GLView::updateProjection()
 void GLView::setPerspective()
 /// Sets the correct perspective.
 {
-  GLfloat aspectRatio = static_cast<float>(width()) / static_cast<float>(height());
+  setPerspective(static_cast<float>(width()) / static_cast<float>(height()));
+}
+
+///// updateFrustum ///////////////////////////////////////////////////////////
+void GLView::updateFrustum()
+/// Extracts the 6 clipping planes from the current projection and modelview
+/// matrices. The planes are expressed in the coordinate system that is
+/// current at the time of the call, so boxInFrustum can be called with
+/// bounding boxes in that system.
+{
+  GLfloat modelview[16];
+  GLfloat projection[16];
+  GLfloat clip[16];
+  glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+  glGetFloatv(GL_PROJECTION_MATRIX, projection);
+
+  ///// clip = projection * modelview (column-major)
+  for(unsigned int column = 0; column < 4; column++)
+    for(unsigned int row = 0; row < 4; row++)
+      clip[4*column + row] = projection[row]*modelview[4*column] + projection[4 + row]*modelview[4*column + 1]
+                           + projection[8 + row]*modelview[4*column + 2] + projection[12 + row]*modelview[4*column + 3];
+
+  ///// left, right, bottom, top, near and far are the 4th row +/- the others
+  for(unsigned int plane = 0; plane < 6; plane++)
+  {
+    const unsigned int row = plane/2;
+    const GLfloat sign = plane % 2 == 0 ? 1.0f : -1.0f;
+    for(unsigned int column = 0; column < 4; column++)
+      frustumPlanes[4*plane + column] = clip[4*column + 3] + sign*clip[4*column + row];
+  }
+}
+
+///// boxInFrustum ////////////////////////////////////////////////////////////
+bool GLView::boxInFrustum(const GLfloat* bounds) const
+/// Returns whether the axis-aligned box with the corners (bounds[0], bounds[1],
+/// bounds[2]) and (bounds[3], bounds[4], bounds[5]) is at least partly inside
+/// the clipping planes determined by the last call to updateFrustum. Boxes
+/// near a corner of the frustum can be reported as visible while they are not.
+{
+  for(unsigned int plane = 0; plane < 6; plane++)
+  {
+    ///// check the corner of the box furthest along the normal of the plane
+    const GLfloat* p = &frustumPlanes[4*plane];
+    const GLfloat x = p[0] > 0.0f ? bounds[3] : bounds[0];
+    const GLfloat y = p[1] > 0.0f ? bounds[4] : bounds[1];
+    const GLfloat z = p[2] > 0.0f ? bounds[5] : bounds[2];
+    if(p[0]*x + p[1]*y + p[2]*z + p[3] < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+///// beginTransparency ///////////////////////////////////////////////////////
+bool GLView::beginTransparency()
+/// Starts drawing into an offscreen buffer for weighted blended order
+/// independent transparency. Returns false if the OpenGL implementation
+/// doesn't support it, in which case the transparent shapes should be drawn
+/// with normal blending. Otherwise the subclass should do all passes of
+/// TransparencyPass in order, drawing the opaque shapes in the first one and
+/// the transparent shapes in the other ones, followed by endTransparency.
+{
+  if(offscreenRendering)
+    return false; // the passes need the default framebuffer and the size of the widget
+
+  if(!transparencyChecked)
+  {
+    ///// determine whether everything needed is supported
+    transparencyChecked = true;
+    blendFuncSeparate = reinterpret_cast<BlendFuncSeparateFunction>(context()->getProcAddress("glBlendFuncSeparate"));
+    activeTexture = reinterpret_cast<ActiveTextureFunction>(context()->getProcAddress("glActiveTexture"));
+    if(blendFuncSeparate != 0 && activeTexture != 0 && QGLFramebufferObject::hasOpenGLFramebufferObjects()
+       && QGLShaderProgram::hasOpenGLShaderPrograms(context()))
+    {
+      compositeProgram = new QGLShaderProgram(context());
+      if(!compositeProgram->addShaderFromSourceCode(QGLShader::Vertex, compositeVertexShader) ||
+         !compositeProgram->addShaderFromSourceCode(QGLShader::Fragment, compositeFragmentShader) ||
+         !compositeProgram->link())
+      {
+        qDebug("GLView::beginTransparency: order independent transparency disabled: %s", compositeProgram->log().toLatin1().data());
+        delete compositeProgram;
+        compositeProgram = 0;
+      }
+    }
+  }
+  if(compositeProgram == 0)
+    return false;
+
+  ///// (re)create the buffers if the size of the view changed
+  if(transparencyBuffer == 0 || transparencyBuffer->size() != size())
+  {
+    delete transparencyBuffer;
+    transparencyBuffer = new QGLFramebufferObject(size(), QGLFramebufferObject::Depth, GL_TEXTURE_2D, GL_RGBA16F_ARB);
+    if(!transparencyBuffer->isValid())
+    {
+      ///// probably no floating point textures
+      qDebug("GLView::beginTransparency: order independent transparency disabled: no floating point framebuffer");
+      delete transparencyBuffer;
+      transparencyBuffer = 0;
+      delete compositeProgram;
+      compositeProgram = 0;
+      return false;
+    }
+    if(accumulationTexture == 0)
+      glGenTextures(1, &accumulationTexture);
+    glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, width(), height(), 0, GL_RGBA, GL_FLOAT, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT);
+  transparencyBuffer->bind();
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  return true;
+}
+
+///// beginTransparencyPass ///////////////////////////////////////////////////
+void GLView::beginTransparencyPass(const unsigned int pass)
+/// Sets up the state for a pass of the order independent transparency.
+/// - TRANSPARENCY_DEPTH: only fills the depth buffer with the opaque shapes.
+/// - TRANSPARENCY_ACCUMULATE: sums the colors weighted by their alpha and
+///   the alphas of the transparent shapes.
+/// - TRANSPARENCY_REVEALAGE: multiplies (1 - alpha) of the transparent shapes
+///   giving the amount of the background that remains visible.
+{
+  switch(pass)
+  {
+    case TRANSPARENCY_DEPTH:
+      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      glDepthMask(GL_TRUE);
+      glDisable(GL_BLEND);
+      break;
+    case TRANSPARENCY_ACCUMULATE:
+      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      glDepthMask(GL_FALSE);
+      glEnable(GL_BLEND);
+      blendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
+      break;
+    case TRANSPARENCY_REVEALAGE:
+      ///// keep the accumulated colors and start again from full visibility
+      glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+      glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width(), height());
+      glBindTexture(GL_TEXTURE_2D, 0);
+      glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT);
+      glDepthMask(GL_FALSE);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+  }
+}
+
+///// endTransparency /////////////////////////////////////////////////////////
+void GLView::endTransparency()
+/// Composites the average color of the transparent shapes over the scene in
+/// the window with the amount of background remaining visible.
+{
+  transparencyBuffer->release();
+  glPopAttrib();
+
+  glPushAttrib(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_FOG);
+  glDisable(GL_CULL_FACE);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+  activeTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, transparencyBuffer->texture());
+  activeTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+  compositeProgram->bind();
+  compositeProgram->setUniformValue("accumulation", 0);
+  compositeProgram->setUniformValue("revealage", 1);
+  glBegin(GL_QUADS); // the vertex shader ignores the matrices
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(-1.0f, -1.0f);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex2f(1.0f, -1.0f);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2f(-1.0f, 1.0f);
+  glEnd();
+  compositeProgram->release();
+  activeTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  activeTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glPopAttrib();
+}
+
+///// startTiming /////////////////////////////////////////////////////////////
+void GLView::startTiming(const unsigned int section)
+/// Starts timing a part of the current frame. Parts can be timed more than
+/// once per frame, in which case the times are added.
+{
+  if(synchronousTiming)
+    glFinish(); // don't count the work of the previous part
+  timingStarts[section] = timingClock->nsecsElapsed();
+}
+
+///// stopTiming //////////////////////////////////////////////////////////////
+void GLView::stopTiming(const unsigned int section)
+/// Stops timing a part of the current frame.
+{
+  if(synchronousTiming)
+    glFinish();
+  currentTimings[section] += timingClock->nsecsElapsed() - timingStarts[section];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Private Member Functions                                            /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// setPerspective //////////////////////////////////////////////////////////
+void GLView::setPerspective(const GLfloat aspectRatio)
+/// Sets the perspective for a given aspect ratio of the viewport.
+{
   if(baseParameters.perspectiveProjection)
     gluPerspective(fieldOfView, aspectRatio, 0.1f, 100.0f); // originally 0.01f and 100.0f but artifacts from intersecting triangles
                                                             // are greatly reduced. Problem was the inaccuracy of the Z-buffer
@@ -716,6 +1159,41 @@ void GLView::setPerspective()
     glOrtho(-maxRadius*aspectRatio*zPos, maxRadius*aspectRatio*zPos, -maxRadius*zPos, maxRadius*zPos, -maxRadius, maxRadius);
 }
 
+///// drawOrientedScene ///////////////////////////////////////////////////////
+void GLView::drawOrientedScene()
+/// Draws the scene with the current translation and orientation. The camera
+/// should already have been set up.
+{
+  ///// generate an axis-angle representation for OpenGL
+  Vector3D<float> axis;
+  float angle;
+  orientationQuaternion->getAxisAngle(axis, angle);
+
+  glPushMatrix();
+  glTranslatef(xPos, yPos, 0.0f);
+  glRotatef(angle, axis.x(), axis.y(), axis.z());
+
+  drawScene(); // pure virtual
+
+  glPopMatrix();
+}
+
+///// drawTimingOverlay ///////////////////////////////////////////////////////
+void GLView::drawTimingOverlay()
+/// Shows the timings of the previous frame in the top left corner.
+{
+  const QColor background(baseParameters.backgroundColor);
+  qglColor(background.value() > 127 ? Qt::black : Qt::white);
+  QFont font;
+  font.setStyleHint(QFont::TypeWriter);
+  const int lineHeight = QFontMetrics(font).lineSpacing();
+  double total = frameTimings[TIMING_SCENE] + frameTimings[TIMING_SWAP];
+  for(unsigned int i = 0; i < TIMING_NEXT; i++)
+    renderText(5, (i + 1)*lineHeight, QString("%1: %2 ms").arg(timingNames[i], -8).arg(frameTimings[i], 0, 'f', 2), font);
+  renderText(5, (TIMING_NEXT + 1)*lineHeight, QString("%1: %2 ms (%3 FPS)").arg("total", -8).arg(total, 0, 'f', 2)
+             .arg(total > 0.0 ? 1000.0/total : 0.0, 0, 'f', 1), font);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Static Variables                                                    /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -723,6 +1201,27 @@ void GLView::setPerspective()
 int GLView::staticUpdateIndex = 0;
 const int GLView::redrawWait = 33;
 const float GLView::fieldOfView = 60.0f;
+const int GLView::maxTileSize = 2048;
+const char* GLView::timingNames[TIMING_NEXT] = {"atoms", "bonds", "labels", "surfaces", "scene", "swap"};
+
+const char* GLView::compositeVertexShader =
+  "void main()\n"
+  "{\n"
+  "  gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+  "  gl_Position = gl_Vertex;\n"
+  "}\n";
+
+const char* GLView::compositeFragmentShader =
+  "uniform sampler2D accumulation;\n"
+  "uniform sampler2D revealage;\n"
+  "void main()\n"
+  "{\n"
+  "  float remaining = texture2D(revealage, gl_TexCoord[0].st).r;\n"
+  "  if(remaining == 1.0)\n"
+  "    discard;\n" // no transparent shapes at this pixel
+  "  vec4 sum = texture2D(accumulation, gl_TexCoord[0].st);\n"
+  "  gl_FragColor = vec4(sum.rgb/max(sum.a, 1.0e-5), remaining);\n"
+  "}\n";
 
 ///// MSVC .NET 2002 cannot compile static initializers when non-trivial constructors
 ///// are used for the members of (non)aggregates. Should be fixed in .NET 2003
@@ -0,0 +1,477 @@
+/***************************************************************************
+                       spatialindex.cpp  -  description
+                             -------------------
+    begin                : Mon Oct 19 2026
+    copyright            : (C) 2026 by the Brabosphere developers
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+///// Comments ////////////////////////////////////////////////////////////////
+
+/*!
+  \class SpatialIndex
+  \brief A uniform grid for fast spatial queries on a set of points.
+
+  The points are divided into cubic cells with on average about one point per
+  cell. The coordinates are copied in cell order so each query only touches
+  contiguous memory of the cells it overlaps. Supported queries are:
+  \arg all points within a radius of a point
+  \arg all points inside a box
+  \arg the k nearest points to a point
+  \arg all points within a radius of a ray
+
+  The index does not track changes to the points. The owner should call
+  invalidate() whenever they change and build() before querying again.
+
+*/
+/// \file
+/// Contains the implementation of the class SpatialIndex.
+
+///// Header files ////////////////////////////////////////////////////////////
+
+// C++ header files
+#include <cmath>
+#include <cstdlib>
+
+// STL header files
+#include <algorithm>
+#include <utility>
+
+// Xbrabo header files
+#include "spatialindex.h"
+#include "vector3d.h" // includes the Point3D header file
+
+///////////////////////////////////////////////////////////////////////////////
+///// Public Member Functions                                             /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// Constructor /////////////////////////////////////////////////////////////
+SpatialIndex::SpatialIndex() :
+  valid(false),
+  originX(0.0),
+  originY(0.0),
+  originZ(0.0),
+  cellSize(minimumCellSize),
+  numCellsX(0),
+  numCellsY(0),
+  numCellsZ(0)
+/// The default constructor.
+{
+
+}
+
+///// Destructor //////////////////////////////////////////////////////////////
+SpatialIndex::~SpatialIndex()
+/// The default destructor.
+{
+
+}
+
+///// build ///////////////////////////////////////////////////////////////////
+void SpatialIndex::build(const unsigned int numPoints, const double* x, const double* y, const double* z)
+/// Builds the grid for the \a numPoints points with coordinates in the arrays
+/// \a x, \a y and \a z. The returned indices of all queries refer to the
+/// positions in these arrays.
+{
+  cellStart.clear();
+  sortedIndices.clear();
+  sortedX.clear();
+  sortedY.clear();
+  sortedZ.clear();
+  valid = true;
+  if(numPoints == 0)
+  {
+    numCellsX = numCellsY = numCellsZ = 0;
+    return;
+  }
+
+  ///// determine the extent of the points
+  double maxX = x[0];
+  double maxY = y[0];
+  double maxZ = z[0];
+  originX = maxX;
+  originY = maxY;
+  originZ = maxZ;
+  for(unsigned int i = 1; i < numPoints; i++)
+  {
+    originX = std::min(originX, x[i]);
+    originY = std::min(originY, y[i]);
+    originZ = std::min(originZ, z[i]);
+    maxX = std::max(maxX, x[i]);
+    maxY = std::max(maxY, y[i]);
+    maxZ = std::max(maxZ, z[i]);
+  }
+
+  ///// choose the cell size such that there is about 1 point per cell
+  const double volume = (maxX - originX + minimumCellSize) * (maxY - originY + minimumCellSize) * (maxZ - originZ + minimumCellSize);
+  cellSize = std::max(minimumCellSize, pow(volume/numPoints, 1.0/3.0));
+  numCellsX = static_cast<int>((maxX - originX)/cellSize) + 1;
+  numCellsY = static_cast<int>((maxY - originY)/cellSize) + 1;
+  numCellsZ = static_cast<int>((maxZ - originZ)/cellSize) + 1;
+
+  ///// count the number of points per cell
+  vector<unsigned int> pointCell(numPoints);
+  cellStart.assign(numCellsX*numCellsY*numCellsZ + 1, 0);
+  for(unsigned int i = 0; i < numPoints; i++)
+  {
+    pointCell[i] = cellX(x[i]) + numCellsX*(cellY(y[i]) + numCellsY*cellZ(z[i]));
+    cellStart[pointCell[i] + 1]++;
+  }
+  for(unsigned int i = 1; i < cellStart.size(); i++)
+    cellStart[i] += cellStart[i - 1];
+
+  ///// copy the points in cell order
+  vector<unsigned int> nextPosition(cellStart.begin(), cellStart.end() - 1);
+  sortedIndices.resize(numPoints);
+  sortedX.resize(numPoints);
+  sortedY.resize(numPoints);
+  sortedZ.resize(numPoints);
+  for(unsigned int i = 0; i < numPoints; i++)
+  {
+    const unsigned int position = nextPosition[pointCell[i]]++;
+    sortedIndices[position] = i;
+    sortedX[position] = x[i];
+    sortedY[position] = y[i];
+    sortedZ[position] = z[i];
+  }
+}
+
+///// build (overloaded) //////////////////////////////////////////////////////
+void SpatialIndex::build(const vector<Point3D<double> >& points)
+/// Builds the grid for \a points. \overload
+{
+  vector<double> x, y, z;
+  x.reserve(points.size());
+  y.reserve(points.size());
+  z.reserve(points.size());
+  for(vector<Point3D<double> >::const_iterator it = points.begin(); it != points.end(); it++)
+  {
+    x.push_back(it->x());
+    y.push_back(it->y());
+    z.push_back(it->z());
+  }
+  build(points.size(), x.empty() ? 0 : &x[0], y.empty() ? 0 : &y[0], z.empty() ? 0 : &z[0]);
+}
+
+///// invalidate //////////////////////////////////////////////////////////////
+void SpatialIndex::invalidate()
+/// Marks the grid as outdated. The memory is kept for the next build.
+{
+  valid = false;
+}
+
+///// isValid /////////////////////////////////////////////////////////////////
+bool SpatialIndex::isValid() const
+/// Returns true if the grid is up to date.
+{
+  return valid;
+}
+
+///// count ///////////////////////////////////////////////////////////////////
+unsigned int SpatialIndex::count() const
+/// Returns the number of indexed points.
+{
+  return sortedIndices.size();
+}
+
+///// withinRadius ////////////////////////////////////////////////////////////
+vector<unsigned int> SpatialIndex::withinRadius(const Point3D<double>& center, const double radius) const
+/// Returns the sorted indices of all points within a distance \a radius
+/// of \a center.
+{
+  vector<unsigned int> result;
+  if(!valid || sortedIndices.empty() || radius < 0.0)
+    return result;
+
+  const double radius2 = radius*radius;
+  const int minX = cellX(center.x() - radius);
+  const int minY = cellY(center.y() - radius);
+  const int minZ = cellZ(center.z() - radius);
+  const int maxX = cellX(center.x() + radius);
+  const int maxY = cellY(center.y() + radius);
+  const int maxZ = cellZ(center.z() + radius);
+  double dx, dy, dz;
+  for(int z = minZ; z <= maxZ; z++)
+  {
+    for(int y = minY; y <= maxY; y++)
+    {
+      const unsigned int rowStart = numCellsX*(y + numCellsY*z);
+      for(unsigned int i = cellStart[rowStart + minX]; i < cellStart[rowStart + maxX + 1]; i++)
+      {
+        dx = sortedX[i] - center.x();
+        dy = sortedY[i] - center.y();
+        dz = sortedZ[i] - center.z();
+        if(dx*dx + dy*dy + dz*dz <= radius2)
+          result.push_back(sortedIndices[i]);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+///// withinBox ///////////////////////////////////////////////////////////////
+vector<unsigned int> SpatialIndex::withinBox(const Point3D<double>& minimum, const Point3D<double>& maximum) const
+/// Returns the sorted indices of all points inside the box with corners
+/// \a minimum and \a maximum.
+{
+  vector<unsigned int> result;
+  if(!valid || sortedIndices.empty())
+    return result;
+
+  const int minX = cellX(minimum.x());
+  const int minY = cellY(minimum.y());
+  const int minZ = cellZ(minimum.z());
+  const int maxX = cellX(maximum.x());
+  const int maxY = cellY(maximum.y());
+  const int maxZ = cellZ(maximum.z());
+  for(int z = minZ; z <= maxZ; z++)
+  {
+    for(int y = minY; y <= maxY; y++)
+    {
+      const unsigned int rowStart = numCellsX*(y + numCellsY*z);
+      for(unsigned int i = cellStart[rowStart + minX]; i < cellStart[rowStart + maxX + 1]; i++)
+      {
+        if(sortedX[i] >= minimum.x() && sortedX[i] <= maximum.x() &&
+           sortedY[i] >= minimum.y() && sortedY[i] <= maximum.y() &&
+           sortedZ[i] >= minimum.z() && sortedZ[i] <= maximum.z())
+          result.push_back(sortedIndices[i]);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+///// nearest /////////////////////////////////////////////////////////////////
+vector<unsigned int> SpatialIndex::nearest(const Point3D<double>& point, const unsigned int number) const
+/// Returns the indices of the \a number points closest to \a point, sorted by
+/// increasing distance. The search grows outward one shell of cells at a time.
+{
+  vector<unsigned int> result;
+  if(!valid || sortedIndices.empty() || number == 0)
+    return result;
+
+  const unsigned int wanted = std::min(number, count());
+  const int centerX = cellX(point.x());
+  const int centerY = cellY(point.y());
+  const int centerZ = cellZ(point.z());
+  vector<std::pair<double, unsigned int> > candidates;
+  double dx, dy, dz;
+  for(int shell = 0; ; shell++)
+  {
+    ///// add the points of the cells on the surface of the block
+    for(int z = std::max(0, centerZ - shell); z <= std::min(numCellsZ - 1, centerZ + shell); z++)
+    {
+      for(int y = std::max(0, centerY - shell); y <= std::min(numCellsY - 1, centerY + shell); y++)
+      {
+        const bool fullRow = abs(z - centerZ) == shell || abs(y - centerY) == shell;
+        for(int x = std::max(0, centerX - shell); x <= std::min(numCellsX - 1, centerX + shell); x++)
+        {
+          if(!fullRow && abs(x - centerX) != shell)
+          {
+            if(centerX + shell > numCellsX - 1)
+              break; // the other side of the block lies outside the grid
+            x = centerX + shell - 1; // skip to the other side of the block
+            continue;
+          }
+          const unsigned int cell = x + numCellsX*(y + numCellsY*z);
+          for(unsigned int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+          {
+            dx = sortedX[i] - point.x();
+            dy = sortedY[i] - point.y();
+            dz = sortedZ[i] - point.z();
+            candidates.push_back(std::make_pair(dx*dx + dy*dy + dz*dz, sortedIndices[i]));
+          }
+        }
+      }
+    }
+
+    ///// stop when all cells are searched or the unsearched cells are too far away
+    const bool lowX = centerX - shell <= 0;
+    const bool lowY = centerY - shell <= 0;
+    const bool lowZ = centerZ - shell <= 0;
+    const bool highX = centerX + shell >= numCellsX - 1;
+    const bool highY = centerY + shell >= numCellsY - 1;
+    const bool highZ = centerZ + shell >= numCellsZ - 1;
+    if(lowX && lowY && lowZ && highX && highY && highZ)
+      break;
+    if(candidates.size() < wanted)
+      continue;
+    double bound = -1.0;
+    const double sides[6] = {lowX ? -1.0 : point.x() - originX - (centerX - shell)*cellSize,
+                             lowY ? -1.0 : point.y() - originY - (centerY - shell)*cellSize,
+                             lowZ ? -1.0 : point.z() - originZ - (centerZ - shell)*cellSize,
+                             highX ? -1.0 : originX + (centerX + shell + 1)*cellSize - point.x(),
+                             highY ? -1.0 : originY + (centerY + shell + 1)*cellSize - point.y(),
+                             highZ ? -1.0 : originZ + (centerZ + shell + 1)*cellSize - point.z()};
+    const bool open[6] = {!lowX, !lowY, !lowZ, !highX, !highY, !highZ};
+    for(unsigned int i = 0; i < 6; i++)
+    {
+      if(open[i] && (bound < 0.0 || sides[i] < bound))
+        bound = sides[i];
+    }
+    if(bound <= 0.0)
+      continue;
+    std::nth_element(candidates.begin(), candidates.begin() + wanted - 1, candidates.end());
+    if(candidates[wanted - 1].first <= bound*bound)
+      break;
+  }
+
+  std::partial_sort(candidates.begin(), candidates.begin() + wanted, candidates.end());
+  result.reserve(wanted);
+  for(unsigned int i = 0; i < wanted; i++)
+    result.push_back(candidates[i].second);
+  return result;
+}
+
+///// alongRay ////////////////////////////////////////////////////////////////
+vector<unsigned int> SpatialIndex::alongRay(const Point3D<double>& origin, const Vector3D<double>& direction, const double radius) const
+/// Returns the indices of all points within a distance \a radius of the ray
+/// starting at \a origin, sorted by increasing distance along the ray.
+/// Points behind the origin are not returned.
+{
+  vector<unsigned int> result;
+  if(!valid || sortedIndices.empty() || radius < 0.0 || direction.isZero())
+    return result;
+
+  Vector3D<double> unit = direction;
+  unit.normalize();
+  const double start[3] = {origin.x(), origin.y(), origin.z()};
+  const double dir[3] = {unit.x(), unit.y(), unit.z()};
+  const double low[3] = {originX - radius, originY - radius, originZ - radius};
+  const double high[3] = {originX + numCellsX*cellSize + radius, originY + numCellsY*cellSize + radius, originZ + numCellsZ*cellSize + radius};
+
+  ///// clip the ray against the grid enlarged by the radius
+  double tMin = 0.0;
+  double tMax = 0.0;
+  bool unbounded = true;
+  for(unsigned int i = 0; i < 3; i++)
+  {
+    if(fabs(dir[i]) < Point3D<double>::TOLERANCE)
+    {
+      if(start[i] < low[i] || start[i] > high[i])
+        return result; // parallel to and outside of this slab
+      continue;
+    }
+    double t1 = (low[i] - start[i])/dir[i];
+    double t2 = (high[i] - start[i])/dir[i];
+    if(t1 > t2)
+      std::swap(t1, t2);
+    tMin = std::max(tMin, t1);
+    tMax = unbounded ? t2 : std::min(tMax, t2);
+    unbounded = false;
+  }
+  if(tMin > tMax)
+    return result;
+
+  ///// collect the cells around the ray in steps of half a cell
+  vector<unsigned int> cells;
+  const double step = 0.5*cellSize;
+  for(double t = tMin; ; t += step)
+  {
+    const double tEnd = std::min(t + step, tMax);
+    const double x1 = start[0] + t*dir[0], x2 = start[0] + tEnd*dir[0];
+    const double y1 = start[1] + t*dir[1], y2 = start[1] + tEnd*dir[1];
+    const double z1 = start[2] + t*dir[2], z2 = start[2] + tEnd*dir[2];
+    addCells(cellX(std::min(x1, x2) - radius), cellY(std::min(y1, y2) - radius), cellZ(std::min(z1, z2) - radius),
+             cellX(std::max(x1, x2) + radius), cellY(std::max(y1, y2) + radius), cellZ(std::max(z1, z2) + radius), cells);
+    if(tEnd >= tMax)
+      break;
+  }
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+  ///// check the points in these cells
+  vector<std::pair<double, unsigned int> > hits;
+  const double radius2 = radius*radius;
+  double dx, dy, dz, t;
+  for(vector<unsigned int>::const_iterator it = cells.begin(); it != cells.end(); it++)
+  {
+    for(unsigned int i = cellStart[*it]; i < cellStart[*it + 1]; i++)
+    {
+      dx = sortedX[i] - start[0];
+      dy = sortedY[i] - start[1];
+      dz = sortedZ[i] - start[2];
+      t = dx*dir[0] + dy*dir[1] + dz*dir[2];
+      if(t >= 0.0 && dx*dx + dy*dy + dz*dz - t*t <= radius2)
+        hits.push_back(std::make_pair(t, sortedIndices[i]));
+    }
+  }
+  std::sort(hits.begin(), hits.end());
+  result.reserve(hits.size());
+  for(unsigned int i = 0; i < hits.size(); i++)
+    result.push_back(hits[i].second);
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Private Member Functions                                            /////
+///////////////////////////////////////////////////////////////////////////////
+
+///// cellX ///////////////////////////////////////////////////////////////////
+int SpatialIndex::cellX(const double x) const
+/// Returns the index along X of the cell containing \a x. Positions outside
+/// the grid are clamped to the border cells.
+{
+  const double cell = floor((x - originX)/cellSize);
+  if(cell < 0.0)
+    return 0;
+  if(cell >= numCellsX)
+    return numCellsX - 1;
+  return static_cast<int>(cell);
+}
+
+///// cellY ///////////////////////////////////////////////////////////////////
+int SpatialIndex::cellY(const double y) const
+/// Returns the index along Y of the cell containing \a y.
+{
+  const double cell = floor((y - originY)/cellSize);
+  if(cell < 0.0)
+    return 0;
+  if(cell >= numCellsY)
+    return numCellsY - 1;
+  return static_cast<int>(cell);
+}
+
+///// cellZ ///////////////////////////////////////////////////////////////////
+int SpatialIndex::cellZ(const double z) const
+/// Returns the index along Z of the cell containing \a z.
+{
+  const double cell = floor((z - originZ)/cellSize);
+  if(cell < 0.0)
+    return 0;
+  if(cell >= numCellsZ)
+    return numCellsZ - 1;
+  return static_cast<int>(cell);
+}
+
+///// addCells ////////////////////////////////////////////////////////////////
+void SpatialIndex::addCells(const int minX, const int minY, const int minZ, const int maxX, const int maxY, const int maxZ, vector<unsigned int>& cells) const
+/// Adds the indices of the block of cells between the given cell positions
+/// (inclusive) to \a cells.
+{
+  for(int z = minZ; z <= maxZ; z++)
+  {
+    for(int y = minY; y <= maxY; y++)
+    {
+      for(int x = minX; x <= maxX; x++)
+        cells.push_back(x + numCellsX*(y + numCellsY*z));
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///// Static Variables                                                    /////
+///////////////////////////////////////////////////////////////////////////////
+
+const double SpatialIndex::minimumCellSize = 2.0;
+
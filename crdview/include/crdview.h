@@ -31,6 +31,8 @@ class QPopupmenu;
 class AtomSet;
 class GLSimpleMoleculeView;
 class PreferencesCV;
+class QSize;
+class QTextStream;
 #include "glbaseparameters.h"
 #include "glmoleculeparameters.h"
 #include "iconsets.h"
@@ -48,6 +50,9 @@ class CrdView : public QMainWindow
     ~CrdView();                         // destructor
 
     void readCoordinates(QString filename = QString::null); // loads the given filename for viewing or asks for one if not specified
+    bool renderImage(const QString inputFileName, const QString outputFileName, const QSize& size, const int style,
+                     const float xAngle, const float yAngle, const float zAngle, const float zoomFactor); // renders a coordinate file to an image without showing the window
+    bool benchmark(const QString inputFileName, QTextStream& stream, const unsigned int numFrames);  // writes the frame timings for a coordinate file
 
   private slots:
     void fileOpen();                    // Opens a coordinate file
@@ -69,6 +74,7 @@ class CrdView : public QMainWindow
     void initMenuBar();                 // creates the menu
     void initToolBar();                 // creates the toolbar(s)
     void readSettings();                // reads the Brabosphere and CrdView settings
+    bool loadCoordinates(const QString filename); // loads the given filename without showing any dialogs
     void saveSettings();                // saves the CrdView settings
     QString actionText(const QString title, const QString brief, const QString details = QString::null, const IconSets::IconSetID iconID = IconSets::LastIcon); // constructs a text for the What's This mode for actions
 
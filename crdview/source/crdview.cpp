@@ -36,6 +36,8 @@
 #include <qcheckbox.h>
 #include <qcombobox.h>
 #include <qfiledialog.h>
+#include <qfileinfo.h>
+#include <qimage.h>
 #include <qlabel.h>
 #include <qmenubar.h>
 #include <qmsgbox.h>
@@ -43,6 +45,7 @@
 #include <qsettings.h>
 #include <qstatusbar.h>
 #include <qtextedit.h>
+#include <qtextstream.h>
 #include <qtoolbar.h>
 #include <qwhatsthis.h>
 
@@ -113,6 +116,51 @@ void CrdView::readCoordinates(QString filename)
 
 }
 
+///// renderImage /////////////////////////////////////////////////////////////
+bool CrdView::renderImage(const QString inputFileName, const QString outputFileName, const QSize& size, const int style,
+                          const float xAngle, const float yAngle, const float zAngle, const float zoomFactor)
+{
+  ///// Public member function. Renders the coordinates from inputFileName
+  ///// offscreen to the image outputFileName with the given size, without
+  ///// showing the window or any dialogs. A negative style keeps the one from
+  ///// the settings. Returns false if anything failed.
+
+  if(!loadCoordinates(inputFileName))
+    return false;
+  if(style >= 0)
+    glview->setDisplayStyle(GLSimpleMoleculeView::Molecule, style);
+  glview->resize(size); // the zoom is fitted to the aspect ratio of the widget
+  glview->resetView(false);
+  glview->setOrientation(xAngle, yAngle, zAngle);
+  glview->zoom(zoomFactor);
+
+  QImage image = glview->renderImage(size.width(), size.height());
+  if(image.isNull())
+  {
+    qWarning("Offscreen rendering is not supported by this OpenGL implementation");
+    return false;
+  }
+  if(!image.save(outputFileName))
+  {
+    qWarning("The image could not be saved to " + outputFileName);
+    return false;
+  }
+  return true;
+}
+
+///// benchmark ///////////////////////////////////////////////////////////////
+bool CrdView::benchmark(const QString inputFileName, QTextStream& stream, const unsigned int numFrames)
+{
+  ///// Public member function. Loads the coordinates from inputFileName and
+  ///// writes the timings of numFrames frames along a fixed rotation path to
+  ///// stream in CSV format. The window should be visible.
+
+  if(!loadCoordinates(inputFileName))
+    return false;
+  glview->benchmark(stream, QFileInfo(inputFileName).fileName(), numFrames);
+  return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///// Private slots                                                       /////
 ///////////////////////////////////////////////////////////////////////////////
@@ -491,6 +539,21 @@ void CrdView::initToolBar()
   actionWhatsThis->addTo(ToolBarFile);
 }
 
+///// loadCoordinates /////////////////////////////////////////////////////////
+bool CrdView::loadCoordinates(const QString filename)
+/// Loads the given filename for viewing without showing any dialogs, for use
+/// from the command line. Returns false if the file could not be read.
+{
+  if(CrdFactory::readFromFile(atoms, filename) != CrdFactory::OK)
+  {
+    qWarning("The coordinates could not be read from " + filename);
+    return false;
+  }
+  glview->updateAtomSet(true);
+  setCaption(tr("CrdView") + QString(" - ") + filename);
+  return true;
+}
+
 ///// readSettings ////////////////////////////////////////////////////////////
 void CrdView::readSettings()
 /// Reads the settings from the Brabosphere settings file.
@@ -521,8 +584,10 @@ void CrdView::readSettings()
   glMoleculeParameters.defaultMoleculeStyle = settings.readNumEntry(prefix + "style_molecule", 3); // Ball & Stick
   glMoleculeParameters.defaultForcesStyle   = settings.readNumEntry(prefix + "style_forces", 2); // Tubes
   glMoleculeParameters.fastRenderLimit      = settings.readNumEntry(prefix + "fast_render_limit", 1000);
+  glMoleculeParameters.impostorSpheres      = settings.readBoolEntry(prefix + "impostor_spheres", false);
   glMoleculeParameters.showElements         = settings.readBoolEntry(prefix + "show_elements", false);
   glMoleculeParameters.showNumbers          = settings.readBoolEntry(prefix + "show_numbers", true);
+  glMoleculeParameters.hideOverlappingLabels = settings.readBoolEntry(prefix + "hide_overlapping_labels", false);
   const int lineWidth                       = settings.readNumEntry(prefix + "size_lines", defaultLineWidth); 
   glMoleculeParameters.sizeLines            = static_cast<GLfloat>(lineWidth)*lwgran[0];
   qDebug("read sizeLines = %f",glMoleculeParameters.sizeLines);
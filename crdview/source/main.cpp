@@ -22,7 +22,11 @@
 
 // Qt header files
 #include <qapplication.h>
+#include <qfile.h>
+#include <qfileinfo.h>
 #include <qfont.h>
+#include <qsize.h>
+#include <qtextstream.h>
 #include <qstring.h>
 #include <qtextcodec.h>
 #include <qtranslator.h>
@@ -30,6 +34,7 @@
 // CrdView header files
 #include "crdfactory.h"
 #include "crdview.h"
+#include "glsimplemoleculeview.h"
 
 ///// debugHandler ////////////////////////////////////////////////////////////
 static void debugHandler(QtMsgType type, const char* message)
@@ -62,21 +67,146 @@ int main(int argc, char *argv[])
   ///// now the Qt options have been removed from the argument list, so read
   ///// in the possible input and output filenames
   ///// USAGE: crdview [ <Qt options> ] [ -bnf ] [ <input file> [ <output file> ]]
+  /////        crdview [ <Qt options> ] -render <image file> [ -size <width>x<height> ]
+  /////                [ -style lines|tubes|ballandstick|vdw ] [ -rotate <x>,<y>,<z> ]
+  /////                [ -zoom <factor> ] <input file> [ <input file> ... ]
+  /////        crdview [ <Qt options> ] -benchmark <CSV file> [ -frames <number> ]
+  /////                <input file> [ <input file> ... ]
+  ///// When rendering more than one input file, %1 in the image filename is
+  ///// replaced by the base name of each input file.
 
 
   // read the rest of the command line into a QStringList
   QStringList argList;
   bool extendedFormat = true;
-  for(int i = 1; i <= argc; i++)
+  QString renderFileName;
+  QSize renderSize(1024, 768);
+  int renderStyle = -1;
+  float renderAngles[3] = {0.0f, 0.0f, 0.0f};
+  float renderZoom = 1.0f;
+  QString benchmarkFileName;
+  unsigned int benchmarkFrames = 360;
+  for(int i = 1; i < argc; i++)
   {
     QString argument = argv[i];
     if(argument.isEmpty())
       break;
     if(argument.left(1) != "-")
       argList += argument;
-    else if(argument.lower() = "-bnf") // brabo normal format (extended is the default for writing)
+    else if(argument.lower() == "-bnf") // brabo normal format (extended is the default for writing)
       extendedFormat = false;
+    else if(i + 1 < argc)
+    {
+      ///// options with a value
+      QString value = argv[++i];
+      if(argument.lower() == "-render")
+        renderFileName = value;
+      else if(argument.lower() == "-size")
+      {
+        QStringList dimensions = QStringList::split("x", value.lower());
+        if(dimensions.count() == 2 && dimensions[0].toInt() > 0 && dimensions[1].toInt() > 0)
+          renderSize = QSize(dimensions[0].toInt(), dimensions[1].toInt());
+        else
+          qWarning("Invalid image size " + value + ", using the default");
+      }
+      else if(argument.lower() == "-style")
+      {
+        QStringList styles = QStringList::split(",", "lines,tubes,ballandstick,vdw");
+        int index = styles.findIndex(value.lower());
+        if(index != -1)
+          renderStyle = GLSimpleMoleculeView::Lines + index;
+        else
+          qWarning("Unknown style " + value + ", using the default");
+      }
+      else if(argument.lower() == "-rotate")
+      {
+        QStringList angles = QStringList::split(",", value);
+        for(int j = 0; j < 3 && j < angles.count(); j++)
+          renderAngles[j] = angles[j].toFloat();
+      }
+      else if(argument.lower() == "-zoom")
+        renderZoom = value.toFloat();
+      else if(argument.lower() == "-benchmark")
+        benchmarkFileName = value;
+      else if(argument.lower() == "-frames")
+      {
+        bool ok;
+        const int frames = value.toInt(&ok);
+        if(!ok || frames <= 0)
+        {
+          qWarning("Invalid number of frames " + value);
+          return -1;
+        }
+        benchmarkFrames = frames;
+      }
+      else
+        i--; // unknown option, its value might be a filename
+    }
+  }
+
+  // check whether images should be rendered
+  if(!renderFileName.isEmpty())
+  {
+    if(argList.isEmpty())
+    {
+      qWarning("No input files given for rendering");
+      return -1;
+    }
+    if(argList.count() > 1 && !renderFileName.contains("%1"))
+    {
+      qWarning("The image filename should contain %1 when rendering more than one file");
+      return -1;
+    }
+    if (!QGLFormat::hasOpenGL())
+    {
+      qWarning("This system has no working OpenGL support. Exiting...");
+      return -1;
+    }
+    CrdView* crdview = new CrdView(); // never shown and not deleted, as that would save its (hidden) layout to the settings
+    int result = 0;
+    for(QStringList::Iterator it = argList.begin(); it != argList.end(); it++)
+    {
+      QString outputFileName = argList.count() > 1 ? renderFileName.arg(QFileInfo(*it).baseName()) : renderFileName;
+      if(!crdview->renderImage(*it, outputFileName, renderSize, renderStyle, renderAngles[0], renderAngles[1], renderAngles[2], renderZoom))
+        result = 1;
+    }
+    return result;
   }
+
+  // check whether a benchmark should be run
+  if(!benchmarkFileName.isEmpty())
+  {
+    if(argList.isEmpty())
+    {
+      qWarning("No input files given for the benchmark");
+      return -1;
+    }
+    QFile file(benchmarkFileName);
+    if(!file.open(IO_WriteOnly))
+    {
+      qWarning("The file " + benchmarkFileName + " could not be opened for writing");
+      return -1;
+    }
+    if (!QGLFormat::hasOpenGL())
+    {
+      qWarning("This system has no working OpenGL support. Exiting...");
+      return -1;
+    }
+    QTextStream stream(&file);
+    stream << GLView::benchmarkHeader();
+    CrdView* crdview = new CrdView();
+    crdview->show(); // the timings should include swapping the buffers
+    a.processEvents();
+    int result = 0;
+    for(QStringList::Iterator it = argList.begin(); it != argList.end(); it++)
+    {
+      if(!crdview->benchmark(*it, stream, benchmarkFrames))
+        result = 1;
+    }
+    crdview->close();
+    return result;
+  }
+
   // check whether a conversion is needed
   if(argList.count() >= 2)
   {